@@ -0,0 +1,88 @@
+// Expansions per second of RoutePlanner::AStarSearch against the previous
+// open list, which re-sorted a std::vector of candidates on every expansion,
+// and the nodes settled by BidirectionalAStarSearch on the same queries.
+//
+// Usage: ./bench_a_star [-f ../map.osm] [-n queries]
+
+#include <algorithm>
+#include <cstdio>
+#include "bench_util.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+// The search as it was before the indexed heap: the open list is sorted on every
+// NextNode and nodes are closed as soon as they are queued.
+static int SortedVectorAStar(const RouteModel &model, SearchWorkspace &workspace, const Query &q)
+{
+    const auto start = model.FindClosestNode(q.start_x * 0.01f, q.start_y * 0.01f);
+    const auto end = model.FindClosestNode(q.end_x * 0.01f, q.end_y * 0.01f);
+    auto compare = [&](int a, int b) {
+        return workspace.GValue(a) + workspace.HValue(a) > workspace.GValue(b) + workspace.HValue(b);
+    };
+
+    workspace.Reset((int)model.SNodes().size());
+    workspace.Reach(start.Index(), 0.f, start.distance(end), -1);
+    workspace.Close(start.Index());
+    std::vector<int> open_list{start.Index()};
+    int expanded = 0;
+    while( !open_list.empty() ) {
+        std::sort(open_list.begin(), open_list.end(), compare);
+        const auto current = model.SNodes()[open_list.back()];
+        open_list.pop_back();
+        ++expanded;
+        if( current.distance(end) == 0 )
+            break;
+        for( auto &edge: model.Neighbors(current.Index()) ) {
+            if( workspace.Reached(edge.to) )
+                continue;
+            const auto neighbor = model.SNodes()[edge.to];
+            auto g_value = workspace.GValue(current.Index()) + edge.weight;
+            workspace.Reach(neighbor.Index(), g_value, neighbor.distance(end), current.Index());
+            workspace.Close(neighbor.Index());
+            open_list.emplace_back(neighbor.Index());
+        }
+    }
+    return expanded;
+}
+
+static int HeapAStar(const RouteModel &model, SearchWorkspace &workspace, const Query &q)
+{
+    RoutePlanner planner{model, workspace, q.start_x, q.start_y, q.end_x, q.end_y};
+    planner.AStarSearch();
+    return planner.GetExpandedNodes();
+}
+
+static int BidirectionalAStar(const RouteModel &model, SearchWorkspace &workspace, const Query &q)
+{
+    static SearchWorkspace backward_workspace;
+    RoutePlanner planner{model, workspace, q.start_x, q.start_y, q.end_x, q.end_y};
+    planner.BidirectionalAStarSearch(backward_workspace);
+    return planner.GetExpandedNodes();
+}
+
+template <typename Search>
+static void Run(const char *name, const RouteModel &model,
+                const std::vector<Query> &queries, Search search)
+{
+    SearchWorkspace workspace;
+    long expanded = 0;
+    double seconds = 0.;
+    for( auto &q: queries ) {
+        Stopwatch watch;
+        expanded += search(model, workspace, q);
+        seconds += watch.Seconds();
+    }
+    std::printf("%-14s %10ld expansions %9.3f ms %12.0f expansions/sec\n",
+                name, expanded, seconds * 1e3, expanded / seconds);
+}
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto queries = RandomQueries(std::stoi(Arg(argc, argv, "-n", "20")));
+    RouteModel model{osm_data};
+
+    Run("sorted vector", model, queries, SortedVectorAStar);
+    Run("indexed heap", model, queries, HeapAStar);
+    Run("bidirectional", model, queries, BidirectionalAStar);
+}
@@ -0,0 +1,82 @@
+// Query latency of AlternativeRoutesSearch asked for 3 routes compared with
+// one AStarSearch and with the 3 AStarSearch calls a penalised re-search
+// makes, plus the routes it finds, how much longer the alternatives are and
+// the nodes it settles.
+//
+// Usage: ./bench_alternative_routes [-f ../map.osm] [-n queries]
+
+#include <cstdio>
+#include <vector>
+#include "bench_util.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+struct Result {
+    double micros = 0.;
+    double settled = 0.;
+    double routes = 0.;
+    double stretch = 0.;
+};
+
+static Result AStar(const RouteModel &model, const std::vector<Query> &queries, int profile, int searches)
+{
+    SearchWorkspace workspace;
+    Result result;
+    Stopwatch watch;
+    for( auto &q: queries ) {
+        for( int i = 0; i < searches; ++i ) {
+            RoutePlanner planner{model, workspace, q.start_x, q.start_y, q.end_x, q.end_y, RoutePlanner::Snap::ToEdge, profile};
+            planner.AStarSearch();
+            result.settled += planner.GetExpandedNodes();
+        }
+    }
+    result.micros = watch.Seconds() * 1e6 / queries.size();
+    result.settled /= queries.size();
+    return result;
+}
+
+static Result Alternatives(const RouteModel &model, const std::vector<Query> &queries, int profile)
+{
+    SearchWorkspace workspace, backward_workspace;
+    Result result;
+    int alternatives = 0;
+    Stopwatch watch;
+    for( auto &q: queries ) {
+        RoutePlanner planner{model, workspace, q.start_x, q.start_y, q.end_x, q.end_y, RoutePlanner::Snap::ToEdge, profile};
+        auto routes = planner.AlternativeRoutesSearch(backward_workspace);
+        result.settled += planner.GetExpandedNodes();
+        result.routes += routes.size();
+        for( std::size_t i = 1; i < routes.size(); ++i, ++alternatives )
+            result.stretch += routes[i].Length() / routes[0].Length() - 1.;
+    }
+    result.micros = watch.Seconds() * 1e6 / queries.size();
+    result.settled /= queries.size();
+    result.routes /= queries.size();
+    result.stretch /= alternatives ? alternatives : 1;
+    return result;
+}
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto queries = RandomQueries(std::stoi(Arg(argc, argv, "-n", "200")));
+    RouteModel model{osm_data};
+    std::printf("%d nodes, %zu queries\n\n", (int)model.Nodes().size(), queries.size());
+
+    std::printf("%-12s %10s %10s %10s %9s %9s %8s %9s %16s\n", "profile", "1 A* us", "3 A* us", "alt us",
+                "vs 3 A*", "vs 1 A*", "routes", "stretch", "settled alt/A*");
+    for( int profile = 0; profile < model.ProfileCount(); ++profile ) {
+        // Warm both searches up on the first queries.
+        std::vector<Query> warmup(queries.begin(), queries.begin() + std::min<size_t>(queries.size(), 10));
+        AStar(model, warmup, profile, 1);
+        Alternatives(model, warmup, profile);
+
+        auto one = AStar(model, queries, profile, 1);
+        auto three = AStar(model, queries, profile, 3);
+        auto alternatives = Alternatives(model, queries, profile);
+        std::printf("%-12s %10.1f %10.1f %10.1f %8.2fx %8.2fx %8.2f %8.1f%% %7.0f/%-8.0f\n",
+                    model.Profile(profile).name.c_str(), one.micros, three.micros, alternatives.micros,
+                    alternatives.micros / three.micros, alternatives.micros / one.micros, alternatives.routes,
+                    100. * alternatives.stretch, alternatives.settled, one.settled);
+    }
+}
@@ -0,0 +1,66 @@
+// Throughput of BatchRouter for a table of origins and destinations, with
+// A* and with a contraction hierarchy, for 1 thread up to one per core,
+// against building a RoutePlanner (and snapping) for every pair on one thread.
+//
+// Usage: ./bench_batch_router [-f ../map.osm] [-n origins]
+
+#include <algorithm>
+#include <cstdio>
+#include "bench_util.h"
+#include "../src/batch_router.h"
+#include "../src/contraction_hierarchy.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+// Every origin to every destination, n * n queries.
+static std::vector<BatchRouter::Query> Table(int n)
+{
+    std::vector<BatchRouter::Query> table;
+    auto points = RandomQueries(n, 7);
+    for( auto &from: points )
+        for( auto &to: points )
+            table.push_back({from.start_x, from.start_y, to.end_x, to.end_y});
+    return table;
+}
+
+static void Report(const char *name, int threads, std::size_t queries, double seconds)
+{
+    auto per_second = queries / seconds;
+    std::printf("%-14s %2d threads %10.0f queries/s %10.0f queries/s/core\n", name, threads, per_second, per_second / threads);
+}
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto queries = Table(std::stoi(Arg(argc, argv, "-n", "30")));
+    RouteModel model{osm_data};
+    std::printf("%zu queries\n", queries.size());
+
+    {
+        SearchWorkspace workspace;
+        Stopwatch watch;
+        for( auto &q: queries ) {
+            RoutePlanner planner{model, workspace, q.start_x, q.start_y, q.end_x, q.end_y, RoutePlanner::Snap::ToEdge};
+            planner.AStarSearch();
+        }
+        Report("planner/pair", 1, queries.size(), watch.Seconds());
+    }
+
+    ContractionHierarchy hierarchy{model, RouteModel::kDefaultProfile};
+    std::vector<int> thread_counts{1};
+    for( int threads = 2; threads <= ThreadPool::HardwareThreads(); threads *= 2 )
+        thread_counts.push_back(threads);
+    if( thread_counts.back() != ThreadPool::HardwareThreads() )
+        thread_counts.push_back(ThreadPool::HardwareThreads());
+    for( int threads: thread_counts ) {
+        BatchRouter router{model, threads};
+        Stopwatch a_star;
+        router.Route(queries);
+        Report("batch a*", threads, queries.size(), a_star.Seconds());
+
+        router.UseHierarchy(hierarchy);
+        Stopwatch ch;
+        router.Route(queries);
+        Report("batch ch", threads, queries.size(), ch.Seconds());
+    }
+}
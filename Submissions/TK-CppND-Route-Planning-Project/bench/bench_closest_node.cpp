@@ -0,0 +1,50 @@
+// Latency of RouteModel::FindClosestNode on the k-d tree against the linear scan
+// over every drivable road node that it replaced, plus the k-nearest and radius
+// queries of the same index.
+//
+// Usage: ./bench_closest_node [-f ../map.osm] [-n queries]
+
+#include <cstdio>
+#include <limits>
+#include "bench_util.h"
+#include "../src/route_model.h"
+
+static int ScanClosestNode(const RouteModel &model, float x, float y)
+{
+    RouteModel::Node input;
+    input.x = x;
+    input.y = y;
+    float min_dist = std::numeric_limits<float>::max();
+    int closest_idx = -1;
+    for( auto &road: model.Roads() )
+        if( road.type != Model::Road::Footway )
+            for( int node_idx: model.WayNodes(road.way) )
+                if( auto dist = input.distance(model.SNodes()[node_idx]); dist < min_dist ) {
+                    closest_idx = node_idx;
+                    min_dist = dist;
+                }
+    return closest_idx;
+}
+
+template <typename Lookup>
+static void Run(const char *name, const std::vector<Query> &queries, Lookup lookup)
+{
+    long checksum = 0;
+    Stopwatch watch;
+    for( auto &q: queries )
+        checksum += lookup(q.start_x * 0.01f, q.start_y * 0.01f);
+    auto seconds = watch.Seconds();
+    std::printf("%-18s %10.3f us/query (checksum %ld)\n", name, seconds * 1e6 / queries.size(), checksum);
+}
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto queries = RandomQueries(std::stoi(Arg(argc, argv, "-n", "2000")));
+    RouteModel model{osm_data};
+
+    Run("linear scan", queries, [&](float x, float y) { return ScanClosestNode(model, x, y); });
+    Run("k-d tree nearest", queries, [&](float x, float y) { return model.FindClosestNode(x, y).Index(); });
+    Run("k-d tree 10-nearest", queries, [&](float x, float y) { return (int)model.FindClosestNodes(x, y, 10).size(); });
+    Run("k-d tree r=0.02", queries, [&](float x, float y) { return (int)model.FindNodesWithin(x, y, 0.02f).size(); });
+}
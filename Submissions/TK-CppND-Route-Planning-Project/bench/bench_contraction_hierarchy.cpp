@@ -0,0 +1,52 @@
+// Preprocessing time and size of a ContractionHierarchy over the road graph,
+// then query latency of ContractionHierarchySearch against AStarSearch on the
+// same queries, checking that both return paths of the same length.
+//
+// Usage: ./bench_contraction_hierarchy [-f ../map.osm] [-n queries]
+
+#include <cmath>
+#include <cstdio>
+#include "bench_util.h"
+#include "../src/contraction_hierarchy.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto queries = RandomQueries(std::stoi(Arg(argc, argv, "-n", "200")));
+    RouteModel model{osm_data};
+
+    Stopwatch build;
+    ContractionHierarchy hierarchy{model, RouteModel::kDefaultProfile};
+    std::printf("preprocessing  %9.3f s   %d graph edges, %d hierarchy edges (%d shortcuts)\n",
+                build.Seconds(), model.RoadGraph().EdgeCount(), hierarchy.EdgeCount(),
+                hierarchy.ShortcutCount());
+
+    SearchWorkspace workspace, backward_workspace;
+    double a_star_seconds = 0., hierarchy_seconds = 0.;
+    long a_star_settled = 0, hierarchy_settled = 0;
+    int mismatches = 0;
+    for( auto &q: queries ) {
+        RoutePlanner a_star{model, workspace, q.start_x, q.start_y, q.end_x, q.end_y};
+        Stopwatch a_star_watch;
+        a_star.AStarSearch();
+        a_star_seconds += a_star_watch.Seconds();
+        a_star_settled += a_star.GetExpandedNodes();
+
+        RoutePlanner contracted{model, workspace, q.start_x, q.start_y, q.end_x, q.end_y};
+        Stopwatch hierarchy_watch;
+        contracted.ContractionHierarchySearch(hierarchy, backward_workspace);
+        hierarchy_seconds += hierarchy_watch.Seconds();
+        hierarchy_settled += contracted.GetExpandedNodes();
+
+        if( std::abs(a_star.GetDistance() - contracted.GetDistance()) > 1e-3f * a_star.GetDistance() + 1e-2f )
+            ++mismatches;
+    }
+    auto n = (double)queries.size();
+    std::printf("%-14s %9.1f us/query %10.0f settled/query\n", "a*",
+                a_star_seconds / n * 1e6, a_star_settled / n);
+    std::printf("%-14s %9.1f us/query %10.0f settled/query\n", "hierarchy",
+                hierarchy_seconds / n * 1e6, hierarchy_settled / n);
+    std::printf("distance mismatches: %d of %zu\n", mismatches, queries.size());
+}
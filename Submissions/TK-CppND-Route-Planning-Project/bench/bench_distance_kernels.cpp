@@ -0,0 +1,126 @@
+// Throughput of the batch distance kernels at every SIMD level the CPU runs,
+// against the former RouteModel::Node::distance, which took its argument by
+// value and squared with std::pow:
+//  - neighbor batches: the distance from every road graph neighbor of every
+//    node to one point, one GatherDistances call per node, also for the short
+//    neighbor lists AddNeighbors measures one by one;
+//  - linear scan: NearestPoint over all nodes at once;
+//  - FindClosestNode on the k-d tree, whose leaves use NearestPoint;
+//  - AStarSearch end to end.
+//
+// Usage: ./bench_distance_kernels [-f ../map.osm] [-n queries]
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "bench_util.h"
+#include "../src/distance_kernels.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+// The former RouteModel::Node::distance.
+static float FormerDistance(RouteModel::Node node, RouteModel::Node other)
+{
+    return std::sqrt(std::pow((node.x - other.x), 2) + std::pow((node.y - other.y), 2));
+}
+
+template <typename Pass>
+static void Time(const char *name, const char *unit, int passes, size_t items, Pass pass)
+{
+    double sum = 0.;
+    Stopwatch watch;
+    for( int i = 0; i < passes; ++i )
+        sum += pass(i);
+    auto seconds = watch.Seconds();
+    std::printf("  %-22s %9.2f ns/%-8s (%.4g)\n", name, seconds * 1e9 / passes / items, unit, sum / passes);
+}
+
+static void RunKernels(const char *name, const RouteModel &model, const std::vector<Query> &queries)
+{
+    const Graph &graph = model.RoadGraph();
+    const auto &nodes = model.Nodes();
+    const int node_count = (int)nodes.size();
+    std::printf("%s\n", name);
+
+    Time("neighbor batches", "distance", 10, graph.EdgeCount(), [&]( int pass ) {
+        const Query &q = queries[pass % queries.size()];
+        int targets[16];
+        float distances[16];
+        double sum = 0.;
+        for( int node = 0; node < node_count; ++node ) {
+            auto edges = graph.Edges(node);
+            for( auto batch = edges.begin(); batch != edges.end(); ) {
+                int count = 0;
+                for( auto edge = batch; edge != edges.end() && count < 16; ++edge )
+                    targets[count++] = edge->to;
+                GatherDistances(nodes.Xs(), nodes.Ys(), targets, count, q.end_x * 0.01f, q.end_y * 0.01f, distances);
+                for( int i = 0; i < count; ++i, ++batch )
+                    sum += distances[i];
+            }
+        }
+        return sum;
+    });
+    Time("linear scan", "point", 10, node_count, [&]( int pass ) {
+        const Query &q = queries[pass % queries.size()];
+        float d2;
+        return (double)NearestPoint(nodes.Xs(), nodes.Ys(), node_count, q.start_x * 0.01f, q.start_y * 0.01f, d2);
+    });
+    Time("FindClosestNode", "query", 10, queries.size(), [&]( int ) {
+        double sum = 0.;
+        for( auto &q: queries )
+            sum += model.FindClosestNode(q.start_x * 0.01f, q.start_y * 0.01f).Index();
+        return sum;
+    });
+    SearchWorkspace workspace;
+    const size_t searches = std::min<size_t>(queries.size(), 50);
+    Time("AStarSearch", "query", 1, searches, [&]( int ) {
+        double sum = 0.;
+        for( size_t i = 0; i < searches; ++i ) {
+            const Query &q = queries[i];
+            RoutePlanner planner{model, workspace, q.start_x, q.start_y, q.end_x, q.end_y};
+            planner.AStarSearch();
+            sum += planner.GetDistance();
+        }
+        return sum;
+    });
+}
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto queries = RandomQueries(std::stoi(Arg(argc, argv, "-n", "1000")));
+    RouteModel model{osm_data};
+    const Graph &graph = model.RoadGraph();
+    const int node_count = (int)model.Nodes().size();
+    std::printf("%d nodes, %d road graph edges, widest SIMD level: %s\n\n", node_count, graph.EdgeCount(),
+                SimdLevelName(SupportedSimdLevel()));
+
+    std::printf("former Node::distance\n");
+    Time("neighbor batches", "distance", 10, graph.EdgeCount(), [&]( int pass ) {
+        const Query &q = queries[pass % queries.size()];
+        RouteModel::Node end(-1, Model::Node{q.end_x * 0.01f, q.end_y * 0.01f});
+        double sum = 0.;
+        for( int node = 0; node < node_count; ++node )
+            for( auto &edge: graph.Edges(node) )
+                sum += FormerDistance(model.SNodes()[edge.to], end);
+        return sum;
+    });
+    Time("linear scan", "point", 10, node_count, [&]( int pass ) {
+        const Query &q = queries[pass % queries.size()];
+        RouteModel::Node input(-1, Model::Node{q.start_x * 0.01f, q.start_y * 0.01f});
+        float min_dist = std::numeric_limits<float>::max();
+        int closest = -1;
+        for( int node = 0; node < node_count; ++node )
+            if( auto dist = FormerDistance(input, model.SNodes()[node]); dist < min_dist ) {
+                closest = node;
+                min_dist = dist;
+            }
+        return (double)closest;
+    });
+
+    for( SimdLevel level: {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2} )
+        if( level <= SupportedSimdLevel() ) {
+            SelectSimdLevel(level);
+            RunKernels(SimdLevelName(level), model, queries);
+        }
+}
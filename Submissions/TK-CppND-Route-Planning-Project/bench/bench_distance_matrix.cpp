@@ -0,0 +1,49 @@
+// Time to fill an N x N distance matrix with one Dijkstra sweep per source
+// (DistanceMatrix) against one A* query per entry (BatchRouter), both on a
+// single thread, with the nodes settled by each.
+//
+// Usage: ./bench_distance_matrix [-f ../map.osm] [-n points]
+
+#include <cmath>
+#include <cstdio>
+#include "bench_util.h"
+#include "../src/batch_router.h"
+#include "../src/distance_matrix.h"
+#include "../src/route_model.h"
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto n = std::stoi(Arg(argc, argv, "-n", "50"));
+    RouteModel model{osm_data};
+
+    std::vector<DistanceMatrix::Point> points;
+    for( auto &q: RandomQueries(n, 11) )
+        points.push_back({q.start_x, q.start_y});
+    std::vector<BatchRouter::Query> pairs;
+    for( auto &from: points )
+        for( auto &to: points )
+            pairs.push_back({from.x, from.y, to.x, to.y});
+
+    DistanceMatrix matrix{model, 1};
+    Stopwatch sweep_watch;
+    auto table = matrix.Compute(points, points);
+    auto sweep_seconds = sweep_watch.Seconds();
+
+    BatchRouter router{model, 1};
+    Stopwatch a_star_watch;
+    auto results = router.Route(pairs);
+    auto a_star_seconds = a_star_watch.Seconds();
+    long a_star_settled = 0;
+    int mismatches = 0;
+    for( std::size_t i = 0; i < results.size(); ++i ) {
+        a_star_settled += results[i].settled;
+        if( std::abs(results[i].distance - table.values[i]) > 1e-3f * results[i].distance + 1e-2f )
+            ++mismatches;
+    }
+
+    std::printf("%d x %d matrix\n", n, n);
+    std::printf("%-18s %10.1f ms %12ld settled\n", "dijkstra sweeps", sweep_seconds * 1e3, matrix.SettledNodes());
+    std::printf("%-18s %10.1f ms %12ld settled\n", "a* per entry", a_star_seconds * 1e3, a_star_settled);
+    std::printf("speedup %.1fx, distance mismatches: %d of %zu\n", a_star_seconds / sweep_seconds, mismatches, results.size());
+}
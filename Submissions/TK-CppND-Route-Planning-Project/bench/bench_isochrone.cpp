@@ -0,0 +1,34 @@
+// Time to compute isochrones of growing budgets from random start points,
+// with the number of reachable nodes and boundary vertices of each.
+//
+// Usage: ./bench_isochrone [-f ../map.osm] [-n starts]
+
+#include <cstdio>
+#include "bench_util.h"
+#include "../src/isochrone.h"
+#include "../src/route_model.h"
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto starts = RandomQueries(std::stoi(Arg(argc, argv, "-n", "100")));
+    RouteModel model{osm_data};
+    auto n = (double)starts.size();
+
+    // Budgets are metres for the shortest profiles and seconds for car-fastest.
+    int walking = model.FindProfile("walking"), fastest = model.FindProfile("car-fastest");
+    struct Case { const char *name; int profile; float budget; };
+    for( auto c: {Case{"car 500 m", RouteModel::kDefaultProfile, 500.f}, Case{"car 2 km", RouteModel::kDefaultProfile, 2000.f},
+                  Case{"walking 1 km", walking, 1000.f}, Case{"car 5 min", fastest, 300.f}, Case{"car 15 min", fastest, 900.f}} ) {
+        SearchWorkspace workspace;
+        long reachable = 0, vertices = 0;
+        Stopwatch watch;
+        for( auto &s: starts ) {
+            Isochrone isochrone{model, workspace, s.start_x, s.start_y, c.budget, RoutePlanner::Snap::ToEdge, c.profile};
+            reachable += isochrone.Nodes().size();
+            vertices += isochrone.Boundary().size();
+        }
+        std::printf("%-14s %9.3f ms/isochrone %10.0f nodes %6.0f boundary vertices\n", c.name, watch.Seconds() / n * 1e3,
+                    reachable / n, vertices / n);
+    }
+}
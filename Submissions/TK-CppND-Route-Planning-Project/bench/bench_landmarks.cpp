@@ -0,0 +1,57 @@
+// Nodes settled per query by AStarSearch with the straight-line heuristic
+// against the ALT heuristic, for both landmark selection strategies and a
+// few landmark counts, with the preprocessing time and table size of each.
+//
+// Usage: ./bench_landmarks [-f ../map.osm] [-n queries]
+
+#include <cstdio>
+#include "bench_util.h"
+#include "../src/landmarks.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+struct Totals {
+    long settled = 0;
+    double seconds = 0.;
+};
+
+static Totals Run(const RouteModel &model, const std::vector<Query> &queries, const Landmarks *landmarks)
+{
+    SearchWorkspace workspace;
+    Totals totals;
+    for( auto &q: queries ) {
+        RoutePlanner planner{model, workspace, q.start_x, q.start_y, q.end_x, q.end_y};
+        if( landmarks )
+            planner.UseLandmarks(*landmarks);
+        Stopwatch watch;
+        planner.AStarSearch();
+        totals.seconds += watch.Seconds();
+        totals.settled += planner.GetExpandedNodes();
+    }
+    return totals;
+}
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto queries = RandomQueries(std::stoi(Arg(argc, argv, "-n", "200")));
+    RouteModel model{osm_data};
+    auto n = (double)queries.size();
+
+    auto euclidean = Run(model, queries, nullptr);
+    std::printf("%-18s %10s %10s %12.0f settled/query %9.1f us/query\n", "straight line", "", "",
+                euclidean.settled / n, euclidean.seconds / n * 1e6);
+    for( auto selection: {Landmarks::Selection::Farthest, Landmarks::Selection::Avoid} ) {
+        for( int count: {4, 8, 16} ) {
+            Stopwatch build;
+            Landmarks landmarks{model, RouteModel::kDefaultProfile, count, selection};
+            auto seconds = build.Seconds();
+            auto alt = Run(model, queries, &landmarks);
+            char name[32];
+            std::snprintf(name, sizeof(name), "%s %d", selection == Landmarks::Selection::Farthest ? "farthest" : "avoid", count);
+            std::printf("%-18s %8.0f ms %7zu KiB %12.0f settled/query %9.1f us/query  (%.0f%% fewer settled)\n",
+                        name, seconds * 1e3, landmarks.MemoryUsage() / 1024, alt.settled / n, alt.seconds / n * 1e6,
+                        100. * (1. - (double)alt.settled / euclidean.settled));
+        }
+    }
+}
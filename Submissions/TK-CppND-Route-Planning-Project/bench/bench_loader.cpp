@@ -0,0 +1,227 @@
+// Throughput and peak memory of building a Model from OSM XML with the
+// streaming OsmReader, against the former pugixml loader that parsed the whole
+// document into a DOM and walked it with XPath queries. Then the load is timed
+// with 1, 2, 4, ... threads up to -t (default: every core). A last table times
+// the id and coordinate handling on the file's own values: string-keyed
+// std::unordered_map against IdMap, and atof against std::from_chars.
+//
+// Peak memory is the growth of the resident set over what was mapped before
+// the load, read from /proc/self/status after resetting the high-water mark,
+// so it is only reported on Linux.
+//
+// Usage: ./bench_loader [-f ../map.osm] [-n repetitions] [-t max threads]
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include "bench_util.h"
+#include "pugixml.hpp"
+#include "../src/id_map.h"
+#include "../src/model.h"
+#include "../src/osm_reader.h"
+#include "../src/thread_pool.h"
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// The traversal of the former Model::LoadData: DOM first, then one XPath query
+// per element kind, with ids kept as strings and a vector per way and relation.
+static size_t DomLoad(const std::vector<std::byte> &xml)
+{
+    using namespace pugi;
+    struct Way { std::vector<int> nodes; };
+    struct Multipolygon { std::vector<int> outer; };
+
+    xml_document doc;
+    if( !doc.load_buffer(xml.data(), xml.size()) )
+        throw std::logic_error("failed to parse the xml file");
+
+    std::vector<Model::Node> nodes;
+    std::vector<Way> ways;
+    std::vector<Model::Road> roads;
+    std::vector<Multipolygon> relations;
+    std::unordered_map<std::string, int> node_id_to_num;
+    for( const auto &node: doc.select_nodes("/osm/node") ) {
+        node_id_to_num[node.node().attribute("id").as_string()] = (int)nodes.size();
+        nodes.emplace_back();
+        nodes.back().y = atof(node.node().attribute("lat").as_string());
+        nodes.back().x = atof(node.node().attribute("lon").as_string());
+    }
+
+    std::unordered_map<std::string, int> way_id_to_num;
+    for( const auto &way: doc.select_nodes("/osm/way") ) {
+        auto node = way.node();
+        const auto way_num = (int)ways.size();
+        way_id_to_num[node.attribute("id").as_string()] = way_num;
+        auto &new_way = ways.emplace_back();
+        for( auto child: node.children() ) {
+            auto name = std::string_view{child.name()};
+            if( name == "nd" ) {
+                if( auto it = node_id_to_num.find(child.attribute("ref").as_string()); it != end(node_id_to_num) )
+                    new_way.nodes.emplace_back(it->second);
+            }
+            else if( name == "tag" && std::string_view{child.attribute("k").as_string()} == "highway" )
+                roads.push_back({way_num, Model::Road::Residential});
+        }
+    }
+
+    for( const auto &relation: doc.select_nodes("/osm/relation") ) {
+        auto &mp = relations.emplace_back();
+        for( auto child: relation.node().children() )
+            if( std::string_view{child.name()} == "member" && way_id_to_num.count(child.attribute("ref").as_string()) )
+                mp.outer.emplace_back(way_id_to_num[child.attribute("ref").as_string()]);
+    }
+    return nodes.size() + ways.size() + roads.size() + relations.size();
+}
+
+static size_t StreamLoad(const std::vector<std::byte> &xml)
+{
+    Model model{xml};
+    return model.Nodes().size() + model.Ways().size() + model.Roads().size();
+}
+
+// Value of a "VmRSS:" style line of /proc/self/status in bytes, or -1.
+static long ProcStatus(const std::string &key)
+{
+    std::ifstream is{"/proc/self/status"};
+    for( std::string line; std::getline(is, line); )
+        if( line.compare(0, key.size(), key) == 0 )
+            return std::atol(line.c_str() + key.size()) * 1024;
+    return -1;
+}
+
+// Resident memory added by `load` at its peak, or -1 when it cannot be measured.
+template <typename Load>
+static long PeakGrowth(const std::vector<std::byte> &xml, Load load)
+{
+#ifdef __GLIBC__
+    // Hand memory freed by earlier runs back, or the next load reuses it unseen.
+    malloc_trim(0);
+#endif
+    std::ofstream{"/proc/self/clear_refs"} << "5";
+    const long before = ProcStatus("VmRSS:");
+    load(xml);
+    const long peak = ProcStatus("VmHWM:");
+    return before < 0 || peak < 0 ? -1 : peak - before;
+}
+
+template <typename Load>
+static void Run(const char *name, const std::vector<std::byte> &xml, int repetitions, Load load)
+{
+    const long peak = PeakGrowth(xml, load);
+    double seconds = 0.;
+    for( int i = 0; i < repetitions; ++i ) {
+        Stopwatch watch;
+        load(xml);
+        seconds += watch.Seconds();
+    }
+    std::printf("%-16s %9.3f ms %8.1f MB/s   peak +%7.1f MiB (%.1fx the file)\n",
+                name, seconds / repetitions * 1e3, xml.size() * repetitions / seconds / 1e6,
+                peak / 1048576., double(peak) / xml.size());
+}
+
+// Node ids, way node refs and latitudes as they appear in the file.
+struct Attributes {
+    std::vector<std::string> ids, refs, lats;
+};
+
+static Attributes CollectAttributes(const std::vector<std::byte> &xml)
+{
+    Attributes attributes;
+    OsmReader reader{xml.data(), xml.size()};
+    for( auto event = reader.Next(); event != OsmReader::EndOfDocument; event = reader.Next() ) {
+        if( event != OsmReader::StartElement )
+            continue;
+        if( reader.Name() == "node" ) {
+            attributes.ids.emplace_back(reader.Attribute("id"));
+            attributes.lats.emplace_back(reader.Attribute("lat"));
+        }
+        else if( reader.Name() == "nd" )
+            attributes.refs.emplace_back(reader.Attribute("ref"));
+    }
+    return attributes;
+}
+
+template <typename Work>
+static void Time(const char *name, size_t count, Work work)
+{
+    Stopwatch watch;
+    auto checksum = work();
+    auto seconds = watch.Seconds();
+    std::printf("%-26s %9.3f ms %8.1f ns/item   (%ld)\n", name, seconds * 1e3, seconds * 1e9 / count, (long)checksum);
+}
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto repetitions = std::stoi(Arg(argc, argv, "-n", "5"));
+
+    Run("pugixml DOM", osm_data, repetitions, DomLoad);
+    Run("streaming", osm_data, repetitions, StreamLoad);
+
+    const auto max_threads = std::stoi(Arg(argc, argv, "-t", std::to_string(ThreadPool::HardwareThreads())));
+    double single_thread = 0.;
+    std::printf("\n");
+    for( int threads = 1; threads <= max_threads; threads = threads == max_threads ? threads + 1 : std::min(threads * 2, max_threads) ) {
+        double seconds = 0.;
+        for( int i = 0; i < repetitions; ++i ) {
+            Stopwatch watch;
+            Model model{osm_data, threads};
+            seconds += watch.Seconds();
+        }
+        seconds /= repetitions;
+        if( threads == 1 )
+            single_thread = seconds;
+        std::printf("%2d threads       %9.3f ms %8.1f MB/s   %.2fx\n",
+                    threads, seconds * 1e3, osm_data.size() / seconds / 1e6, single_thread / seconds);
+    }
+
+    auto attributes = CollectAttributes(osm_data);
+    std::printf("\n%zu node ids, %zu refs\n", attributes.ids.size(), attributes.refs.size());
+    const auto lookups = attributes.ids.size() + attributes.refs.size();
+    Time("string ids, unordered_map", lookups, [&] {
+        std::unordered_map<std::string, int> ids;
+        for( size_t i = 0; i < attributes.ids.size(); ++i )
+            ids[attributes.ids[i]] = (int)i;
+        long found = 0;
+        for( auto &ref: attributes.refs )
+            if( auto it = ids.find(ref); it != ids.end() )
+                found += it->second;
+        return found;
+    });
+    Time("int64 ids, IdMap", lookups, [&] {
+        auto parse = [](const std::string &s) {
+            std::int64_t id = 0;
+            std::from_chars(s.data(), s.data() + s.size(), id);
+            return id;
+        };
+        IdMap ids{attributes.ids.size()};
+        for( size_t i = 0; i < attributes.ids.size(); ++i )
+            ids.Insert(parse(attributes.ids[i]), (int)i);
+        long found = 0;
+        for( auto &ref: attributes.refs )
+            if( auto index = ids.Find(parse(ref)); index != IdMap::kMissing )
+                found += index;
+        return found;
+    });
+    Time("coordinates, atof", attributes.lats.size(), [&] {
+        double sum = 0.;
+        for( auto &lat: attributes.lats )
+            sum += atof(lat.c_str());
+        return sum;
+    });
+    Time("coordinates, from_chars", attributes.lats.size(), [&] {
+        double sum = 0.;
+        for( auto &lat: attributes.lats ) {
+            double value = 0.;
+            std::from_chars(lat.data(), lat.data() + lat.size(), value);
+            sum += value;
+        }
+        return sum;
+    });
+}
@@ -0,0 +1,146 @@
+// A* query time and cache misses with the nodes numbered in file order,
+// along a Hilbert curve and in breadth-first order over the roads, on the
+// same random queries. Locality is also measured without counters: the mean
+// index distance between the two ends of a road graph edge, and the share of
+// edges whose ends lie within 64 indices of each other.
+//
+// Cache misses come from the hardware counters of perf_event_open, so they
+// are only reported on Linux and where the kernel lets a process count its
+// own events.
+//
+// Usage: ./bench_node_order [-f ../map.osm] [-n queries]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "bench_util.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// One cache miss event counted for this thread, in user space only.
+class Counter {
+  public:
+    enum Event { L1dReadMisses, LastLevelMisses };
+
+    explicit Counter(Event event)
+    {
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        if( event == L1dReadMisses ) {
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        }
+        else {
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        }
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+    ~Counter()
+    {
+#ifdef __linux__
+        if( fd >= 0 )
+            close(fd);
+#endif
+    }
+    Counter(const Counter &) = delete;
+    Counter &operator=(const Counter &) = delete;
+
+    bool Available() const { return fd >= 0; }
+
+    void Start()
+    {
+#ifdef __linux__
+        if( fd >= 0 ) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Events since Start, or -1 when the counter could not be opened.
+    long long Stop()
+    {
+        long long count = -1;
+#ifdef __linux__
+        if( fd >= 0 ) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if( read(fd, &count, sizeof(count)) != sizeof(count) )
+                count = -1;
+        }
+#endif
+        return count;
+    }
+
+  private:
+    int fd = -1;
+};
+
+static void Run(const char *name, const std::vector<std::byte> &osm_data, Model::NodeOrder order,
+                const std::vector<Query> &queries)
+{
+    Stopwatch load_watch;
+    RouteModel model{osm_data, 0, order};
+    const double load_seconds = load_watch.Seconds();
+
+    const Graph &graph = model.RoadGraph();
+    double gap = 0.;
+    long near = 0;
+    for( int node = 0; node < graph.NodeCount(); ++node )
+        for( auto &edge: graph.Edges(node) ) {
+            gap += std::abs(edge.to - node);
+            near += std::abs(edge.to - node) < 64;
+        }
+
+    Counter l1{Counter::L1dReadMisses}, llc{Counter::LastLevelMisses};
+    SearchWorkspace workspace;
+    double distance = 0.;
+    long settled = 0;
+    l1.Start();
+    llc.Start();
+    Stopwatch watch;
+    for( auto &q: queries ) {
+        RoutePlanner planner{model, workspace, q.start_x, q.start_y, q.end_x, q.end_y, RoutePlanner::Snap::ToNode};
+        planner.AStarSearch();
+        distance += planner.GetDistance();
+        settled += planner.GetExpandedNodes();
+    }
+    const double seconds = watch.Seconds();
+    const long long l1_misses = l1.Stop(), llc_misses = llc.Stop();
+
+    std::printf("%-14s %8.1f ms load %8.0f gap %6.1f%% near %9.1f us/query", name, load_seconds * 1e3,
+                gap / graph.EdgeCount(), 100. * near / graph.EdgeCount(), seconds * 1e6 / queries.size());
+    if( l1_misses >= 0 )
+        std::printf(" %9.0f L1d", (double)l1_misses / queries.size());
+    if( llc_misses >= 0 )
+        std::printf(" %8.0f LLC", (double)llc_misses / queries.size());
+    if( l1_misses >= 0 || llc_misses >= 0 )
+        std::printf(" misses/query");
+    std::printf("   (%ld settled, %.0f m)\n", settled, distance);
+}
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto queries = RandomQueries(std::stoi(Arg(argc, argv, "-n", "200")));
+
+    Counter probe{Counter::LastLevelMisses};
+    if( !probe.Available() )
+        std::printf("Cache miss counters are not available here.\n");
+    Run("file", osm_data, Model::NodeOrder::File, queries);
+    Run("hilbert", osm_data, Model::NodeOrder::Hilbert, queries);
+    Run("breadth-first", osm_data, Model::NodeOrder::BreadthFirst, queries);
+}
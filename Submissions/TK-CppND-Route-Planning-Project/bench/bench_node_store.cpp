@@ -0,0 +1,127 @@
+// Memory held by the node coordinates of a RouteModel in the shared
+// single-precision store (one float array for x, one for y) against the
+// former layout: a Model::Node of two doubles per node, plus the copy
+// RouteModel kept with the node index appended. Both old arrays are rebuilt
+// here from the store. Heap use is the growth of the bytes malloc hands out,
+// so it is only reported with glibc. A last table times a pass that sums the
+// length of every road graph edge in both layouts.
+//
+// Usage: ./bench_node_store [-f ../map.osm] [-n passes]
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "bench_util.h"
+#include "../src/route_model.h"
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// The former Model::Node and RouteModel::Node.
+struct DoubleNode {
+    double x;
+    double y;
+};
+
+struct IndexedDoubleNode {
+    double x;
+    double y;
+    int index;
+};
+
+struct Former {
+    std::vector<DoubleNode> nodes;
+    std::vector<IndexedDoubleNode> route_nodes;
+};
+
+// Bytes handed out by malloc, or -1 when it cannot be measured.
+static long HeapInUse()
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    malloc_trim(0);
+    return (long)mallinfo2().uordblks;
+#else
+    return -1;
+#endif
+}
+
+static Former BuildFormer(const Model::NodeStore &store)
+{
+    Former former;
+    former.nodes.reserve(store.size());
+    former.route_nodes.reserve(store.size());
+    for( size_t i = 0; i < store.size(); ++i ) {
+        former.nodes.push_back({store.Xs()[i], store.Ys()[i]});
+        former.route_nodes.push_back({store.Xs()[i], store.Ys()[i], (int)i});
+    }
+    return former;
+}
+
+static void Report(const char *name, size_t payload, long heap, size_t nodes)
+{
+    std::printf("%-24s %10.2f MiB payload", name, payload / 1048576.);
+    if( heap >= 0 )
+        std::printf(" %10.2f MiB heap", heap / 1048576.);
+    std::printf(" %8.1f B/node\n", double(payload) / nodes);
+}
+
+template <typename Walk>
+static void Time(const char *name, int passes, size_t visits, Walk walk)
+{
+    double sum = 0.;
+    Stopwatch watch;
+    for( int i = 0; i < passes; ++i )
+        sum += walk();
+    auto seconds = watch.Seconds();
+    std::printf("%-24s %10.3f ms/pass %8.2f ns/edge   (%.3f)\n",
+                name, seconds * 1e3 / passes, seconds * 1e9 / passes / visits, sum / passes);
+}
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto passes = std::stoi(Arg(argc, argv, "-n", "20"));
+    RouteModel model{osm_data};
+    osm_data = {};
+
+    const auto &store = model.Nodes();
+    const Graph &graph = model.RoadGraph();
+    std::printf("%zu nodes, %zu road graph edges\n\n", store.size(), (size_t)graph.EdgeCount());
+
+    long before = HeapInUse();
+    auto former = BuildFormer(store);
+    long former_heap = before < 0 ? -1 : HeapInUse() - before;
+
+    before = HeapInUse();
+    std::vector<float> xs(store.Xs(), store.Xs() + store.size()), ys(store.Ys(), store.Ys() + store.size());
+    long store_heap = before < 0 ? -1 : HeapInUse() - before;
+
+    const size_t former_payload = former.nodes.capacity() * sizeof(DoubleNode) +
+                                  former.route_nodes.capacity() * sizeof(IndexedDoubleNode);
+    const size_t store_payload = (xs.capacity() + ys.capacity()) * sizeof(float);
+    Report("double nodes, two copies", former_payload, former_heap, store.size());
+    Report("shared float store", store_payload, store_heap, store.size());
+    std::printf("%-24s %10.2fx payload", "saving", double(former_payload) / store_payload);
+    if( former_heap >= 0 && store_heap > 0 )
+        std::printf(" %10.2fx heap", double(former_heap) / store_heap);
+    std::printf("\n\n");
+
+    const size_t edges = graph.EdgeCount();
+    Time("edge lengths, doubles", passes, edges, [&] {
+        const auto nodes = former.route_nodes.data();
+        double sum = 0.;
+        for( int from = 0; from < graph.NodeCount(); ++from )
+            for( auto &edge: graph.Edges(from) )
+                sum += std::hypot(nodes[edge.to].x - nodes[from].x, nodes[edge.to].y - nodes[from].y);
+        return sum;
+    });
+    Time("edge lengths, floats", passes, edges, [&] {
+        const float *x = store.Xs(), *y = store.Ys();
+        double sum = 0.;
+        for( int from = 0; from < graph.NodeCount(); ++from )
+            for( auto &edge: graph.Edges(from) )
+                sum += std::hypot(x[edge.to] - x[from], y[edge.to] - y[from]);
+        return sum;
+    });
+}
@@ -0,0 +1,51 @@
+// Latency of repeated traffic answered through RouteCache against plain
+// AStarSearch, with the hit rate and evictions, for a few cache sizes. Pairs
+// are drawn from a skewed distribution so that some of them repeat often.
+//
+// Usage: ./bench_route_cache [-f ../map.osm] [-n queries] [-p distinct pairs]
+
+#include <cstdio>
+#include "bench_util.h"
+#include "../src/route_cache.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto count = std::stoi(Arg(argc, argv, "-n", "5000"));
+    auto pairs = RandomQueries(std::stoi(Arg(argc, argv, "-p", "1000")));
+    RouteModel model{osm_data};
+
+    // Pair i is drawn with a probability falling off as 1 / (i + 1).
+    std::vector<double> weights;
+    for( std::size_t i = 0; i < pairs.size(); ++i )
+        weights.push_back(1. / (i + 1));
+    std::mt19937 rng{5};
+    std::discrete_distribution<int> pick{weights.begin(), weights.end()};
+    std::vector<Query> traffic;
+    for( int i = 0; i < count; ++i )
+        traffic.push_back(pairs[pick(rng)]);
+
+    SearchWorkspace workspace;
+    {
+        Stopwatch watch;
+        for( auto &q: traffic ) {
+            RoutePlanner planner{model, workspace, q.start_x, q.start_y, q.end_x, q.end_y};
+            planner.AStarSearch();
+        }
+        std::printf("%-14s %9.1f us/query\n", "no cache", watch.Seconds() / count * 1e6);
+    }
+    for( std::size_t capacity: {16, 128, 1024} ) {
+        RouteCache cache{capacity};
+        Stopwatch watch;
+        for( auto &q: traffic )
+            cache.FindOrRoute(model, workspace, q.start_x, q.start_y, q.end_x, q.end_y);
+        auto seconds = watch.Seconds();
+        auto stats = cache.GetStats();
+        char name[32];
+        std::snprintf(name, sizeof(name), "cache %zu", capacity);
+        std::printf("%-14s %9.1f us/query %6.1f%% hits %8ld evictions\n", name, seconds / count * 1e6, stats.HitRate() * 100,
+                    stats.evictions);
+    }
+}
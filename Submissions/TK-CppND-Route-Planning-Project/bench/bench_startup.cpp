@@ -0,0 +1,43 @@
+// Start-up cost of building the RouteModel from the OSM XML compared with
+// restoring it from the binary graph cache written after the first load.
+//
+// Usage: ./bench_startup [-f ../map.osm] [-n repetitions]
+
+#include <cstdio>
+#include "bench_util.h"
+#include "../src/graph_cache.h"
+#include "../src/route_model.h"
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto repetitions = std::stoi(Arg(argc, argv, "-n", "5"));
+    auto cache_file = Arg(argc, argv, "-f", "../map.osm") + ".bench.cache";
+
+    Stopwatch checksum_watch;
+    auto checksum = GraphCache::Checksum(osm_data.data(), osm_data.size());
+    auto checksum_seconds = checksum_watch.Seconds();
+
+    double parse_seconds = 0., load_seconds = 0.;
+    for( int i = 0; i < repetitions; ++i ) {
+        Stopwatch parse_watch;
+        RouteModel parsed{osm_data};
+        parse_seconds += parse_watch.Seconds();
+        if( i == 0 && !GraphCache::Save(cache_file, parsed, checksum) ) {
+            std::cerr << "Failed to write " << cache_file << std::endl;
+            return 1;
+        }
+
+        Stopwatch load_watch;
+        auto cache = GraphCache::Open(cache_file, checksum);
+        RouteModel loaded{*cache};
+        load_seconds += load_watch.Seconds();
+    }
+    std::remove(cache_file.c_str());
+
+    std::printf("checksum       %9.3f ms %9.1f MB/s\n", checksum_seconds * 1e3,
+                osm_data.size() / checksum_seconds / 1e6);
+    std::printf("parse XML      %9.3f ms\n", parse_seconds / repetitions * 1e3);
+    std::printf("graph cache    %9.3f ms %9.1fx faster\n", load_seconds / repetitions * 1e3,
+                parse_seconds / load_seconds);
+}
@@ -0,0 +1,62 @@
+// Query latency of EdgeBasedAStarSearch, with the map's turn restrictions and
+// the profile's turn costs, compared with the node-based AStarSearch on the
+// same profile, plus the states each search settles and the size of the
+// turn tables.
+//
+// Usage: ./bench_turn_restrictions [-f ../map.osm] [-n queries]
+
+#include <cstdio>
+#include <vector>
+#include "bench_util.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+struct Result {
+    double micros = 0.;
+    double settled = 0.;
+    double metres = 0.;
+};
+
+template <typename Search>
+static Result Run(const RouteModel &model, const std::vector<Query> &queries, int profile, Search search)
+{
+    SearchWorkspace workspace;
+    Result result;
+    Stopwatch watch;
+    for( auto &q: queries ) {
+        RoutePlanner planner{model, workspace, q.start_x, q.start_y, q.end_x, q.end_y, RoutePlanner::Snap::ToEdge, profile};
+        search(planner);
+        result.settled += planner.GetExpandedNodes();
+        result.metres += planner.GetDistance();
+    }
+    result.micros = watch.Seconds() * 1e6 / queries.size();
+    result.settled /= queries.size();
+    result.metres /= queries.size();
+    return result;
+}
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto queries = RandomQueries(std::stoi(Arg(argc, argv, "-n", "200")));
+    RouteModel model{osm_data};
+    std::printf("%d nodes, %d road graph edges, %zu turn restrictions\n\n", (int)model.Nodes().size(),
+                model.RoadGraph().EdgeCount(), model.TurnRestrictions().size());
+
+    std::printf("%-12s %10s %8s %12s %12s %10s %12s %10s\n", "profile", "forbidden", "KiB", "node us", "edge us",
+                "ratio", "settled", "detour");
+    for( int profile = 0; profile < model.ProfileCount(); ++profile ) {
+        const TurnTable &turns = model.Turns(profile);
+        const double kib = (model.RoadGraph(profile).EdgeCount() / 8. + turns.Size() * sizeof(TurnTable::Turn)) / 1024.;
+        // Warm both searches up on the first queries.
+        std::vector<Query> warmup(queries.begin(), queries.begin() + std::min<size_t>(queries.size(), 10));
+        Run(model, warmup, profile, []( RoutePlanner &planner ) { planner.AStarSearch(); });
+        Run(model, warmup, profile, []( RoutePlanner &planner ) { planner.EdgeBasedAStarSearch(); });
+
+        auto nodes = Run(model, queries, profile, []( RoutePlanner &planner ) { planner.AStarSearch(); });
+        auto edges = Run(model, queries, profile, []( RoutePlanner &planner ) { planner.EdgeBasedAStarSearch(); });
+        std::printf("%-12s %10d %8.1f %12.1f %12.1f %9.2fx %5.0f/%-6.0f %9.2f%%\n", model.Profile(profile).name.c_str(),
+                    turns.Size(), turns.Size() ? kib : 0., nodes.micros, edges.micros, edges.micros / nodes.micros,
+                    edges.settled, nodes.settled, 100. * (edges.metres / nodes.metres - 1.));
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../src/read_file.h"
+
+// Returns the value following `flag` on the command line, or `fallback`.
+static std::string Arg(int argc, const char **argv, std::string_view flag, std::string fallback)
+{
+    for( int i = 1; i + 1 < argc; ++i )
+        if( flag == argv[i] )
+            return argv[i + 1];
+    return fallback;
+}
+
+static std::vector<std::byte> ReadOSMData(int argc, const char **argv)
+{
+    auto path = Arg(argc, argv, "-f", "../map.osm");
+    auto data = ReadFile(path);
+    if( !data ) {
+        std::cerr << "Failed to read OSM data from " << path << std::endl;
+        std::exit(1);
+    }
+    std::cout << "Map: " << path << " (" << data->size() / 1024 << " KiB)" << std::endl;
+    return std::move(*data);
+}
+
+// Start/end pairs in the percent coordinates taken by RoutePlanner, drawn from a
+// fixed seed so that every run and every engine sees the same queries.
+struct Query {
+    float start_x, start_y, end_x, end_y;
+};
+
+inline std::vector<Query> RandomQueries(int count, unsigned seed = 42)
+{
+    std::mt19937 rng{seed};
+    std::uniform_real_distribution<float> pct{0.f, 100.f};
+    std::vector<Query> queries(count);
+    for( auto &q: queries )
+        q = {pct(rng), pct(rng), pct(rng), pct(rng)};
+    return queries;
+}
+
+class Stopwatch {
+  public:
+    Stopwatch() : start(std::chrono::steady_clock::now()) {}
+    double Seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+  private:
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,178 @@
+// Memory footprint of the way node lists and multipolygon rings of a Model,
+// kept as spans of two flat index arrays, against the former layout of one
+// std::vector per way and per ring role, rebuilt here element by element as
+// the parser used to. Heap use is the growth of the bytes malloc hands out,
+// so it counts allocator headers and vector slack, and is only reported with
+// glibc. A last table times a pass over every way's nodes in both layouts.
+//
+// Usage: ./bench_way_storage [-f ../map.osm] [-n passes]
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "bench_util.h"
+#include "../src/model.h"
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// The former Model::Way and Model::Multipolygon.
+struct NestedWay {
+    std::vector<int> nodes;
+};
+
+struct NestedMultipolygon {
+    std::vector<int> outer;
+    std::vector<int> inner;
+};
+
+struct Nested {
+    std::vector<NestedWay> ways;
+    std::vector<NestedMultipolygon> multipolygons;
+};
+
+// Bytes handed out by malloc, or -1 when it cannot be measured.
+static long HeapInUse()
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    malloc_trim(0);
+    return (long)mallinfo2().uordblks;
+#else
+    return -1;
+#endif
+}
+
+static Nested BuildNested(const Model &model)
+{
+    Nested nested;
+    for( auto &way: model.Ways() ) {
+        auto &copy = nested.ways.emplace_back();
+        for( auto node: model.WayNodes(way) )
+            copy.nodes.emplace_back(node);
+    }
+    auto add = [&]( const auto &multipolygons ) {
+        for( const Model::Multipolygon &mp: multipolygons ) {
+            auto &copy = nested.multipolygons.emplace_back();
+            for( auto way: model.Outer(mp) )
+                copy.outer.emplace_back(way);
+            for( auto way: model.Inner(mp) )
+                copy.inner.emplace_back(way);
+        }
+    };
+    add(model.Buildings());
+    add(model.Leisures());
+    add(model.Waters());
+    add(model.Landuses());
+    return nested;
+}
+
+// The flat arrays and the span records as the model holds them.
+struct Flat {
+    std::vector<Model::Way> ways;
+    std::vector<int> way_nodes;
+    std::vector<Model::Multipolygon> multipolygons;
+    std::vector<int> ring_ways;
+};
+
+static Flat CopyFlat(const Model &model)
+{
+    Flat flat;
+    flat.ways = model.Ways();
+    flat.way_nodes = model.WayNodeArray();
+    flat.ring_ways = model.RingWayArray();
+    auto add = [&]( const auto &multipolygons ) {
+        flat.multipolygons.insert(flat.multipolygons.end(), multipolygons.begin(), multipolygons.end());
+    };
+    add(model.Buildings());
+    add(model.Leisures());
+    add(model.Waters());
+    add(model.Landuses());
+    return flat;
+}
+
+static size_t NestedPayload(const Nested &nested)
+{
+    size_t bytes = nested.ways.capacity() * sizeof(NestedWay) +
+                   nested.multipolygons.capacity() * sizeof(NestedMultipolygon);
+    for( auto &way: nested.ways )
+        bytes += way.nodes.capacity() * sizeof(int);
+    for( auto &mp: nested.multipolygons )
+        bytes += (mp.outer.capacity() + mp.inner.capacity()) * sizeof(int);
+    return bytes;
+}
+
+static size_t FlatPayload(const Flat &flat)
+{
+    return flat.ways.capacity() * sizeof(Model::Way) + flat.way_nodes.capacity() * sizeof(int) +
+           flat.multipolygons.capacity() * sizeof(Model::Multipolygon) + flat.ring_ways.capacity() * sizeof(int);
+}
+
+static void Report(const char *name, size_t payload, long heap, size_t allocations)
+{
+    std::printf("%-24s %10.2f MiB payload", name, payload / 1048576.);
+    if( heap >= 0 )
+        std::printf(" %10.2f MiB heap", heap / 1048576.);
+    std::printf(" %10zu allocations\n", allocations);
+}
+
+template <typename Walk>
+static void Time(const char *name, int passes, size_t visits, Walk walk)
+{
+    double sum = 0.;
+    Stopwatch watch;
+    for( int i = 0; i < passes; ++i )
+        sum += walk();
+    auto seconds = watch.Seconds();
+    std::printf("%-24s %10.3f ms/pass %8.2f ns/node   (%.3f)\n",
+                name, seconds * 1e3 / passes, seconds * 1e9 / passes / visits, sum / passes);
+}
+
+int main(int argc, const char **argv)
+{
+    auto osm_data = ReadOSMData(argc, argv);
+    auto passes = std::stoi(Arg(argc, argv, "-n", "20"));
+    Model model{osm_data};
+    osm_data = {};
+
+    const size_t multipolygon_count = model.Buildings().size() + model.Leisures().size() +
+                                      model.Waters().size() + model.Landuses().size();
+    std::printf("%zu ways, %zu way nodes, %zu multipolygons, %zu ring ways\n\n", model.Ways().size(),
+                model.WayNodeArray().size(), multipolygon_count, model.RingWayArray().size());
+
+    long before = HeapInUse();
+    auto nested = BuildNested(model);
+    long nested_heap = before < 0 ? -1 : HeapInUse() - before;
+    size_t nested_allocations = 2;
+    for( auto &way: nested.ways )
+        nested_allocations += way.nodes.empty() ? 0 : 1;
+    for( auto &mp: nested.multipolygons )
+        nested_allocations += (mp.outer.empty() ? 0 : 1) + (mp.inner.empty() ? 0 : 1);
+
+    before = HeapInUse();
+    auto flat = CopyFlat(model);
+    long flat_heap = before < 0 ? -1 : HeapInUse() - before;
+
+    const auto nested_payload = NestedPayload(nested), flat_payload = FlatPayload(flat);
+    Report("vector per way and ring", nested_payload, nested_heap, nested_allocations);
+    Report("flat arrays and spans", flat_payload, flat_heap, 4);
+    std::printf("%-24s %10.2fx payload", "saving", double(nested_payload) / flat_payload);
+    if( nested_heap >= 0 && flat_heap > 0 )
+        std::printf(" %10.2fx heap", double(nested_heap) / flat_heap);
+    std::printf("\n\n");
+
+    const auto xs = model.Nodes().Xs();
+    Time("walk, vector per way", passes, flat.way_nodes.size(), [&] {
+        double sum = 0.;
+        for( auto &way: nested.ways )
+            for( auto node: way.nodes )
+                sum += xs[node];
+        return sum;
+    });
+    Time("walk, flat spans", passes, flat.way_nodes.size(), [&] {
+        double sum = 0.;
+        for( auto &way: model.Ways() )
+            for( auto node: model.WayNodes(way) )
+                sum += xs[node];
+        return sum;
+    });
+}
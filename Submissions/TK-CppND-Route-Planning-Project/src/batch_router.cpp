@@ -0,0 +1,68 @@
+#include "batch_router.h"
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+BatchRouter::BatchRouter(const RouteModel &model, int thread_count, RoutePlanner::Snap snap, int profile)
+    : m_Model(model), snap(snap), profile(profile), pool(thread_count),
+      forward_workspaces(pool.ThreadCount()), backward_workspaces(pool.ThreadCount()) {}
+
+
+void BatchRouter::UseHierarchy(const ContractionHierarchy &hierarchy) {
+    this->hierarchy = &hierarchy;
+}
+
+
+// Snaps the start and end of every query, [2 * i] and [2 * i + 1]. Batches
+// from an origin/destination table repeat the same points many times, so
+// equal coordinates are snapped only once.
+std::vector<RouteModel::EdgePoint> BatchRouter::SnapAll(const std::vector<Query> &queries) {
+    std::vector<std::pair<float, float>> points;
+    points.reserve(queries.size() * 2);
+    for (const Query &query : queries) {
+        points.emplace_back(query.start_x, query.start_y);
+        points.emplace_back(query.end_x, query.end_y);
+    }
+    std::vector<int> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return points[a] < points[b]; });
+
+    // unique[k] is the first point of the k-th run of equal points.
+    std::vector<int> unique, slot(points.size());
+    for (int i : order) {
+        if (unique.empty() || points[unique.back()] != points[i])
+            unique.push_back(i);
+        slot[i] = (int)unique.size() - 1;
+    }
+    std::vector<RouteModel::EdgePoint> snapped(unique.size());
+    pool.ParallelFor((int)unique.size(), [&](int k) {
+        const auto &[x, y] = points[unique[k]];
+        snapped[k] = RoutePlanner::SnapPoint(m_Model, x, y, snap, profile);
+    });
+
+    std::vector<RouteModel::EdgePoint> endpoints(points.size());
+    for (std::size_t i = 0; i < points.size(); i++)
+        endpoints[i] = snapped[slot[i]];
+    return endpoints;
+}
+
+
+std::vector<BatchRouter::Result> BatchRouter::Route(const std::vector<Query> &queries, bool with_paths) {
+    const std::vector<RouteModel::EdgePoint> endpoints = SnapAll(queries);
+    std::vector<Result> results(queries.size());
+    pool.ParallelFor((int)queries.size(), [&](int i, int thread) {
+        RoutePlanner planner{m_Model, forward_workspaces[thread], endpoints[2 * i], endpoints[2 * i + 1], snap, profile};
+        if (hierarchy != nullptr)
+            planner.ContractionHierarchySearch(*hierarchy, backward_workspaces[thread]);
+        else
+            planner.AStarSearch();
+
+        Result &result = results[i];
+        result.settled = planner.GetExpandedNodes();
+        if (!planner.GetPath().Empty())
+            result.distance = planner.GetDistance();
+        if (with_paths)
+            result.path = planner.GetPath();
+    });
+    return results;
+}
@@ -0,0 +1,55 @@
+#ifndef BATCH_ROUTER_H
+#define BATCH_ROUTER_H
+
+#include <vector>
+#include "route_model.h"
+#include "route_path.h"
+#include "route_planner.h"
+#include "search_workspace.h"
+#include "thread_pool.h"
+
+// Routes many start/end pairs against one shared RouteModel. Every distinct
+// coordinate of a batch is snapped once, then the queries are spread over a
+// fixed pool of threads, each reusing its own search workspaces. The model is
+// only read, so any number of routers may share it.
+class BatchRouter {
+  public:
+    // A start/end pair in the percent coordinates taken by RoutePlanner.
+    struct Query {
+        float start_x, start_y, end_x, end_y;
+    };
+    struct Result {
+        // Metres, SearchWorkspace::kInfinity when the end cannot be reached.
+        float distance = SearchWorkspace::kInfinity;
+        int settled = 0;
+        // Only filled when paths are asked for.
+        RoutePath path;
+    };
+
+    // 0 threads uses one per hardware core.
+    explicit BatchRouter(const RouteModel &model, int thread_count = 0, RoutePlanner::Snap snap = RoutePlanner::Snap::ToEdge,
+                         int profile = RouteModel::kDefaultProfile);
+
+    // Answers the queries from a hierarchy built over the profile's road graph
+    // instead of with A*. The hierarchy must outlive the router.
+    void UseHierarchy(const ContractionHierarchy &hierarchy);
+
+    // Results come back in the order of the queries.
+    std::vector<Result> Route(const std::vector<Query> &queries, bool with_paths = false);
+
+    int ThreadCount() const { return pool.ThreadCount(); }
+
+  private:
+    std::vector<RouteModel::EdgePoint> SnapAll(const std::vector<Query> &queries);
+
+    const RouteModel &m_Model;
+    const RoutePlanner::Snap snap;
+    const int profile;
+    const ContractionHierarchy *hierarchy = nullptr;
+    ThreadPool pool;
+    // One pair per thread slot of the pool.
+    std::vector<SearchWorkspace> forward_workspaces;
+    std::vector<SearchWorkspace> backward_workspaces;
+};
+
+#endif
@@ -0,0 +1,339 @@
+#include "contraction_hierarchy.h"
+#include <algorithm>
+#include <stdexcept>
+#include "graph_cache.h"
+#include "indexed_heap.h"
+#include "route_model.h"
+
+namespace {
+
+// Witness searches give up after this many settled nodes. A search cut short
+// only costs a shortcut that was not needed, never a wrong answer.
+constexpr int kWitnessSettleLimit = 150;
+
+struct DynamicEdge {
+    int to;
+    float weight;
+    int middle;
+};
+
+// The graph while it is being contracted: both directions of every remaining
+// edge, with edges to contracted nodes removed as they go.
+class Contraction {
+  public:
+    explicit Contraction(const Graph &graph)
+        : out(graph.NodeCount()), in(graph.NodeCount()), contracted_neighbors(graph.NodeCount(), 0), witness(graph.NodeCount()),
+          target_search(graph.NodeCount(), 0) {
+        for (int from = 0; from < graph.NodeCount(); from++)
+            for (const Graph::Edge &edge : graph.Edges(from)) {
+                out[from].push_back({edge.to, edge.weight, -1});
+                in[edge.to].push_back({from, edge.weight, -1});
+            }
+    }
+
+    // Edge difference of `node` plus the number of its neighbours already
+    // contracted. The shortcuts it would need are kept for Contract.
+    float Priority(int node) {
+        Simulate(node);
+        const int removed = (int)(in[node].size() + out[node].size());
+        return float((int)shortcuts.size() - removed + contracted_neighbors[node]);
+    }
+
+    // Removes `node` from the graph, adding the shortcuts it needs. Its
+    // remaining edges all lead to nodes contracted later, so they become its
+    // upward edges in the hierarchy.
+    void Contract(int node, std::vector<ContractionHierarchy::Edge> &upward) {
+        if (simulated != node)
+            Simulate(node);
+
+        upward.clear();
+        for (const DynamicEdge &edge : out[node])
+            upward.push_back({edge.to, edge.weight, edge.middle, ContractionHierarchy::kForward});
+        for (const DynamicEdge &edge : in[node])
+            upward.push_back({edge.to, edge.weight, edge.middle, ContractionHierarchy::kBackward});
+
+        for (const DynamicEdge &edge : out[node]) {
+            Erase(in[edge.to], node);
+            contracted_neighbors[edge.to]++;
+        }
+        for (const DynamicEdge &edge : in[node]) {
+            Erase(out[edge.to], node);
+            contracted_neighbors[edge.to]++;
+        }
+        for (const Graph::Arc &shortcut : shortcuts) {
+            AddOrLower(out[shortcut.from], {shortcut.to, shortcut.weight, node});
+            AddOrLower(in[shortcut.to], {shortcut.from, shortcut.weight, node});
+        }
+        simulated = -1;
+    }
+
+    void ReleaseEdges(int node) {
+        std::vector<DynamicEdge>().swap(out[node]);
+        std::vector<DynamicEdge>().swap(in[node]);
+    }
+
+  private:
+    // Finds the shortcuts contracting `node` would add right now: one for
+    // every pair of neighbours u -> node -> w without a witness path from u to
+    // w that avoids `node` and is no longer.
+    void Simulate(int node) {
+        shortcuts.clear();
+        simulated = node;
+        for (const DynamicEdge &incoming : in[node]) {
+            float limit = 0.0f;
+            int targets = 0;
+            search++;
+            for (const DynamicEdge &outgoing : out[node])
+                if (outgoing.to != incoming.to) {
+                    limit = std::max(limit, incoming.weight + outgoing.weight);
+                    target_search[outgoing.to] = search;
+                    targets++;
+                }
+            if (targets == 0)
+                continue;
+            WitnessSearch(incoming.to, node, limit, targets);
+            for (const DynamicEdge &outgoing : out[node]) {
+                const float via = incoming.weight + outgoing.weight;
+                if (outgoing.to != incoming.to && witness.GValue(outgoing.to) > via)
+                    shortcuts.push_back({incoming.to, outgoing.to, via});
+            }
+        }
+    }
+
+    // Dijkstra from `source` that avoids `skipped` and stops beyond `limit` or
+    // once the `targets` nodes marked for this search are settled.
+    void WitnessSearch(int source, int skipped, float limit, int targets) {
+        witness.Reset((int)out.size());
+        witness.Reach(source, 0.0f, 0.0f, -1);
+        witness.OpenList().Push(source, 0.0f);
+        int settled = 0;
+        while (!witness.OpenList().Empty() && settled++ < kWitnessSettleLimit) {
+            const int current = witness.OpenList().Pop();
+            witness.Close(current);
+            if (target_search[current] == search && --targets == 0)
+                break;
+            const float current_g_value = witness.GValue(current);
+            for (const DynamicEdge &edge : out[current]) {
+                if (edge.to == skipped || witness.Closed(edge.to))
+                    continue;
+                const float g_value = current_g_value + edge.weight;
+                if (g_value > limit)
+                    continue;
+                if (!witness.Reached(edge.to)) {
+                    witness.Reach(edge.to, g_value, 0.0f, current);
+                    witness.OpenList().Push(edge.to, g_value);
+                }
+                else if (g_value < witness.GValue(edge.to)) {
+                    witness.Relax(edge.to, g_value, current);
+                    witness.OpenList().DecreaseKey(edge.to, g_value);
+                }
+            }
+        }
+    }
+
+    static void Erase(std::vector<DynamicEdge> &edges, int node) {
+        edges.erase(std::remove_if(edges.begin(), edges.end(), [node](const DynamicEdge &edge) { return edge.to == node; }),
+                    edges.end());
+    }
+
+    static void AddOrLower(std::vector<DynamicEdge> &edges, DynamicEdge added) {
+        for (DynamicEdge &edge : edges)
+            if (edge.to == added.to) {
+                if (added.weight < edge.weight)
+                    edge = added;
+                return;
+            }
+        edges.push_back(added);
+    }
+
+    std::vector<std::vector<DynamicEdge>> out;
+    std::vector<std::vector<DynamicEdge>> in;
+    std::vector<int> contracted_neighbors;
+    SearchWorkspace witness;
+    // Witness search that each node was last a target of.
+    std::vector<int> target_search;
+    int search = 0;
+    // Shortcuts found by the last simulation, and the node it was for.
+    std::vector<Graph::Arc> shortcuts;
+    int simulated = -1;
+};
+
+}
+
+ContractionHierarchy::ContractionHierarchy(const Graph &graph) {
+    const int node_count = graph.NodeCount();
+    Contraction contraction{graph};
+    IndexedHeap<4> queue{node_count};
+    for (int node = 0; node < node_count; node++)
+        queue.Push(node, contraction.Priority(node));
+
+    // Upward edges are collected per node and packed in CSR form at the end.
+    std::vector<std::vector<Edge>> upward(node_count);
+    ranks.assign(node_count, -1);
+    int rank = 0;
+    while (!queue.Empty()) {
+        // Lazy update: priorities go stale as neighbours are contracted, so
+        // the top is recomputed and requeued if it is no longer the minimum.
+        const int node = queue.Pop();
+        const float priority = contraction.Priority(node);
+        if (!queue.Empty() && priority > queue.MinKey()) {
+            queue.Push(node, priority);
+            continue;
+        }
+        contraction.Contract(node, upward[node]);
+        ranks[node] = rank++;
+        contraction.ReleaseEdges(node);
+    }
+
+    offsets.assign(1, 0);
+    for (int node = 0; node < node_count; node++) {
+        edges.insert(edges.end(), upward[node].begin(), upward[node].end());
+        offsets.push_back((int)edges.size());
+    }
+}
+
+
+ContractionHierarchy::ContractionHierarchy(const RouteModel &model, int profile)
+    : ContractionHierarchy(model.RoadGraph(profile)) {
+    this->profile = profile;
+    graph_version = model.GraphVersion();
+}
+
+
+// A restored model starts again at graph version 0, and so does its hierarchy:
+// GraphCache::Save only takes one built for the model's current graphs.
+ContractionHierarchy::ContractionHierarchy(const GraphCache &cache)
+    : ranks(cache.Read<int>(GraphCache::HierarchyRanks)),
+      offsets(cache.Read<int>(GraphCache::HierarchyOffsets)),
+      edges(cache.Read<Edge>(GraphCache::HierarchyEdges)) {
+    const std::vector<int> profiles = cache.Read<int>(GraphCache::HierarchyProfile);
+    const int node_count = NodeCount();
+    bool valid = (int)offsets.size() == node_count + 1 && offsets.front() == 0 && offsets.back() == EdgeCount() &&
+                 profiles.size() == 1 && profiles[0] >= 0 && profiles[0] < (int)GraphCache::kProfileCount;
+    for (int node = 0; valid && node < node_count; node++)
+        valid = offsets[node] <= offsets[node + 1] && ranks[node] >= 0 && ranks[node] < node_count;
+    for (const Edge &edge : edges)
+        valid = valid && edge.to >= 0 && edge.to < node_count && edge.middle >= -1 && edge.middle < node_count &&
+                (edge.direction == kForward || edge.direction == kBackward);
+    if (!valid)
+        throw std::logic_error("graph cache holds no valid contraction hierarchy");
+    profile = profiles[0];
+}
+
+
+int ContractionHierarchy::ShortcutCount() const {
+    return (int)std::count_if(edges.begin(), edges.end(), [](const Edge &edge) { return edge.middle >= 0; });
+}
+
+
+ContractionHierarchy::Result ContractionHierarchy::Query(const std::vector<Seed> &sources, const std::vector<Seed> &targets,
+                                                         SearchWorkspace &forward, SearchWorkspace &backward) const {
+    Result result;
+    forward.Reset(NodeCount());
+    backward.Reset(NodeCount());
+    auto seed = [](SearchWorkspace &side, const Seed &seed) {
+        if (!side.Reached(seed.node)) {
+            side.Reach(seed.node, seed.distance, 0.0f, -1);
+            side.OpenList().Push(seed.node, seed.distance);
+        }
+        else if (seed.distance < side.GValue(seed.node)) {
+            side.Relax(seed.node, seed.distance, -1);
+            side.OpenList().DecreaseKey(seed.node, seed.distance);
+        }
+    };
+    for (const Seed &source : sources)
+        seed(forward, source);
+    for (const Seed &target : targets)
+        seed(backward, target);
+
+    // Both searches only climb, so the shortest path is found where they meet
+    // at its highest node. Each side stops once its next key reaches the best
+    // path seen, as no path through an unsettled node can be shorter.
+    int meeting = -1;
+    auto step = [&](SearchWorkspace &side, const SearchWorkspace &other, int direction) {
+        const int current = side.OpenList().Pop();
+        side.Close(current);
+        result.settled++;
+        const float current_g_value = side.GValue(current);
+        if (other.Reached(current) && current_g_value + other.GValue(current) < result.distance) {
+            result.distance = current_g_value + other.GValue(current);
+            meeting = current;
+        }
+        // Stall on demand: a node reached more cheaply from above than its
+        // own label cannot be on a shortest path, so it is not expanded.
+        for (int i = offsets[current]; i < offsets[current + 1]; i++) {
+            const Edge &edge = edges[i];
+            if (edge.direction != direction && side.GValue(edge.to) + edge.weight < current_g_value)
+                return;
+        }
+        for (int i = offsets[current]; i < offsets[current + 1]; i++) {
+            const Edge &edge = edges[i];
+            if (edge.direction != direction || side.Closed(edge.to))
+                continue;
+            const float g_value = current_g_value + edge.weight;
+            if (!side.Reached(edge.to)) {
+                side.Reach(edge.to, g_value, 0.0f, current);
+                side.OpenList().Push(edge.to, g_value);
+            }
+            else if (g_value < side.GValue(edge.to)) {
+                side.Relax(edge.to, g_value, current);
+                side.OpenList().DecreaseKey(edge.to, g_value);
+            }
+        }
+    };
+    while (true) {
+        const bool forward_open = !forward.OpenList().Empty() && forward.OpenList().MinKey() < result.distance;
+        const bool backward_open = !backward.OpenList().Empty() && backward.OpenList().MinKey() < result.distance;
+        if (forward_open && (!backward_open || forward.OpenList().MinKey() <= backward.OpenList().MinKey()))
+            step(forward, backward, kForward);
+        else if (backward_open)
+            step(backward, forward, kBackward);
+        else
+            break;
+    }
+    if (meeting < 0)
+        return result;
+
+    // The forward labels lead from the meeting node back to a source, the
+    // backward labels from it on to a target.
+    std::vector<int> upward;
+    for (int node = meeting; node != -1; node = forward.Parent(node))
+        upward.push_back(node);
+    std::reverse(upward.begin(), upward.end());
+    for (int node = backward.Parent(meeting); node != -1; node = backward.Parent(node))
+        upward.push_back(node);
+
+    result.nodes.push_back(upward.front());
+    for (std::size_t i = 1; i < upward.size(); i++)
+        Unpack(upward[i - 1], upward[i], result.nodes);
+    return result;
+}
+
+
+void ContractionHierarchy::Unpack(int from, int to, std::vector<int> &nodes) const {
+    std::vector<std::pair<int, int>> stack{{from, to}};
+    while (!stack.empty()) {
+        auto [first, second] = stack.back();
+        stack.pop_back();
+        const Edge *edge = FindEdge(first, second);
+        if (edge->middle < 0) {
+            nodes.push_back(second);
+        }
+        else {
+            stack.emplace_back(edge->middle, second);
+            stack.emplace_back(first, edge->middle);
+        }
+    }
+}
+
+
+// Finds the edge from -> to, which is stored at whichever end ranks lower.
+const ContractionHierarchy::Edge *ContractionHierarchy::FindEdge(int from, int to) const {
+    const bool upward = ranks[from] < ranks[to];
+    const int lower = upward ? from : to, higher = upward ? to : from;
+    const int direction = upward ? kForward : kBackward;
+    for (int i = offsets[lower]; i < offsets[lower + 1]; i++)
+        if (edges[i].to == higher && edges[i].direction == direction)
+            return &edges[i];
+    throw std::logic_error("contraction hierarchy is missing an edge it refers to");
+}
@@ -0,0 +1,88 @@
+#ifndef CONTRACTION_HIERARCHY_H
+#define CONTRACTION_HIERARCHY_H
+
+#include <cstdint>
+#include <vector>
+#include "graph.h"
+#include "search_workspace.h"
+
+class GraphCache;
+class RouteModel;
+
+// Contraction Hierarchy over a road Graph. Preprocessing removes the nodes one
+// by one, least important first, and adds a shortcut wherever removing a node
+// would lengthen a shortest path between two of its neighbours. A query then
+// only has to search upwards in that order from both ends: a bidirectional
+// Dijkstra that settles a few hundred nodes where a plain search walks the
+// whole city. Shortcuts remember the node they bypass, so a path found in the
+// hierarchy unpacks back into the original road segments.
+//
+// Importance is the edge difference (shortcuts added minus edges removed)
+// plus the number of neighbours already contracted, which keeps the removal
+// spread evenly over the map. Priorities are updated lazily.
+class ContractionHierarchy {
+  public:
+    enum Direction : int {
+        kForward = 1,   // the edge runs from the node it is stored at to `to`
+        kBackward = 2,  // the edge runs from `to` to the node it is stored at
+    };
+
+    // Edge to a node of higher rank, stored at its lower end.
+    struct Edge {
+        int to;
+        float weight;
+        int middle;     // node a shortcut bypasses, -1 for an edge of the graph
+        int direction;  // kForward or kBackward
+    };
+
+    // Where a query enters or leaves the graph, and the distance to get there.
+    struct Seed {
+        int node;
+        float distance;
+    };
+
+    struct Result {
+        std::vector<int> nodes;  // unpacked path, empty when there is none
+        float distance = SearchWorkspace::kInfinity;
+        int settled = 0;
+    };
+
+    ContractionHierarchy() {}
+    explicit ContractionHierarchy(const Graph &graph);
+    // Contracts the graph of one profile of `model`, remembering the profile
+    // and the RouteModel::GraphVersion it was built for.
+    ContractionHierarchy(const RouteModel &model, int profile);
+    // Restores a hierarchy saved with GraphCache::Save, for the RouteModel
+    // restored from the same cache.
+    explicit ContractionHierarchy(const GraphCache &cache);
+
+    // Shortest path from any source to any target.
+    Result Query(const std::vector<Seed> &sources, const std::vector<Seed> &targets,
+                 SearchWorkspace &forward, SearchWorkspace &backward) const;
+
+    int NodeCount() const { return (int)ranks.size(); }
+    int EdgeCount() const { return (int)edges.size(); }
+    int ShortcutCount() const;
+    // Position of each node in the contraction order.
+    const std::vector<int> &Ranks() const { return ranks; }
+    const std::vector<int> &Offsets() const { return offsets; }
+    const std::vector<Edge> &EdgeArray() const { return edges; }
+    // Profile and graph version the hierarchy was built for; -1 and 0 for one
+    // built from a bare Graph.
+    int Profile() const { return profile; }
+    std::uint64_t GraphVersion() const { return graph_version; }
+
+  private:
+    // Appends the graph edges that the hierarchy edge from -> to stands for,
+    // leaving out `from` itself.
+    void Unpack(int from, int to, std::vector<int> &nodes) const;
+    const Edge *FindEdge(int from, int to) const;
+
+    std::vector<int> ranks;
+    std::vector<int> offsets;
+    std::vector<Edge> edges;
+    int profile = -1;
+    std::uint64_t graph_version = 0;
+};
+
+#endif
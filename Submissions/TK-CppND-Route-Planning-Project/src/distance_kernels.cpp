@@ -0,0 +1,281 @@
+#include "distance_kernels.h"
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+// The SIMD versions are compiled for their instruction set through target
+// attributes, so the rest of the build keeps its baseline flags and the
+// choice is made at run time.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define DISTANCE_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+static constexpr float kInfinity = std::numeric_limits<float>::infinity();
+
+struct Kernels {
+    SimdLevel level;
+    void (*gather_distances)(const float *, const float *, const int *, int, float, float, float *);
+    void (*squared_distances)(const float *, const float *, int, float, float, float *);
+    int (*nearest_point)(const float *, const float *, int, float, float, float &);
+};
+
+
+static void GatherDistancesScalar(const float *xs, const float *ys, const int *indices, int count, float x, float y, float *out) {
+    for (int i = 0; i < count; i++) {
+        float dx = xs[indices[i]] - x, dy = ys[indices[i]] - y;
+        out[i] = std::sqrt(dx * dx + dy * dy);
+    }
+}
+
+
+static void SquaredDistancesScalar(const float *xs, const float *ys, int count, float x, float y, float *out) {
+    for (int i = 0; i < count; i++) {
+        float dx = xs[i] - x, dy = ys[i] - y;
+        out[i] = dx * dx + dy * dy;
+    }
+}
+
+
+// Continues a scan whose best point so far is `nearest` at `best`.
+static int NearestPointScalar(const float *xs, const float *ys, int first, int count, float x, float y, int nearest,
+                              float &best) {
+    for (int i = first; i < count; i++) {
+        float dx = xs[i] - x, dy = ys[i] - y;
+        if (float d2 = dx * dx + dy * dy; d2 < best) {
+            best = d2;
+            nearest = i;
+        }
+    }
+    return nearest;
+}
+
+
+static int NearestPointScalar(const float *xs, const float *ys, int count, float x, float y, float &distance2) {
+    distance2 = kInfinity;
+    return NearestPointScalar(xs, ys, 0, count, x, y, -1, distance2);
+}
+
+
+// Picks the closest of `width` per-lane candidates, the lowest index on ties.
+static int ReduceLanes(const float *best, const int *nearest, int width, float &distance2) {
+    int index = -1;
+    distance2 = kInfinity;
+    for (int lane = 0; lane < width; lane++)
+        if (nearest[lane] >= 0 && (best[lane] < distance2 || (best[lane] == distance2 && nearest[lane] < index))) {
+            distance2 = best[lane];
+            index = nearest[lane];
+        }
+    return index;
+}
+
+
+#ifdef DISTANCE_KERNELS_X86
+
+__attribute__((target("sse2"))) static inline __m128 Squared(__m128 px, __m128 py, __m128 x, __m128 y) {
+    __m128 dx = _mm_sub_ps(px, x), dy = _mm_sub_ps(py, y);
+    return _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+}
+
+
+__attribute__((target("sse2")))
+static void GatherDistancesSSE2(const float *xs, const float *ys, const int *indices, int count, float x, float y, float *out) {
+    const __m128 vx = _mm_set1_ps(x), vy = _mm_set1_ps(y);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const int *index = indices + i;
+        __m128 px = _mm_setr_ps(xs[index[0]], xs[index[1]], xs[index[2]], xs[index[3]]);
+        __m128 py = _mm_setr_ps(ys[index[0]], ys[index[1]], ys[index[2]], ys[index[3]]);
+        _mm_storeu_ps(out + i, _mm_sqrt_ps(Squared(px, py, vx, vy)));
+    }
+    GatherDistancesScalar(xs, ys, indices + i, count - i, x, y, out + i);
+}
+
+
+__attribute__((target("sse2")))
+static void SquaredDistancesSSE2(const float *xs, const float *ys, int count, float x, float y, float *out) {
+    const __m128 vx = _mm_set1_ps(x), vy = _mm_set1_ps(y);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(out + i, Squared(_mm_loadu_ps(xs + i), _mm_loadu_ps(ys + i), vx, vy));
+    SquaredDistancesScalar(xs + i, ys + i, count - i, x, y, out + i);
+}
+
+
+__attribute__((target("sse2")))
+static int NearestPointSSE2(const float *xs, const float *ys, int count, float x, float y, float &distance2) {
+    if (count < 4)
+        return NearestPointScalar(xs, ys, count, x, y, distance2);
+    const __m128 vx = _mm_set1_ps(x), vy = _mm_set1_ps(y);
+    __m128 best = _mm_set1_ps(kInfinity);
+    __m128i nearest = _mm_set1_epi32(-1), lane = _mm_setr_epi32(0, 1, 2, 3);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 d2 = Squared(_mm_loadu_ps(xs + i), _mm_loadu_ps(ys + i), vx, vy);
+        __m128i closer = _mm_castps_si128(_mm_cmplt_ps(d2, best));
+        best = _mm_min_ps(d2, best);
+        nearest = _mm_or_si128(_mm_and_si128(closer, lane), _mm_andnot_si128(closer, nearest));
+        lane = _mm_add_epi32(lane, _mm_set1_epi32(4));
+    }
+    alignas(16) float lane_best[4];
+    alignas(16) int lane_nearest[4];
+    _mm_store_ps(lane_best, best);
+    _mm_store_si128((__m128i *)lane_nearest, nearest);
+    int index = ReduceLanes(lane_best, lane_nearest, 4, distance2);
+    return NearestPointScalar(xs, ys, i, count, x, y, index, distance2);
+}
+
+
+__attribute__((target("avx2"))) static inline __m256 Squared(__m256 px, __m256 py, __m256 x, __m256 y) {
+    __m256 dx = _mm256_sub_ps(px, x), dy = _mm256_sub_ps(py, y);
+    return _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+}
+
+
+// Lanes below `remaining` set, for the last, partial block of a batch.
+__attribute__((target("avx2"))) static inline __m256i TailMask(int remaining) {
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(remaining), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+
+// The coordinates are loaded one by one: vgatherdps is no faster on most
+// CPUs and much slower on Intel ones with the Downfall microcode update.
+// Neighbor lists are mostly shorter than 8, so the rest of a batch goes
+// through the SSE2 version.
+__attribute__((target("avx2")))
+static void GatherDistancesAVX2(const float *xs, const float *ys, const int *indices, int count, float x, float y, float *out) {
+    const __m256 vx = _mm256_set1_ps(x), vy = _mm256_set1_ps(y);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const int *index = indices + i;
+        __m256 px = _mm256_setr_ps(xs[index[0]], xs[index[1]], xs[index[2]], xs[index[3]],
+                                   xs[index[4]], xs[index[5]], xs[index[6]], xs[index[7]]);
+        __m256 py = _mm256_setr_ps(ys[index[0]], ys[index[1]], ys[index[2]], ys[index[3]],
+                                   ys[index[4]], ys[index[5]], ys[index[6]], ys[index[7]]);
+        _mm256_storeu_ps(out + i, _mm256_sqrt_ps(Squared(px, py, vx, vy)));
+    }
+    GatherDistancesSSE2(xs, ys, indices + i, count - i, x, y, out + i);
+}
+
+
+__attribute__((target("avx2")))
+static void SquaredDistancesAVX2(const float *xs, const float *ys, int count, float x, float y, float *out) {
+    const __m256 vx = _mm256_set1_ps(x), vy = _mm256_set1_ps(y);
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(out + i, Squared(_mm256_loadu_ps(xs + i), _mm256_loadu_ps(ys + i), vx, vy));
+    if (i < count) {
+        const __m256i mask = TailMask(count - i);
+        __m256 px = _mm256_maskload_ps(xs + i, mask), py = _mm256_maskload_ps(ys + i, mask);
+        _mm256_maskstore_ps(out + i, mask, Squared(px, py, vx, vy));
+    }
+}
+
+
+// The partial last block is loaded under a mask and its missing lanes are
+// kept at infinity, so leaves of a k-d tree take a single pass.
+__attribute__((target("avx2")))
+static int NearestPointAVX2(const float *xs, const float *ys, int count, float x, float y, float &distance2) {
+    const __m256 vx = _mm256_set1_ps(x), vy = _mm256_set1_ps(y), infinity = _mm256_set1_ps(kInfinity);
+    __m256 best = infinity;
+    __m256i nearest = _mm256_set1_epi32(-1), lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for (int i = 0; i < count; i += 8) {
+        __m256 d2;
+        if (i + 8 <= count)
+            d2 = Squared(_mm256_loadu_ps(xs + i), _mm256_loadu_ps(ys + i), vx, vy);
+        else {
+            const __m256i mask = TailMask(count - i);
+            d2 = Squared(_mm256_maskload_ps(xs + i, mask), _mm256_maskload_ps(ys + i, mask), vx, vy);
+            d2 = _mm256_blendv_ps(infinity, d2, _mm256_castsi256_ps(mask));
+        }
+        __m256 closer = _mm256_cmp_ps(d2, best, _CMP_LT_OQ);
+        best = _mm256_blendv_ps(best, d2, closer);
+        nearest = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(nearest), _mm256_castsi256_ps(lane), closer));
+        lane = _mm256_add_epi32(lane, _mm256_set1_epi32(8));
+    }
+    alignas(32) float lane_best[8];
+    alignas(32) int lane_nearest[8];
+    _mm256_store_ps(lane_best, best);
+    _mm256_store_si256((__m256i *)lane_nearest, nearest);
+    return ReduceLanes(lane_best, lane_nearest, 8, distance2);
+}
+
+#endif
+
+
+static const Kernels kScalar{SimdLevel::Scalar, GatherDistancesScalar, SquaredDistancesScalar, NearestPointScalar};
+#ifdef DISTANCE_KERNELS_X86
+static const Kernels kSSE2{SimdLevel::SSE2, GatherDistancesSSE2, SquaredDistancesSSE2, NearestPointSSE2};
+static const Kernels kAVX2{SimdLevel::AVX2, GatherDistancesAVX2, SquaredDistancesAVX2, NearestPointAVX2};
+#endif
+
+static std::atomic<const Kernels *> active_kernels{nullptr};
+
+
+static const Kernels &KernelsFor(SimdLevel level) {
+#ifdef DISTANCE_KERNELS_X86
+    if (level == SimdLevel::AVX2)
+        return kAVX2;
+    if (level == SimdLevel::SSE2)
+        return kSSE2;
+#endif
+    return kScalar;
+}
+
+
+static const Kernels &Active() {
+    const Kernels *kernels = active_kernels.load(std::memory_order_relaxed);
+    if (kernels == nullptr) {
+        kernels = &KernelsFor(SupportedSimdLevel());
+        active_kernels.store(kernels, std::memory_order_relaxed);
+    }
+    return *kernels;
+}
+
+
+SimdLevel SupportedSimdLevel() {
+#ifdef DISTANCE_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+
+SimdLevel ActiveSimdLevel() {
+    return Active().level;
+}
+
+
+void SelectSimdLevel(SimdLevel level) {
+    if (level > SupportedSimdLevel())
+        level = SupportedSimdLevel();
+    active_kernels.store(&KernelsFor(level), std::memory_order_relaxed);
+}
+
+
+const char *SimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::SSE2: return "sse2";
+        default:              return "scalar";
+    }
+}
+
+
+void GatherDistances(const float *xs, const float *ys, const int *indices, int count, float x, float y, float *out) {
+    Active().gather_distances(xs, ys, indices, count, x, y, out);
+}
+
+
+void SquaredDistances(const float *xs, const float *ys, int count, float x, float y, float *out) {
+    Active().squared_distances(xs, ys, count, x, y, out);
+}
+
+
+int NearestPoint(const float *xs, const float *ys, int count, float x, float y, float &distance2) {
+    return Active().nearest_point(xs, ys, count, x, y, distance2);
+}
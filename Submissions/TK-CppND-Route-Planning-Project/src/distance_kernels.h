@@ -0,0 +1,32 @@
+#ifndef DISTANCE_KERNELS_H
+#define DISTANCE_KERNELS_H
+
+// Straight-line distances from one point to many, over coordinates kept as
+// separate x and y float arrays like Model::NodeStore. Every kernel has a
+// scalar, an SSE2 and an AVX2 version; the widest one the CPU supports is
+// picked at the first call. The versions round each operation the same way,
+// so they return the same results.
+
+enum class SimdLevel { Scalar, SSE2, AVX2 };
+
+// The widest level this CPU and compiler support.
+SimdLevel SupportedSimdLevel();
+// The level the kernels below run at.
+SimdLevel ActiveSimdLevel();
+// Runs the kernels at `level`, or at SupportedSimdLevel() if that is narrower.
+// Meant for tests and benchmarks.
+void SelectSimdLevel(SimdLevel level);
+const char *SimdLevelName(SimdLevel level);
+
+// out[i] = distance from (x, y) to point indices[i], for i < count.
+void GatherDistances(const float *xs, const float *ys, const int *indices, int count, float x, float y, float *out);
+
+// out[i] = squared distance from (x, y) to point i, for i < count.
+void SquaredDistances(const float *xs, const float *ys, int count, float x, float y, float *out);
+
+// Index of the point closest to (x, y) among the first `count`, the lowest one
+// on ties, and its squared distance in `distance2`. Returns -1 and an infinite
+// distance if count is 0.
+int NearestPoint(const float *xs, const float *ys, int count, float x, float y, float &distance2);
+
+#endif
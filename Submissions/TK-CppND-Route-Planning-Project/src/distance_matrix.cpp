@@ -0,0 +1,108 @@
+#include "distance_matrix.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+DistanceMatrix::DistanceMatrix(const RouteModel &model, int thread_count, RoutePlanner::Snap snap, int profile)
+    : m_Model(model), snap(snap), profile(profile), pool(thread_count), workspaces(pool.ThreadCount()) {}
+
+
+std::vector<RouteModel::EdgePoint> DistanceMatrix::SnapAll(const std::vector<Point> &points) {
+    std::vector<RouteModel::EdgePoint> snapped(points.size());
+    pool.ParallelFor((int)points.size(), [&](int i) {
+        snapped[i] = RoutePlanner::SnapPoint(m_Model, points[i].x, points[i].y, snap, profile);
+    });
+    return snapped;
+}
+
+
+DistanceMatrix::Table DistanceMatrix::Compute(const std::vector<Point> &sources, const std::vector<Point> &targets) {
+    const std::vector<RouteModel::EdgePoint> source_points = SnapAll(sources);
+    const std::vector<RouteModel::EdgePoint> target_points = SnapAll(targets);
+    Table table;
+    table.rows = (int)sources.size();
+    table.columns = (int)targets.size();
+    table.values.assign(std::size_t(table.rows) * table.columns, SearchWorkspace::kInfinity);
+    settled_nodes = 0;
+
+    // A point snapped to a segment is reached through either end, so a sweep
+    // is done once the ends of all target segments are settled. With
+    // Snap::ToNode both ends are the target node itself.
+    const int node_count = (int)m_Model.SNodes().size();
+    std::vector<char> is_target(node_count, 0);
+    int target_nodes = 0;
+    std::vector<float> target_lengths(table.columns);
+    for (int column = 0; column < table.columns; column++) {
+        const RouteModel::EdgePoint &target = target_points[column];
+        for (int node : {target.from, target.to})
+            if (!is_target[node]) {
+                is_target[node] = 1;
+                target_nodes++;
+            }
+        target_lengths[column] = m_Model.SegmentWeight(target.from, target.to, profile);
+    }
+
+    const float scale = m_Model.WeightScale(profile);
+    const Graph &graph = m_Model.RoadGraph(profile);
+    std::atomic<long> settled{0};
+    pool.ParallelFor(table.rows, [&](int row, int thread) {
+        SearchWorkspace &workspace = workspaces[thread];
+        workspace.Reset(node_count);
+        const RouteModel::EdgePoint &source = source_points[row];
+        const float source_length = m_Model.SegmentWeight(source.from, source.to, profile);
+        auto seed = [&](int node, float g_value) {
+            if (!workspace.Reached(node)) {
+                workspace.Reach(node, g_value, 0.0f, -1);
+                workspace.OpenList().Push(node, g_value);
+            }
+            else if (g_value < workspace.GValue(node)) {
+                workspace.Relax(node, g_value, -1);
+                workspace.OpenList().DecreaseKey(node, g_value);
+            }
+        };
+        seed(source.from, source.t * source_length);
+        seed(source.to, (1.0f - source.t) * source_length);
+
+        int remaining = target_nodes;
+        long row_settled = 0;
+        while (remaining > 0 && !workspace.OpenList().Empty()) {
+            const int current = workspace.OpenList().Pop();
+            workspace.Close(current);
+            row_settled++;
+            if (is_target[current])
+                remaining--;
+            const float current_g_value = workspace.GValue(current);
+            for (const Graph::Edge &edge : graph.Edges(current)) {
+                if (workspace.Closed(edge.to))
+                    continue;
+                const float g_value = current_g_value + edge.weight;
+                if (!workspace.Reached(edge.to)) {
+                    workspace.Reach(edge.to, g_value, 0.0f, current);
+                    workspace.OpenList().Push(edge.to, g_value);
+                }
+                else if (g_value < workspace.GValue(edge.to)) {
+                    workspace.Relax(edge.to, g_value, current);
+                    workspace.OpenList().DecreaseKey(edge.to, g_value);
+                }
+            }
+        }
+        settled += row_settled;
+
+        // Nodes left unsettled are unreachable: GValue is only final once closed.
+        auto settled_g_value = [&](int node) {
+            return workspace.Closed(node) ? workspace.GValue(node) : SearchWorkspace::kInfinity;
+        };
+        float *values = table.values.data() + std::size_t(row) * table.columns;
+        for (int column = 0; column < table.columns; column++) {
+            const RouteModel::EdgePoint &target = target_points[column];
+            const float length = target_lengths[column];
+            float best = std::min(settled_g_value(target.from) + target.t * length,
+                                  settled_g_value(target.to) + (1.0f - target.t) * length);
+            if (source.from == target.from && source.to == target.to)
+                best = std::min(best, std::abs(source.t - target.t) * length);
+            values[column] = best == SearchWorkspace::kInfinity ? best : best * scale;
+        }
+    });
+    settled_nodes = settled;
+    return table;
+}
@@ -0,0 +1,53 @@
+#ifndef DISTANCE_MATRIX_H
+#define DISTANCE_MATRIX_H
+
+#include <vector>
+#include "route_model.h"
+#include "route_planner.h"
+#include "search_workspace.h"
+#include "thread_pool.h"
+
+// Distances (or travel times) from every source to every target. Instead of
+// one A* query per pair, each source runs a single Dijkstra sweep that stops
+// as soon as the road nodes of all targets are settled, so a row costs about
+// as much as one query to the farthest target. Rows are spread over a fixed
+// thread pool.
+class DistanceMatrix {
+  public:
+    // A point in the percent coordinates taken by RoutePlanner.
+    struct Point {
+        float x, y;
+    };
+    // Dense row-major table, one row per source: values[row * columns + column].
+    // Entries are metres for profiles that minimise distance and seconds for
+    // those that minimise time; unreachable targets are SearchWorkspace::kInfinity.
+    struct Table {
+        int rows = 0;
+        int columns = 0;
+        std::vector<float> values;
+
+        float At(int row, int column) const { return values[std::size_t(row) * columns + column]; }
+    };
+
+    // 0 threads uses one per hardware core.
+    explicit DistanceMatrix(const RouteModel &model, int thread_count = 0, RoutePlanner::Snap snap = RoutePlanner::Snap::ToEdge,
+                            int profile = RouteModel::kDefaultProfile);
+
+    Table Compute(const std::vector<Point> &sources, const std::vector<Point> &targets);
+
+    // Nodes settled by all sweeps of the last Compute.
+    long SettledNodes() const { return settled_nodes; }
+
+  private:
+    std::vector<RouteModel::EdgePoint> SnapAll(const std::vector<Point> &points);
+
+    const RouteModel &m_Model;
+    const RoutePlanner::Snap snap;
+    const int profile;
+    ThreadPool pool;
+    // One per thread slot of the pool.
+    std::vector<SearchWorkspace> workspaces;
+    long settled_nodes = 0;
+};
+
+#endif
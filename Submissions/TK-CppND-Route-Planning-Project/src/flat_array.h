@@ -0,0 +1,61 @@
+#ifndef FLAT_ARRAY_H
+#define FLAT_ARRAY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Read-only array of plain values that either owns them or borrows them from
+// memory kept alive by `owner`, such as the mapping of a GraphCache. The
+// graphs and indexes hold their arrays in one, so a model restored from the
+// cache reads the mapped file in place while a freshly built one owns what
+// it built.
+template <typename T>
+class FlatArray {
+  public:
+    FlatArray() {}
+    FlatArray(std::vector<T> values) : owned(std::move(values)), first(owned.data()), count(owned.size()) {}
+    // Borrows `count` values from `first`, which stay valid while `owner` lives.
+    FlatArray(const T *first, std::size_t count, std::shared_ptr<const void> owner)
+        : owner(std::move(owner)), first(first), count(count) {}
+
+    FlatArray(const FlatArray &other)
+        : owned(other.owned), owner(other.owner), first(owner ? other.first : owned.data()), count(other.count) {}
+    // Moving a vector keeps its buffer, so `first` stays valid.
+    FlatArray(FlatArray &&other) noexcept
+        : owned(std::move(other.owned)), owner(std::move(other.owner)), first(other.first), count(other.count) {
+        other.first = nullptr;
+        other.count = 0;
+    }
+    FlatArray &operator=(FlatArray other) noexcept {
+        owned = std::move(other.owned);
+        owner = std::move(other.owner);
+        first = other.first;
+        count = other.count;
+        return *this;
+    }
+
+    const T *data() const { return first; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T &operator[](std::size_t i) const { return first[i]; }
+    const T *begin() const { return first; }
+    const T *end() const { return first + count; }
+    const T &front() const { return first[0]; }
+    const T &back() const { return first[count - 1]; }
+    // Whether the values live in memory the array does not own.
+    bool Borrowed() const { return owner != nullptr; }
+
+    bool operator==(const FlatArray &other) const { return std::equal(begin(), end(), other.begin(), other.end()); }
+    bool operator!=(const FlatArray &other) const { return !(*this == other); }
+
+  private:
+    std::vector<T> owned;
+    std::shared_ptr<const void> owner;
+    const T *first = nullptr;
+    std::size_t count = 0;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "graph.h"
+#include <algorithm>
+
+Graph::Graph(int node_count, const std::vector<Arc> &arcs) {
+    std::vector<int> offsets(node_count + 1, 0);
+    std::vector<Edge> edges;
+    // Counting sort of the arcs by source node.
+    for (const Arc &arc : arcs)
+        if (arc.from != arc.to)
+            offsets[arc.from + 1]++;
+    for (int node = 0; node < node_count; node++)
+        offsets[node + 1] += offsets[node];
+
+    edges.resize(offsets[node_count]);
+    std::vector<int> next(offsets.begin(), offsets.end() - 1);
+    for (const Arc &arc : arcs)
+        if (arc.from != arc.to)
+            edges[next[arc.from]++] = Edge{arc.to, arc.weight};
+
+    // Ways sharing a segment produce the same arc twice; keep the lightest copy.
+    int write = 0;
+    for (int node = 0; node < node_count; node++) {
+        auto first = edges.begin() + offsets[node];
+        auto last = edges.begin() + offsets[node + 1];
+        std::sort(first, last, [](const Edge &a, const Edge &b) {
+            return a.to < b.to || (a.to == b.to && a.weight < b.weight);
+        });
+        offsets[node] = write;
+        for (auto it = first; it != last; ++it)
+            if (write == offsets[node] || edges[write - 1].to != it->to)
+                edges[write++] = *it;
+    }
+    offsets[node_count] = write;
+    edges.resize(write);
+    edges.shrink_to_fit();
+    this->offsets = std::move(offsets);
+    this->edges = std::move(edges);
+}
+
+
+int Graph::FindEdge(int from, int to) const {
+    for (int edge = offsets[from]; edge < offsets[from + 1]; edge++)
+        if (edges[edge].to == to)
+            return edge;
+    return -1;
+}
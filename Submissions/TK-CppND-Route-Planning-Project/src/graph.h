@@ -0,0 +1,59 @@
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include <utility>
+#include <vector>
+#include "flat_array.h"
+
+// Static adjacency in compressed sparse row form: the outgoing edges of node v
+// are edges[offsets[v]] .. edges[offsets[v + 1]], stored back to back so that
+// expanding a node is a linear walk over one contiguous block.
+class Graph {
+  public:
+    struct Edge {
+        int to;
+        float weight;
+    };
+
+    // Input edge for the constructor.
+    struct Arc {
+        int from;
+        int to;
+        float weight;
+    };
+
+    class EdgeRange {
+      public:
+        EdgeRange(const Edge *first, const Edge *last) : first(first), last(last) {}
+        const Edge *begin() const { return first; }
+        const Edge *end() const { return last; }
+        int size() const { return int(last - first); }
+        bool empty() const { return first == last; }
+      private:
+        const Edge *first;
+        const Edge *last;
+    };
+
+    Graph() {}
+    // Self loops are dropped and parallel arcs collapse into the lightest one.
+    Graph(int node_count, const std::vector<Arc> &arcs);
+    // Adopts arrays already in CSR form, e.g. borrowed from a GraphCache.
+    Graph(FlatArray<int> offsets, FlatArray<Edge> edges)
+        : offsets(std::move(offsets)), edges(std::move(edges)) {}
+
+    int NodeCount() const { return offsets.empty() ? 0 : (int)offsets.size() - 1; }
+    int EdgeCount() const { return (int)edges.size(); }
+    EdgeRange Edges(int node) const {
+        return {edges.data() + offsets[node], edges.data() + offsets[node + 1]};
+    }
+    // Index into EdgeArray() of the edge from `from` to `to`, -1 if there is none.
+    int FindEdge(int from, int to) const;
+    const FlatArray<int> &Offsets() const { return offsets; }
+    const FlatArray<Edge> &EdgeArray() const { return edges; }
+
+  private:
+    FlatArray<int> offsets;
+    FlatArray<Edge> edges;
+};
+
+#endif
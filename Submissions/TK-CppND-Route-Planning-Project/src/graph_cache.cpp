@@ -0,0 +1,284 @@
+#include "graph_cache.h"
+#include <cstdio>
+#include <fstream>
+#include "contraction_hierarchy.h"
+#include "route_model.h"
+
+namespace {
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t section_count;
+    std::uint32_t reserved;
+    std::uint64_t source_checksum;
+    std::uint64_t profile_checksum;
+};
+
+constexpr char kMagic[8] = {'R', 'P', 'G', 'R', 'A', 'P', 'H', '\0'};
+// Reads back differently on a machine of the other endianness.
+constexpr std::uint32_t kByteOrder = 0x01020304;
+constexpr std::uint64_t kAlignment = 8;
+
+std::uint64_t Align(std::uint64_t offset) {
+    return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Section contents collected before anything is written.
+class Sections {
+  public:
+    Sections() : blobs(GraphCache::SectionCount) {}
+
+    template <typename T>
+    void Put(GraphCache::Section section, const T *values, std::size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "sections hold plain data");
+        const std::byte *first = reinterpret_cast<const std::byte *>(values);
+        blobs[section].assign(first, first + count * sizeof(T));
+    }
+
+    template <typename T>
+    void Put(GraphCache::Section section, const std::vector<T> &values) {
+        Put(section, values.data(), values.size());
+    }
+
+    template <typename T>
+    void Put(GraphCache::Section section, const FlatArray<T> &values) {
+        Put(section, values.data(), values.size());
+    }
+
+    // Flattens a list of multipolygons into four sections starting at `first`.
+    template <typename Multipolygon>
+    void PutMultipolygons(std::uint32_t first, const Model &model, const std::vector<Multipolygon> &multipolygons) {
+        std::vector<int> outer_offsets{0}, outer, inner_offsets{0}, inner;
+        for (const Model::Multipolygon &mp : multipolygons) {
+            Model::IndexRange outer_ways = model.Outer(mp), inner_ways = model.Inner(mp);
+            outer.insert(outer.end(), outer_ways.begin(), outer_ways.end());
+            inner.insert(inner.end(), inner_ways.begin(), inner_ways.end());
+            outer_offsets.push_back((int)outer.size());
+            inner_offsets.push_back((int)inner.size());
+        }
+        Put(GraphCache::Section(first), outer_offsets);
+        Put(GraphCache::Section(first + 1), outer);
+        Put(GraphCache::Section(first + 2), inner_offsets);
+        Put(GraphCache::Section(first + 3), inner);
+    }
+
+    const std::vector<std::vector<std::byte>> &Blobs() const { return blobs; }
+
+  private:
+    std::vector<std::vector<std::byte>> blobs;
+};
+
+std::uint64_t Rotl(std::uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+std::uint64_t Load64(const unsigned char *p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+std::uint32_t Load32(const unsigned char *p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+}
+
+// xxHash64 with seed 0: several GB/s, so checksumming a metro extract costs a
+// fraction of parsing it.
+std::uint64_t GraphCache::Checksum(const void *data, std::size_t size) {
+    constexpr std::uint64_t P1 = 11400714785074694791ULL, P2 = 14029467366897019727ULL,
+                            P3 = 1609587929392839161ULL, P4 = 9650029242287828579ULL,
+                            P5 = 2870177450012600261ULL;
+    auto round = [&](std::uint64_t acc, std::uint64_t input) { return Rotl(acc + input * P2, 31) * P1; };
+    auto merge = [&](std::uint64_t acc, std::uint64_t value) { return (acc ^ round(0, value)) * P1 + P4; };
+
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    const unsigned char *end = p + size;
+    std::uint64_t h;
+    if (size >= 32) {
+        std::uint64_t v1 = P1 + P2, v2 = P2, v3 = 0, v4 = 0 - P1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = round(v1, Load64(p));
+            v2 = round(v2, Load64(p + 8));
+            v3 = round(v3, Load64(p + 16));
+            v4 = round(v4, Load64(p + 24));
+        }
+        h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    }
+    else {
+        h = P5;
+    }
+
+    h += size;
+    for (; p + 8 <= end; p += 8)
+        h = Rotl(h ^ round(0, Load64(p)), 27) * P1 + P4;
+    if (p + 4 <= end) {
+        h = Rotl(h ^ (Load32(p) * P1), 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; p++)
+        h = Rotl(h ^ (*p * P5), 11) * P1;
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::uint64_t GraphCache::ProfileChecksum(const std::vector<RoutingProfile> &profiles) {
+    std::vector<unsigned char> bytes;
+    auto append = [&bytes](const void *data, std::size_t size) {
+        const unsigned char *first = static_cast<const unsigned char *>(data);
+        bytes.insert(bytes.end(), first, first + size);
+    };
+    for (const RoutingProfile &profile : profiles) {
+        const std::uint64_t name_size = profile.name.size();
+        append(&name_size, sizeof(name_size));
+        append(profile.name.data(), profile.name.size());
+        const std::uint32_t metric = profile.metric == RoutingProfile::Metric::Time;
+        const std::uint32_t obeys = profile.obeys_turn_restrictions;
+        append(&metric, sizeof(metric));
+        append(profile.speeds.data(), profile.speeds.size() * sizeof(float));
+        append(&obeys, sizeof(obeys));
+        const float turn_costs[3] = {profile.turn_costs.left, profile.turn_costs.right, profile.turn_costs.u_turn};
+        append(turn_costs, sizeof(turn_costs));
+    }
+    return Checksum(bytes.data(), bytes.size());
+}
+
+bool GraphCache::Save(const std::string &path, const RouteModel &model, std::uint64_t source_checksum,
+                      const ContractionHierarchy *hierarchy) {
+    const Model &base = model;
+    Sections sections;
+    sections.Put(Bounds, std::vector<double>{base.m_MinLat, base.m_MaxLat, base.m_MinLon, base.m_MaxLon, base.m_MetricScale});
+    sections.Put(NodeXs, model.Nodes().Xs(), model.Nodes().size());
+    sections.Put(NodeYs, model.Nodes().Ys(), model.Nodes().size());
+    sections.Put(NodeOrdering, std::vector<Model::NodeOrder>{model.Order()});
+    sections.Put(FileIndices, model.NodePermutation());
+
+    std::vector<int> way_offsets{0}, way_nodes;
+    way_nodes.reserve(model.WayNodeArray().size());
+    for (const Model::Way &way : model.Ways()) {
+        Model::IndexRange nodes = model.WayNodes(way);
+        way_nodes.insert(way_nodes.end(), nodes.begin(), nodes.end());
+        way_offsets.push_back((int)way_nodes.size());
+    }
+    sections.Put(WayOffsets, way_offsets);
+    sections.Put(WayNodes, way_nodes);
+    sections.Put(Roads, model.Roads());
+    sections.Put(Railways, model.Railways());
+    sections.PutMultipolygons(Buildings, model, model.Buildings());
+    sections.PutMultipolygons(Leisures, model, model.Leisures());
+    sections.PutMultipolygons(Waters, model, model.Waters());
+    sections.PutMultipolygons(Landuses, model, model.Landuses());
+    std::vector<Model::Landuse::Type> landuse_types;
+    for (const Model::Landuse &landuse : model.Landuses())
+        landuse_types.push_back(landuse.type);
+    sections.Put(LanduseTypes, landuse_types);
+    sections.Put(TurnRestrictions, model.TurnRestrictions());
+    if (model.ProfileCount() != (int)kProfileCount)
+        return false;
+    std::vector<RoutingProfile> profiles;
+    for (int profile = 0; profile < model.ProfileCount(); profile++) {
+        const RouteModel::ProfileIndex &index = model.m_Profiles[profile];
+        profiles.push_back(index.profile);
+        sections.Put(ProfileSection(profile, GraphOffsets), index.graph.Offsets());
+        sections.Put(ProfileSection(profile, GraphEdges), index.graph.EdgeArray());
+        sections.Put(ProfileSection(profile, NodeTreeXs), index.nodes.xs);
+        sections.Put(ProfileSection(profile, NodeTreeYs), index.nodes.ys);
+        sections.Put(ProfileSection(profile, NodeTreeIds), index.nodes.ids);
+        sections.Put(ProfileSection(profile, NodeTreeAxes), index.nodes.axes);
+        const SegmentIndex &segments = index.segments;
+        sections.Put(ProfileSection(profile, Segments), segments.segments);
+        sections.Put(ProfileSection(profile, SegmentGrid), std::vector<double>{segments.min_x, segments.min_y,
+                     segments.cell_size, (double)segments.columns, (double)segments.rows});
+        sections.Put(ProfileSection(profile, SegmentCellOffsets), segments.cell_offsets);
+        sections.Put(ProfileSection(profile, SegmentCells), segments.cell_segments);
+        sections.Put(ProfileSection(profile, TurnRestrictedEdges), index.turns.restricted);
+        sections.Put(ProfileSection(profile, TurnForbidden), index.turns.forbidden);
+    }
+    if (hierarchy != nullptr) {
+        if (hierarchy->Profile() < 0 || hierarchy->Profile() >= model.ProfileCount() ||
+            hierarchy->GraphVersion() != model.GraphVersion() ||
+            hierarchy->NodeCount() != model.RoadGraph(hierarchy->Profile()).NodeCount())
+            return false;
+        sections.Put(HierarchyProfile, std::vector<int>{hierarchy->Profile()});
+        sections.Put(HierarchyRanks, hierarchy->Ranks());
+        sections.Put(HierarchyOffsets, hierarchy->Offsets());
+        sections.Put(HierarchyEdges, hierarchy->EdgeArray());
+    }
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order = kByteOrder;
+    header.section_count = SectionCount;
+    header.source_checksum = source_checksum;
+    header.profile_checksum = ProfileChecksum(profiles);
+
+    std::vector<Entry> entries;
+    std::uint64_t offset = Align(sizeof(Header) + SectionCount * sizeof(Entry));
+    for (const std::vector<std::byte> &blob : sections.Blobs()) {
+        entries.push_back({offset, blob.size()});
+        offset = Align(offset + blob.size());
+    }
+
+    // Write next to the target and rename, so a reader never sees half a file.
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream os{temporary, std::ios::binary | std::ios::trunc};
+        if (!os)
+            return false;
+        os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        os.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(Entry));
+        const char padding[kAlignment] = {};
+        std::uint64_t written = sizeof(header) + entries.size() * sizeof(Entry);
+        for (std::uint32_t i = 0; i < SectionCount; i++) {
+            os.write(padding, entries[i].offset - written);
+            os.write(reinterpret_cast<const char *>(sections.Blobs()[i].data()), entries[i].size);
+            written = entries[i].offset + entries[i].size;
+        }
+        if (!os)
+            return false;
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(path.c_str());
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+std::optional<GraphCache> GraphCache::Open(const std::string &path, std::uint64_t source_checksum) {
+    std::optional<MappedFile> file = MappedFile::Open(path);
+    if (!file || file->Size() < sizeof(Header))
+        return std::nullopt;
+
+    Header header;
+    std::memcpy(&header, file->Data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.byte_order != kByteOrder || header.section_count != SectionCount ||
+        header.source_checksum != source_checksum ||
+        header.profile_checksum != ProfileChecksum(RoutingProfile::Defaults()))
+        return std::nullopt;
+
+    if (file->Size() < sizeof(Header) + SectionCount * sizeof(Entry))
+        return std::nullopt;
+    std::vector<Entry> entries(SectionCount);
+    std::memcpy(entries.data(), file->Data() + sizeof(Header), SectionCount * sizeof(Entry));
+    for (const Entry &entry : entries)
+        if (entry.offset % kAlignment != 0 || entry.offset > file->Size() || entry.size > file->Size() - entry.offset)
+            return std::nullopt;
+
+    return GraphCache{std::move(*file), std::move(entries)};
+}
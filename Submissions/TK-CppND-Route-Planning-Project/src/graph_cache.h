@@ -0,0 +1,141 @@
+#ifndef GRAPH_CACHE_H
+#define GRAPH_CACHE_H
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "flat_array.h"
+#include "mapped_file.h"
+
+class ContractionHierarchy;
+class RouteModel;
+struct RoutingProfile;
+
+// Binary snapshot of a loaded RouteModel: projected node coordinates and their
+// order, ways, roads, railways, multipolygons, turn restrictions, and for
+// every profile its road graph, k-d tree, segment index and turn table, plus
+// optionally a contraction hierarchy built over the default graph. Each is
+// stored as one flat, 8-byte aligned array. The file is written once after
+// the OSM data has been parsed and mmap'ed on later starts, so neither the
+// XML is touched nor an index rebuilt again until the source changes. The
+// node coordinates, graphs, k-d trees and segment grids are then read in
+// place from the mapping, which they keep alive; the smaller sections are
+// copied out.
+//
+// Layout: a Header, `section_count` SectionEntry records, then the sections.
+// The header records the 64-bit checksum of the source .osm file and one of
+// the routing profiles the graphs were weighted with; a cache whose version,
+// byte order or checksums do not match RoutingProfile::Defaults() is ignored.
+class GraphCache {
+  public:
+    static constexpr std::uint32_t kVersion = 8;
+    // Profiles stored, those of RoutingProfile::Defaults().
+    static constexpr std::uint32_t kProfileCount = 3;
+
+    // The sections of one profile, from ProfileSection(profile, GraphOffsets) on.
+    enum ProfilePart : std::uint32_t {
+        GraphOffsets,       // int[nodes + 1]
+        GraphEdges,         // Graph::Edge[]
+        NodeTreeXs,         // float[points], the k-d tree in tree order
+        NodeTreeYs,         // float[points]
+        NodeTreeIds,        // int[points]
+        NodeTreeAxes,       // unsigned char[points]
+        Segments,           // SegmentIndex::Segment[]
+        SegmentGrid,        // double[5]: min x, min y, cell size, columns, rows
+        SegmentCellOffsets, // int[cells + 1] into SegmentCells
+        SegmentCells,       // int[]
+        TurnRestrictedEdges, // std::uint64_t[], a bit per edge
+        TurnForbidden,      // TurnTable::Turn[]
+        kProfileParts
+    };
+
+    enum Section : std::uint32_t {
+        Bounds,             // double[5]: min/max lat, min/max lon, metric scale
+        NodeXs,             // float[nodes]
+        NodeYs,             // float[nodes]
+        WayOffsets,         // int[ways + 1] into WayNodes
+        WayNodes,           // int[]
+        Roads,              // Model::Road[]
+        Railways,           // Model::Railway[]
+        Buildings,          // 4 sections per multipolygon kind:
+        Leisures = Buildings + 4, // outer offsets, outer ways, inner offsets, inner ways
+        Waters = Leisures + 4,
+        Landuses = Waters + 4,
+        LanduseTypes = Landuses + 4, // Model::Landuse::Type[]
+        HierarchyRanks,     // int[nodes], empty without a ContractionHierarchy
+        HierarchyOffsets,   // int[nodes + 1]
+        HierarchyEdges,     // ContractionHierarchy::Edge[]
+        HierarchyProfile,   // int[1], profile the hierarchy was built for
+        NodeOrdering,       // Model::NodeOrder[1]
+        FileIndices,        // int[nodes], Model::FileIndex of each node; empty in file order
+        TurnRestrictions,   // Model::TurnRestriction[]
+        Profiles,           // kProfileParts sections per profile
+        SectionCount = Profiles + kProfileCount * kProfileParts
+    };
+
+    static Section ProfileSection(int profile, ProfilePart part) {
+        return Section(Profiles + profile * kProfileParts + part);
+    }
+
+    // Checksum used to tie a cache to the .osm file it was built from.
+    static std::uint64_t Checksum(const void *data, std::size_t size);
+    // Checksum of everything in the profiles that goes into the graphs and
+    // turn tables, so that changing a speed or a turn cost retires the cache.
+    static std::uint64_t ProfileChecksum(const std::vector<RoutingProfile> &profiles);
+
+    // Writes the model to `path`, replacing any previous file atomically. A
+    // hierarchy given here must have been built for one of the model's
+    // profiles at its current GraphVersion. Fails if it was not, or if the
+    // model does not have kProfileCount profiles.
+    static bool Save(const std::string &path, const RouteModel &model, std::uint64_t source_checksum,
+                     const ContractionHierarchy *hierarchy = nullptr);
+
+    // Maps the cache at `path` if it is valid for the given source checksum.
+    static std::optional<GraphCache> Open(const std::string &path, std::uint64_t source_checksum);
+
+    bool HasHierarchy() const { return entries[HierarchyOffsets].size != 0; }
+
+    // Copies one section out of the mapping.
+    template <typename T>
+    std::vector<T> Read(Section section) const {
+        static_assert(std::is_trivially_copyable<T>::value, "sections hold plain data");
+        const Entry &entry = entries[section];
+        if (entry.size % sizeof(T) != 0)
+            throw std::logic_error("graph cache section has an unexpected size");
+        std::vector<T> values(entry.size / sizeof(T));
+        if (!values.empty())
+            std::memcpy(values.data(), file->Data() + entry.offset, entry.size);
+        return values;
+    }
+
+    // Borrows one section from the mapping, which the array keeps alive. Save
+    // aligns every section to 8 bytes, enough for any T stored.
+    template <typename T>
+    FlatArray<T> View(Section section) const {
+        static_assert(std::is_trivially_copyable<T>::value, "sections hold plain data");
+        const Entry &entry = entries[section];
+        const std::byte *first = file->Data() + entry.offset;
+        if (entry.size % sizeof(T) != 0 || reinterpret_cast<std::uintptr_t>(first) % alignof(T) != 0)
+            throw std::logic_error("graph cache section has an unexpected size or alignment");
+        return FlatArray<T>(reinterpret_cast<const T *>(first), entry.size / sizeof(T), file);
+    }
+
+  private:
+    struct Entry {
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    GraphCache(MappedFile file, std::vector<Entry> entries)
+        : file(std::make_shared<MappedFile>(std::move(file))), entries(std::move(entries)) {}
+
+    std::shared_ptr<const MappedFile> file;
+    std::vector<Entry> entries;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef ID_MAP_H
+#define ID_MAP_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Hash map from 64-bit OSM ids to dense indices, with open addressing and
+// linear probing over one flat array of slots. Sized up front from the number
+// of elements in the file, it never rehashes while loading a map, and a lookup
+// touches a single cache line in the common case.
+class IdMap {
+  public:
+    static constexpr int kMissing = -1;
+
+    explicit IdMap(std::size_t expected = 0) { Reserve(expected); }
+
+    // Makes room for `count` ids without rehashing, keeping the load below 1/2.
+    void Reserve(std::size_t count) {
+        std::size_t capacity = 16;
+        while (capacity < 2 * count)
+            capacity *= 2;
+        if (capacity > slots.size())
+            Rehash(capacity);
+    }
+
+    // Maps `id` to `index`, replacing an earlier mapping of the same id.
+    void Insert(std::int64_t id, int index) {
+        if (2 * (size + 1) > slots.size())
+            Rehash(2 * slots.size());
+        Slot &slot = slots[Probe(id)];
+        if (slot.id != kEmpty)
+            slot.index = index;
+        else {
+            slot = {id, index};
+            size++;
+        }
+    }
+
+    // Index stored for `id`, or kMissing.
+    int Find(std::int64_t id) const {
+        const Slot &slot = slots[Probe(id)];
+        return slot.id == id ? slot.index : kMissing;
+    }
+
+    std::size_t Size() const { return size; }
+
+  private:
+    struct Slot {
+        std::int64_t id;
+        int index;
+    };
+
+    // No element of an OSM file carries this id.
+    static constexpr std::int64_t kEmpty = std::numeric_limits<std::int64_t>::min();
+
+    // First slot holding `id` or, failing that, the empty slot ending its run.
+    std::size_t Probe(std::int64_t id) const {
+        const std::size_t mask = slots.size() - 1;
+        // Fibonacci hashing spreads the mostly consecutive OSM ids over the table.
+        std::size_t i = std::size_t((std::uint64_t(id) * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+        while (slots[i].id != id && slots[i].id != kEmpty)
+            i = (i + 1) & mask;
+        return i;
+    }
+
+    void Rehash(std::size_t capacity) {
+        std::vector<Slot> old(capacity, Slot{kEmpty, kMissing});
+        old.swap(slots);
+        for (const Slot &slot : old)
+            if (slot.id != kEmpty)
+                slots[Probe(slot.id)] = slot;
+    }
+
+    std::vector<Slot> slots;
+    std::size_t size = 0;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef INDEXED_HEAP_H
+#define INDEXED_HEAP_H
+
+#include <vector>
+#include <cassert>
+
+// Min-priority queue over the integer ids [0, capacity). Every queued id keeps
+// its slot in `position`, so a node that is reached again through a shorter
+// path has its key lowered in place instead of being queued a second time.
+// D is the arity: a 4-ary heap is half as deep as a binary one and the
+// children of a slot still sit next to each other in memory.
+template <int D = 4>
+class IndexedHeap {
+  public:
+    explicit IndexedHeap(int capacity = 0) : position(capacity, kAbsent) {}
+
+    void Resize(int capacity) {
+        heap.clear();
+        position.assign(capacity, kAbsent);
+    }
+
+    bool Empty() const { return heap.empty(); }
+    int Size() const { return (int)heap.size(); }
+    bool Contains(int id) const { return position[id] != kAbsent; }
+    float Key(int id) const { return heap[position[id]].key; }
+    float MinKey() const { return heap.front().key; }
+    int Top() const { return heap.front().id; }
+
+    void Push(int id, float key) {
+        assert(!Contains(id));
+        heap.push_back({key, id});
+        SiftUp((int)heap.size() - 1);
+    }
+
+    // Lowers the key of a queued id; larger keys are ignored.
+    void DecreaseKey(int id, float key) {
+        int slot = position[id];
+        if (key < heap[slot].key) {
+            heap[slot].key = key;
+            SiftUp(slot);
+        }
+    }
+
+    // Queues the id or lowers its key, whichever applies.
+    void PushOrDecrease(int id, float key) {
+        if (Contains(id))
+            DecreaseKey(id, key);
+        else
+            Push(id, key);
+    }
+
+    int Pop() {
+        int id = heap.front().id;
+        position[id] = kAbsent;
+        Entry last = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            heap.front() = last;
+            position[last.id] = 0;
+            SiftDown(0);
+        }
+        return id;
+    }
+
+    // Empties the queue in O(size), leaving the capacity untouched.
+    void Clear() {
+        for (const Entry &entry : heap)
+            position[entry.id] = kAbsent;
+        heap.clear();
+    }
+
+  private:
+    struct Entry {
+        float key;
+        int id;
+    };
+
+    static constexpr int kAbsent = -1;
+
+    void SiftUp(int slot) {
+        Entry entry = heap[slot];
+        while (slot > 0) {
+            int parent = (slot - 1) / D;
+            if (!(entry.key < heap[parent].key))
+                break;
+            heap[slot] = heap[parent];
+            position[heap[slot].id] = slot;
+            slot = parent;
+        }
+        heap[slot] = entry;
+        position[entry.id] = slot;
+    }
+
+    void SiftDown(int slot) {
+        Entry entry = heap[slot];
+        const int size = (int)heap.size();
+        while (true) {
+            int first = slot * D + 1;
+            if (first >= size)
+                break;
+            int last = first + D < size ? first + D : size;
+            int best = first;
+            for (int child = first + 1; child < last; ++child)
+                if (heap[child].key < heap[best].key)
+                    best = child;
+            if (!(heap[best].key < entry.key))
+                break;
+            heap[slot] = heap[best];
+            position[heap[slot].id] = slot;
+            slot = best;
+        }
+        heap[slot] = entry;
+        position[entry.id] = slot;
+    }
+
+    std::vector<Entry> heap;
+    std::vector<int> position;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "isochrone.h"
+#include <algorithm>
+#include <cmath>
+
+Isochrone::Isochrone(const RouteModel &model, float x, float y, float budget, RoutePlanner::Snap snap, int profile, int sectors) {
+    SearchWorkspace workspace;
+    BuildBoundary(Search(model, workspace, x, y, budget, snap, profile), sectors);
+}
+
+
+Isochrone::Isochrone(const RouteModel &model, SearchWorkspace &workspace, float x, float y, float budget, RoutePlanner::Snap snap,
+                     int profile, int sectors) {
+    BuildBoundary(Search(model, workspace, x, y, budget, snap, profile), sectors);
+}
+
+
+std::vector<Model::Node> Isochrone::Search(const RouteModel &model, SearchWorkspace &workspace, float x, float y, float budget,
+                                           RoutePlanner::Snap snap, int profile) {
+    const RouteModel::EdgePoint start = RoutePlanner::SnapPoint(model, x, y, snap, profile);
+    origin = Model::Node{start.x, start.y};
+    const float scale = model.WeightScale(profile);
+    const float limit = budget / scale;
+    const Graph &graph = model.RoadGraph(profile);
+    const Model::NodeStore &model_nodes = model.Nodes();
+    std::vector<Model::Node> points{origin};
+
+    // The point `fraction` of the way from `from` to `to`.
+    auto point_on = [&](const Model::Node &from, const Model::Node &to, float fraction) {
+        return Model::Node{from.x + (to.x - from.x) * fraction, from.y + (to.y - from.y) * fraction};
+    };
+
+    workspace.Reset((int)model_nodes.size());
+    const float start_length = model.SegmentWeight(start.from, start.to, profile);
+    auto seed = [&](int node, float g_value) {
+        if (g_value > limit) {
+            // The budget runs out on the start segment itself.
+            if (start_length > 0.0f)
+                points.push_back(point_on(origin, model_nodes[node], limit / g_value));
+        }
+        else if (!workspace.Reached(node)) {
+            workspace.Reach(node, g_value, 0.0f, -1);
+            workspace.OpenList().Push(node, g_value);
+        }
+        else if (g_value < workspace.GValue(node)) {
+            workspace.Relax(node, g_value, -1);
+            workspace.OpenList().DecreaseKey(node, g_value);
+        }
+    };
+    seed(start.from, start.t * start_length);
+    seed(start.to, (1.0f - start.t) * start_length);
+
+    // Only nodes within the budget are ever labelled, so the open list never
+    // holds anything past it and the search ends when it runs dry.
+    while (!workspace.OpenList().Empty()) {
+        const int current = workspace.OpenList().Pop();
+        workspace.Close(current);
+        const float current_g_value = workspace.GValue(current);
+        nodes.push_back(current);
+        costs.push_back(current_g_value * scale);
+        points.push_back(model_nodes[current]);
+        for (const Graph::Edge &edge : graph.Edges(current)) {
+            if (workspace.Closed(edge.to))
+                continue;
+            const float g_value = current_g_value + edge.weight;
+            if (g_value > limit) {
+                points.push_back(point_on(model_nodes[current], model_nodes[edge.to], (limit - current_g_value) / edge.weight));
+            }
+            else if (!workspace.Reached(edge.to)) {
+                workspace.Reach(edge.to, g_value, 0.0f, current);
+                workspace.OpenList().Push(edge.to, g_value);
+            }
+            else if (g_value < workspace.GValue(edge.to)) {
+                workspace.Relax(edge.to, g_value, current);
+                workspace.OpenList().DecreaseKey(edge.to, g_value);
+            }
+        }
+    }
+    return points;
+}
+
+
+void Isochrone::BuildBoundary(const std::vector<Model::Node> &points, int sectors) {
+    const double pi = 3.14159265358979323846;
+    // Farthest point of every sector, by squared distance from the origin.
+    std::vector<int> farthest(sectors, -1);
+    std::vector<double> farthest_distance(sectors, 0.0);
+    for (int i = 0; i < (int)points.size(); i++) {
+        const double dx = points[i].x - origin.x, dy = points[i].y - origin.y;
+        const double distance = dx * dx + dy * dy;
+        if (distance == 0.0)
+            continue;
+        const double angle = std::atan2(dy, dx) + pi;
+        const int sector = std::min(sectors - 1, (int)(angle / (2.0 * pi) * sectors));
+        if (distance > farthest_distance[sector]) {
+            farthest[sector] = i;
+            farthest_distance[sector] = distance;
+        }
+    }
+    for (int sector = 0; sector < sectors; sector++)
+        if (farthest[sector] >= 0)
+            boundary.push_back(points[farthest[sector]]);
+    if (boundary.size() < 3)
+        boundary.clear();
+}
@@ -0,0 +1,56 @@
+#ifndef ISOCHRONE_H
+#define ISOCHRONE_H
+
+#include <vector>
+#include "model.h"
+#include "route_model.h"
+#include "route_planner.h"
+#include "search_workspace.h"
+
+// Everything reachable from a start point within a distance or time budget.
+// A Dijkstra search that never labels a node past the budget finds the
+// reachable nodes, so its cost follows the size of the area covered, not of
+// the map.
+//
+// The boundary is a star-shaped polygon around the start: the reachable area
+// is cut into equal angular sectors and the farthest reachable point of each
+// becomes a vertex. The points considered are the reachable nodes plus, on
+// every road leaving the area, the point where the budget runs out. Unlike a
+// convex hull it follows the area into the gaps between the roads.
+class Isochrone {
+  public:
+    static constexpr int kDefaultSectors = 72;
+
+    // `x` and `y` are percent coordinates as taken by RoutePlanner. The budget
+    // is in metres for profiles that minimise distance and in seconds for
+    // those that minimise time.
+    Isochrone(const RouteModel &model, float x, float y, float budget, RoutePlanner::Snap snap = RoutePlanner::Snap::ToEdge,
+              int profile = RouteModel::kDefaultProfile, int sectors = kDefaultSectors);
+    // Runs the search in a caller-owned workspace.
+    Isochrone(const RouteModel &model, SearchWorkspace &workspace, float x, float y, float budget,
+              RoutePlanner::Snap snap = RoutePlanner::Snap::ToEdge, int profile = RouteModel::kDefaultProfile,
+              int sectors = kDefaultSectors);
+
+    // The reachable nodes, closest first, and the cost of reaching each in
+    // the unit of the budget.
+    const std::vector<int> &Nodes() const { return nodes; }
+    const std::vector<float> &Costs() const { return costs; }
+    // Boundary polygon in map coordinates, counter-clockwise around the start;
+    // empty when fewer than three sectors hold a reachable point.
+    const std::vector<Model::Node> &Boundary() const { return boundary; }
+    // The snapped start point.
+    const Model::Node &Origin() const { return origin; }
+
+  private:
+    // Returns the reachable points the boundary is chosen from.
+    std::vector<Model::Node> Search(const RouteModel &model, SearchWorkspace &workspace, float x, float y, float budget,
+                                    RoutePlanner::Snap snap, int profile);
+    void BuildBoundary(const std::vector<Model::Node> &points, int sectors);
+
+    std::vector<int> nodes;
+    std::vector<float> costs;
+    Model::Node origin;
+    std::vector<Model::Node> boundary;
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include "kd_tree.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "distance_kernels.h"
+
+// Ranges this small are scanned linearly instead of being split further; 16
+// points are two AVX2 vectors.
+static constexpr int kLeafSize = 16;
+
+KdTree::KdTree(std::vector<Point> points) {
+    std::vector<unsigned char> axes(points.size(), 0);
+    Build(points, 0, (int)points.size(), axes);
+    std::vector<float> xs, ys;
+    std::vector<int> ids;
+    xs.reserve(points.size());
+    ys.reserve(points.size());
+    ids.reserve(points.size());
+    for (const Point &point : points) {
+        xs.push_back(point.x);
+        ys.push_back(point.y);
+        ids.push_back(point.id);
+    }
+    this->xs = std::move(xs);
+    this->ys = std::move(ys);
+    this->ids = std::move(ids);
+    this->axes = std::move(axes);
+}
+
+KdTree::KdTree(const GraphCache &cache, int profile, int id_count)
+    : xs(cache.View<float>(GraphCache::ProfileSection(profile, GraphCache::NodeTreeXs))),
+      ys(cache.View<float>(GraphCache::ProfileSection(profile, GraphCache::NodeTreeYs))),
+      ids(cache.View<int>(GraphCache::ProfileSection(profile, GraphCache::NodeTreeIds))),
+      axes(cache.View<unsigned char>(GraphCache::ProfileSection(profile, GraphCache::NodeTreeAxes))) {
+    bool valid = ys.size() == xs.size() && ids.size() == xs.size() && axes.size() == xs.size();
+    for (int id : ids)
+        valid = valid && id >= 0 && id < id_count;
+    for (unsigned char axis : axes)
+        valid = valid && axis <= 1;
+    if (!valid)
+        throw std::logic_error("graph cache holds a malformed k-d tree");
+}
+
+void KdTree::Build(std::vector<Point> &points, int lo, int hi, std::vector<unsigned char> &axes) {
+    if (hi - lo <= kLeafSize)
+        return;
+
+    float min_x = points[lo].x, max_x = min_x, min_y = points[lo].y, max_y = min_y;
+    for (int i = lo + 1; i < hi; i++) {
+        min_x = std::min(min_x, points[i].x);
+        max_x = std::max(max_x, points[i].x);
+        min_y = std::min(min_y, points[i].y);
+        max_y = std::max(max_y, points[i].y);
+    }
+    int axis = (max_y - min_y) > (max_x - min_x) ? 1 : 0;
+
+    int mid = (lo + hi) / 2;
+    std::nth_element(points.begin() + lo, points.begin() + mid, points.begin() + hi,
+                     [axis](const Point &a, const Point &b) { return axis ? a.y < b.y : a.x < b.x; });
+    axes[mid] = axis;
+    Build(points, lo, mid, axes);
+    Build(points, mid + 1, hi, axes);
+}
+
+float KdTree::Distance2(int slot, float x, float y) const {
+    float dx = xs[slot] - x, dy = ys[slot] - y;
+    return dx * dx + dy * dy;
+}
+
+int KdTree::Nearest(float x, float y) const {
+    Candidate best{std::numeric_limits<float>::infinity(), -1};
+    if (Size() > 0)
+        Nearest(0, Size(), x, y, best);
+    return best.id;
+}
+
+void KdTree::Nearest(int lo, int hi, float x, float y, Candidate &best) const {
+    if (hi - lo <= kLeafSize) {
+        float d2;
+        int nearest = NearestPoint(xs.data() + lo, ys.data() + lo, hi - lo, x, y, d2);
+        if (nearest >= 0 && d2 < best.distance2)
+            best = {d2, ids[lo + nearest]};
+        return;
+    }
+
+    int mid = (lo + hi) / 2;
+    if (float d2 = Distance2(mid, x, y); d2 < best.distance2)
+        best = {d2, ids[mid]};
+
+    float diff = axes[mid] ? y - ys[mid] : x - xs[mid];
+    if (diff < 0) {
+        Nearest(lo, mid, x, y, best);
+        if (diff * diff < best.distance2)
+            Nearest(mid + 1, hi, x, y, best);
+    }
+    else {
+        Nearest(mid + 1, hi, x, y, best);
+        if (diff * diff < best.distance2)
+            Nearest(lo, mid, x, y, best);
+    }
+}
+
+std::vector<int> KdTree::KNearest(float x, float y, int k) const {
+    std::vector<Candidate> heap;
+    if (k <= 0 || Size() == 0)
+        return {};
+    heap.reserve(k);
+    KNearest(0, Size(), x, y, k, heap);
+
+    std::sort_heap(heap.begin(), heap.end());
+    std::vector<int> nearest;
+    nearest.reserve(heap.size());
+    for (const Candidate &candidate : heap)
+        nearest.push_back(candidate.id);
+    return nearest;
+}
+
+// `heap` is a max-heap on distance holding the best k candidates found so far.
+void KdTree::KNearest(int lo, int hi, float x, float y, int k, std::vector<Candidate> &heap) const {
+    auto offer = [&](float d2, int id) {
+        if ((int)heap.size() < k) {
+            heap.push_back({d2, id});
+            std::push_heap(heap.begin(), heap.end());
+        }
+        else if (d2 < heap.front().distance2) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = {d2, id};
+            std::push_heap(heap.begin(), heap.end());
+        }
+    };
+    auto bound = [&]() {
+        return (int)heap.size() < k ? std::numeric_limits<float>::infinity() : heap.front().distance2;
+    };
+
+    if (hi - lo <= kLeafSize) {
+        float d2[kLeafSize];
+        SquaredDistances(xs.data() + lo, ys.data() + lo, hi - lo, x, y, d2);
+        for (int i = lo; i < hi; i++)
+            offer(d2[i - lo], ids[i]);
+        return;
+    }
+
+    int mid = (lo + hi) / 2;
+    offer(Distance2(mid, x, y), ids[mid]);
+
+    float diff = axes[mid] ? y - ys[mid] : x - xs[mid];
+    int near_lo = diff < 0 ? lo : mid + 1, near_hi = diff < 0 ? mid : hi;
+    int far_lo = diff < 0 ? mid + 1 : lo, far_hi = diff < 0 ? hi : mid;
+    KNearest(near_lo, near_hi, x, y, k, heap);
+    if (diff * diff < bound())
+        KNearest(far_lo, far_hi, x, y, k, heap);
+}
+
+std::vector<int> KdTree::WithinRadius(float x, float y, float radius) const {
+    std::vector<int> found;
+    if (Size() > 0)
+        WithinRadius(0, Size(), x, y, radius * radius, found);
+    return found;
+}
+
+void KdTree::WithinRadius(int lo, int hi, float x, float y, float radius2, std::vector<int> &found) const {
+    if (hi - lo <= kLeafSize) {
+        float d2[kLeafSize];
+        SquaredDistances(xs.data() + lo, ys.data() + lo, hi - lo, x, y, d2);
+        for (int i = lo; i < hi; i++)
+            if (d2[i - lo] <= radius2)
+                found.push_back(ids[i]);
+        return;
+    }
+
+    int mid = (lo + hi) / 2;
+    if (Distance2(mid, x, y) <= radius2)
+        found.push_back(ids[mid]);
+
+    float diff = axes[mid] ? y - ys[mid] : x - xs[mid];
+    if (diff <= 0 || diff * diff <= radius2)
+        WithinRadius(lo, mid, x, y, radius2, found);
+    if (diff >= 0 || diff * diff <= radius2)
+        WithinRadius(mid + 1, hi, x, y, radius2, found);
+}
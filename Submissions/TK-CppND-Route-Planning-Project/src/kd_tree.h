@@ -0,0 +1,62 @@
+#ifndef KD_TREE_H
+#define KD_TREE_H
+
+#include <vector>
+#include "flat_array.h"
+#include "graph_cache.h"
+
+// Static 2-d tree over a fixed set of points. The tree is implicit: the points
+// are arranged in place so that the median of every range [lo, hi) sits at
+// (lo + hi) / 2, splitting along the axis of larger extent. No node objects are
+// allocated and a query touches O(log n) ranges on average.
+//
+// Once built, the coordinates are kept in two float arrays, so the ranges at
+// the bottom of the tree are scanned by the batch kernels of
+// distance_kernels.h.
+class KdTree {
+  public:
+    struct Point {
+        float x;
+        float y;
+        int id;
+    };
+
+    KdTree() {}
+    explicit KdTree(std::vector<Point> points);
+    // Restores the tree of `profile` saved in a GraphCache, checking that its
+    // ids are below `id_count`.
+    KdTree(const GraphCache &cache, int profile, int id_count);
+
+    int Size() const { return (int)ids.size(); }
+
+    // Id of the point closest to (x, y), or -1 if the tree is empty.
+    int Nearest(float x, float y) const;
+    // Ids of the k points closest to (x, y), nearest first.
+    std::vector<int> KNearest(float x, float y, int k) const;
+    // Ids of all points within `radius` of (x, y), in no particular order.
+    std::vector<int> WithinRadius(float x, float y, float radius) const;
+
+  private:
+    friend class GraphCache;
+
+    struct Candidate {
+        float distance2;
+        int id;
+        bool operator<(const Candidate &other) const { return distance2 < other.distance2; }
+    };
+
+    static void Build(std::vector<Point> &points, int lo, int hi, std::vector<unsigned char> &axes);
+    float Distance2(int slot, float x, float y) const;
+    void Nearest(int lo, int hi, float x, float y, Candidate &best) const;
+    void KNearest(int lo, int hi, float x, float y, int k, std::vector<Candidate> &heap) const;
+    void WithinRadius(int lo, int hi, float x, float y, float radius2, std::vector<int> &found) const;
+
+    // The points in tree order.
+    FlatArray<float> xs;
+    FlatArray<float> ys;
+    FlatArray<int> ids;
+    // Split axis of the range whose median is at this slot: 0 for x, 1 for y.
+    FlatArray<unsigned char> axes;
+};
+
+#endif
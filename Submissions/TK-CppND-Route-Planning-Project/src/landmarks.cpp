@@ -0,0 +1,187 @@
+#include "landmarks.h"
+#include <algorithm>
+#include <random>
+#include "route_model.h"
+#include "search_workspace.h"
+
+namespace {
+
+// Dijkstra from `source` over the whole graph. The distances and the shortest
+// path tree stay in the workspace; returns the reached nodes in the order they
+// were settled, closest first.
+std::vector<int> SettleAll(const Graph &graph, int source, SearchWorkspace &workspace) {
+    std::vector<int> order;
+    workspace.Reset(graph.NodeCount());
+    workspace.Reach(source, 0.0f, 0.0f, -1);
+    workspace.OpenList().Push(source, 0.0f);
+    while (!workspace.OpenList().Empty()) {
+        const int current = workspace.OpenList().Pop();
+        workspace.Close(current);
+        order.push_back(current);
+        const float current_g_value = workspace.GValue(current);
+        for (const Graph::Edge &edge : graph.Edges(current)) {
+            if (workspace.Closed(edge.to))
+                continue;
+            const float g_value = current_g_value + edge.weight;
+            if (!workspace.Reached(edge.to)) {
+                workspace.Reach(edge.to, g_value, 0.0f, current);
+                workspace.OpenList().Push(edge.to, g_value);
+            }
+            else if (g_value < workspace.GValue(edge.to)) {
+                workspace.Relax(edge.to, g_value, current);
+                workspace.OpenList().DecreaseKey(edge.to, g_value);
+            }
+        }
+    }
+    return order;
+}
+
+}
+
+Landmarks::Landmarks(const Graph &graph, int count, Selection selection, unsigned seed)
+    : node_count(graph.NodeCount()) {
+    std::vector<int> candidates;
+    for (int node = 0; node < node_count; node++)
+        if (!graph.Edges(node).empty())
+            candidates.push_back(node);
+    stride = std::max(0, std::min(count, (int)candidates.size()));
+    if (stride == 0)
+        return;
+    from_landmark.assign(std::size_t(node_count) * stride, SearchWorkspace::kInfinity);
+    to_landmark.assign(std::size_t(node_count) * stride, SearchWorkspace::kInfinity);
+
+    std::vector<Graph::Arc> reversed_arcs;
+    for (int from = 0; from < node_count; from++)
+        for (const Graph::Edge &edge : graph.Edges(from))
+            reversed_arcs.push_back({edge.to, from, edge.weight});
+    const Graph reverse{node_count, reversed_arcs};
+
+    // Both strategies start from the node farthest from a random one.
+    std::mt19937 random{seed};
+    std::uniform_int_distribution<int> pick{0, (int)candidates.size() - 1};
+    SearchWorkspace workspace{node_count};
+    AddLandmark(SettleAll(graph, candidates[pick(random)], workspace).back(), graph, reverse);
+    while (Count() < stride) {
+        int next = selection == Selection::Avoid ? SelectAvoid(graph, candidates[pick(random)]) : -1;
+        if (next < 0)
+            next = SelectFarthest(candidates);
+        if (next < 0)
+            break;
+        AddLandmark(next, graph, reverse);
+    }
+}
+
+
+Landmarks::Landmarks(const RouteModel &model, int profile, int count, Selection selection, unsigned seed)
+    : Landmarks(model.RoadGraph(profile), count, selection, seed) {
+    this->profile = profile;
+    graph_version = model.GraphVersion();
+}
+
+
+float Landmarks::LowerBound(int from, int to) const {
+    if (nodes.empty())
+        return 0.0f;
+    const float *from_row = &from_landmark[std::size_t(from) * stride];
+    const float *to_row = &from_landmark[std::size_t(to) * stride];
+    const float *from_back_row = &to_landmark[std::size_t(from) * stride];
+    const float *to_back_row = &to_landmark[std::size_t(to) * stride];
+    // An infinite difference is a valid bound too: a node that a landmark
+    // reaches cannot reach one the landmark does not. Two infinities give NaN,
+    // which the comparisons skip.
+    float bound = 0.0f;
+    for (int i = 0; i < Count(); i++) {
+        const float forward = to_row[i] - from_row[i];
+        const float backward = from_back_row[i] - to_back_row[i];
+        if (forward > bound)
+            bound = forward;
+        if (backward > bound)
+            bound = backward;
+    }
+    return bound;
+}
+
+
+void Landmarks::AddLandmark(int node, const Graph &graph, const Graph &reverse) {
+    const int column = Count();
+    nodes.push_back(node);
+    SearchWorkspace workspace{node_count};
+    for (int reached : SettleAll(graph, node, workspace))
+        from_landmark[std::size_t(reached) * stride + column] = workspace.GValue(reached);
+    for (int reached : SettleAll(reverse, node, workspace))
+        to_landmark[std::size_t(reached) * stride + column] = workspace.GValue(reached);
+}
+
+
+// The candidate whose closest landmark is farthest away. Nodes that no
+// landmark reaches are left out, so isolated bits of road do not draw
+// landmarks away from the main network.
+int Landmarks::SelectFarthest(const std::vector<int> &candidates) const {
+    int best = -1;
+    float best_distance = -1.0f;
+    for (int node : candidates) {
+        const float *row = &from_landmark[std::size_t(node) * stride];
+        const float closest = *std::min_element(row, row + Count());
+        if (closest != SearchWorkspace::kInfinity && closest > best_distance &&
+            std::find(nodes.begin(), nodes.end(), node) == nodes.end()) {
+            best = node;
+            best_distance = closest;
+        }
+    }
+    return best;
+}
+
+
+// Goldberg and Werneck's avoid heuristic. Every node of the shortest path tree
+// from `root` is weighted by how much its distance from the root exceeds the
+// current lower bound; subtrees that already hold a landmark count as zero.
+// Starting at the heaviest subtree, the walk descends into the heaviest child
+// down to a leaf, which becomes the next landmark. Returns -1 when every
+// subtree already holds a landmark.
+int Landmarks::SelectAvoid(const Graph &graph, int root) const {
+    SearchWorkspace workspace{node_count};
+    const std::vector<int> order = SettleAll(graph, root, workspace);
+    std::vector<float> size(node_count, 0.0f);
+    std::vector<bool> holds_landmark(node_count, false);
+    for (int node : nodes)
+        holds_landmark[node] = true;
+    // Children are settled after their parent, so walking the order backwards
+    // completes every subtree before its root.
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        const int node = *it;
+        if (holds_landmark[node])
+            size[node] = 0.0f;
+        else
+            size[node] += workspace.GValue(node) - LowerBound(root, node);
+        const int parent = workspace.Parent(node);
+        if (parent >= 0) {
+            size[parent] += size[node];
+            if (holds_landmark[node])
+                holds_landmark[parent] = true;
+        }
+    }
+
+    std::vector<int> child_offsets(node_count + 1, 0), children(order.size());
+    for (int node : order)
+        if (workspace.Parent(node) >= 0)
+            child_offsets[workspace.Parent(node) + 1]++;
+    for (int node = 0; node < node_count; node++)
+        child_offsets[node + 1] += child_offsets[node];
+    std::vector<int> filled(child_offsets.begin(), child_offsets.end() - 1);
+    for (int node : order)
+        if (workspace.Parent(node) >= 0)
+            children[filled[workspace.Parent(node)]++] = node;
+
+    int current = *std::max_element(order.begin(), order.end(), [&](int a, int b) { return size[a] < size[b]; });
+    if (size[current] <= 0.0f)
+        return -1;
+    while (true) {
+        int heaviest = -1;
+        for (int i = child_offsets[current]; i < child_offsets[current + 1]; i++)
+            if (size[children[i]] > 0.0f && (heaviest < 0 || size[children[i]] > size[heaviest]))
+                heaviest = children[i];
+        if (heaviest < 0)
+            return current;
+        current = heaviest;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef LANDMARKS_H
+#define LANDMARKS_H
+
+#include <cstdint>
+#include <vector>
+#include "graph.h"
+
+class RouteModel;
+
+// Precomputed shortest distances between every node of a Graph and a few
+// landmark nodes, for the ALT lower bound (A*, Landmarks, Triangle inequality):
+// for any landmark L, d(v, t) >= d(L, t) - d(L, v) and d(v, t) >= d(v, L) - d(t, L).
+// Unlike the straight-line distance the bound knows about detours, so on a
+// map where a river is only crossed at a few bridges A* heads for the right
+// bridge instead of flooding the river bank.
+//
+// Landmarks work best behind the nodes that queries run between, which is
+// what both selection strategies aim for:
+//  - Farthest picks each landmark as far as possible from those already chosen.
+//  - Avoid grows a shortest path tree from a random node and follows it to the
+//    region whose distances the chosen landmarks bound worst.
+class Landmarks {
+  public:
+    enum class Selection { Farthest, Avoid };
+
+    Landmarks() {}
+    // Picks up to `count` landmarks among the nodes with edges; `seed` fixes
+    // the random choices, so the same graph always gets the same landmarks.
+    Landmarks(const Graph &graph, int count, Selection selection = Selection::Avoid, unsigned seed = 1);
+    // Picks them on the graph of one profile of `model`, remembering the
+    // profile and the RouteModel::GraphVersion they were computed for.
+    Landmarks(const RouteModel &model, int profile, int count, Selection selection = Selection::Avoid,
+              unsigned seed = 1);
+
+    int Count() const { return (int)nodes.size(); }
+    int NodeCount() const { return node_count; }
+    const std::vector<int> &Nodes() const { return nodes; }
+    // Profile and graph version the landmarks were computed for; -1 and 0 for
+    // ones computed on a bare Graph.
+    int Profile() const { return profile; }
+    std::uint64_t GraphVersion() const { return graph_version; }
+
+    // Lower bound on the length of a path from `from` to `to`, 0 when no
+    // landmark knows better.
+    float LowerBound(int from, int to) const;
+
+    // Bytes held by the distance tables.
+    std::size_t MemoryUsage() const { return (from_landmark.size() + to_landmark.size()) * sizeof(float); }
+
+  private:
+    void AddLandmark(int node, const Graph &graph, const Graph &reverse);
+    int SelectFarthest(const std::vector<int> &candidates) const;
+    int SelectAvoid(const Graph &graph, int root) const;
+
+    std::vector<int> nodes;
+    int node_count = 0;
+    // Node-major tables: the distances of one node to all landmarks sit next
+    // to each other, [node * stride + landmark].
+    int stride = 0;
+    std::vector<float> from_landmark;  // d(landmark, node)
+    std::vector<float> to_landmark;    // d(node, landmark)
+    int profile = -1;
+    std::uint64_t graph_version = 0;
+};
+
+#endif
@@ -7,39 +7,82 @@
 #include "route_model.h"
 #include "render.h"
 #include "route_planner.h"
+#include "graph_cache.h"
+#include "isochrone.h"
+#include "read_file.h"
 
 using namespace std::experimental;
 
-static std::optional<std::vector<std::byte>> ReadFile(const std::string &path)
-{   
-    std::ifstream is{path, std::ios::binary | std::ios::ate};
-    if( !is )
-        return std::nullopt;
-    
-    auto size = is.tellg();
-    std::vector<std::byte> contents(size);    
-    
-    is.seekg(0);
-    is.read((char*)contents.data(), size);
+// Restores the model from `<osm file>.cache` when that cache was built from the
+// same OSM data in the same node order, otherwise parses the XML and writes a
+// fresh cache next to it.
+static RouteModel LoadModel(const std::string &osm_data_file, const std::vector<std::byte> &osm_data, Model::NodeOrder order)
+{
+    auto checksum = GraphCache::Checksum(osm_data.data(), osm_data.size());
+    auto cache_file = osm_data_file + ".cache";
+    if( auto cache = GraphCache::Open(cache_file, checksum) ) {
+        try {
+            RouteModel model{*cache};
+            if( model.Order() == order )
+                return model;
+        }
+        catch( const std::logic_error &e ) {
+            std::cout << "Ignoring damaged graph cache: " << e.what() << std::endl;
+        }
+    }
+
+    RouteModel model{osm_data, 0, order};
+    if( !GraphCache::Save(cache_file, model, checksum) )
+        std::cout << "Failed to write the graph cache " << cache_file << std::endl;
+    return model;
+}
 
-    if( contents.empty() )
-        return std::nullopt;
-    return std::move(contents);
+static void PrintUsage()
+{
+    std::cout << "Usage: [executable] [-f filename.osm] [-p car|car-fastest|walking] [-i budget] [-t] [-a] [-o file|hilbert|bfs]" << std::endl;
 }
 
 int main(int argc, const char **argv)
 {    
     std::string osm_data_file = "";
+    std::string profile_name = "car";
+    float isochrone_budget = 0.f;
+    bool edge_based = false;
+    bool alternatives = false;
+    auto node_order = Model::NodeOrder::File;
     if( argc > 1 ) {
-        for( int i = 1; i < argc; ++i )
+        for( int i = 1; i < argc; ++i ) {
             if( std::string_view{argv[i]} == "-f" && ++i < argc )
                 osm_data_file = argv[i];
+            else if( std::string_view{argv[i]} == "-p" && ++i < argc )
+                profile_name = argv[i];
+            else if( std::string_view{argv[i]} == "-i" && ++i < argc )
+                isochrone_budget = std::stof(argv[i]);
+            else if( std::string_view{argv[i]} == "-t" )
+                edge_based = true;
+            else if( std::string_view{argv[i]} == "-a" )
+                alternatives = true;
+            else if( std::string_view{argv[i]} == "-o" && ++i < argc ) {
+                if( std::string_view{argv[i]} == "file" )
+                    node_order = Model::NodeOrder::File;
+                else if( std::string_view{argv[i]} == "hilbert" )
+                    node_order = Model::NodeOrder::Hilbert;
+                else if( std::string_view{argv[i]} == "bfs" )
+                    node_order = Model::NodeOrder::BreadthFirst;
+                else {
+                    std::cout << "Unknown node ordering: " << argv[i] << std::endl;
+                    PrintUsage();
+                    return 1;
+                }
+            }
+        }
     }
     else {
         std::cout << "To specify a map file use the following format: " << std::endl;
-        std::cout << "Usage: [executable] [-f filename.osm]" << std::endl;
-        osm_data_file = "../map.osm";
+        PrintUsage();
     }
+    if( osm_data_file.empty() )
+        osm_data_file = "../map.osm";
     
     std::vector<std::byte> osm_data;
  
@@ -62,16 +105,33 @@ int main(int argc, const char **argv)
   	std::cin >> end_x >> end_y;
 
     // Build Model.
-    RouteModel model{osm_data};
+    RouteModel model = LoadModel(osm_data_file, osm_data, node_order);
+
+    int profile = model.FindProfile(profile_name);
+    if( profile < 0 ) {
+        std::cout << "Unknown routing profile: " << profile_name << std::endl;
+        return 1;
+    }
 
     // Create RoutePlanner object and perform A* search.
-    RoutePlanner route_planner{model, start_x, start_y, end_x, end_y};
-    route_planner.AStarSearch();
+    RoutePlanner route_planner{model, start_x, start_y, end_x, end_y, RoutePlanner::Snap::ToEdge, profile};
+    if( edge_based )
+        route_planner.EdgeBasedAStarSearch();
+    else if( alternatives ) {
+        auto routes = route_planner.AlternativeRoutesSearch();
+        for( std::size_t i = 1; i < routes.size(); ++i )
+            std::cout << "Alternative " << i << ": " << routes[i].Length() << " meters. \n";
+    }
+    else
+        route_planner.AStarSearch();
 
     std::cout << "Distance: " << route_planner.GetDistance() << " meters. \n";
 
     // Render results of search.
-    Render render{model};
+    std::vector<Model::Node> isochrone;
+    if( isochrone_budget > 0.f )
+        isochrone = Isochrone{model, start_x, start_y, isochrone_budget, RoutePlanner::Snap::ToEdge, profile}.Boundary();
+    Render render{model, route_planner.GetPath(), std::move(isochrone)};
 
     auto display = io2d::output_surface{400, 400, io2d::format::argb32, io2d::scaling::none, io2d::refresh_style::fixed, 30};
     display.size_change_callback([](io2d::output_surface& surface){
@@ -0,0 +1,77 @@
+#include "mapped_file.h"
+#include <fstream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_POSIX 1
+#endif
+
+std::optional<MappedFile> MappedFile::Open(const std::string &path) {
+    MappedFile file;
+#ifdef MAPPED_FILE_POSIX
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return std::nullopt;
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return std::nullopt;
+    }
+    void *address = ::mmap(nullptr, (std::size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED)
+        return std::nullopt;
+    file.data = static_cast<const std::byte *>(address);
+    file.size = (std::size_t)info.st_size;
+    file.mapped = true;
+#else
+    std::ifstream is{path, std::ios::binary | std::ios::ate};
+    if (!is)
+        return std::nullopt;
+    file.buffer.resize((std::size_t)is.tellg());
+    is.seekg(0);
+    is.read((char *)file.buffer.data(), file.buffer.size());
+    if (!is || file.buffer.empty())
+        return std::nullopt;
+    file.data = file.buffer.data();
+    file.size = file.buffer.size();
+#endif
+    return std::optional<MappedFile>{std::move(file)};
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        Release();
+        buffer = std::move(other.buffer);
+        data = other.mapped ? other.data : buffer.data();
+        size = other.size;
+        mapped = other.mapped;
+        other.data = nullptr;
+        other.size = 0;
+        other.mapped = false;
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    Release();
+}
+
+void MappedFile::Release() {
+#ifdef MAPPED_FILE_POSIX
+    if (mapped)
+        ::munmap(const_cast<std::byte *>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+    mapped = false;
+    buffer.clear();
+}
@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. On POSIX systems the file is mmap'ed, so
+// opening it costs nothing up front and pages are loaded as they are touched;
+// elsewhere it falls back to reading the file into memory.
+class MappedFile {
+  public:
+    static std::optional<MappedFile> Open(const std::string &path);
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    const std::byte *Data() const { return data; }
+    std::size_t Size() const { return size; }
+
+  private:
+    MappedFile() {}
+    void Release();
+
+    const std::byte *data = nullptr;
+    std::size_t size = 0;
+    bool mapped = false;
+    std::vector<std::byte> buffer;
+};
+
+#endif
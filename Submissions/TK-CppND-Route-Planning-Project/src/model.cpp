@@ -1,10 +1,19 @@
 #include "model.h"
-#include "pugixml.hpp"
+#include "graph_cache.h"
+#include "id_map.h"
+#include "node_order.h"
+#include "osm_reader.h"
+#include "thread_pool.h"
 #include <iostream>
 #include <string_view>
 #include <cmath>
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
 #include <algorithm>
-#include <assert.h>
+#include <iterator>
 
 static Model::Road::Type String2RoadType(std::string_view type)
 {
@@ -37,146 +46,504 @@ static Model::Landuse::Type String2LanduseType(std::string_view type)
     return Model::Landuse::Invalid;
 }
 
-Model::Model( const std::vector<std::byte> &xml )
+Model::Model( const std::vector<std::byte> &xml, int thread_count, NodeOrder order )
 {
-    LoadData(xml);
+    ThreadPool pool{thread_count};
 
-    AdjustCoordinates();
+    std::vector<LonLat> positions;
+    LoadData(xml, pool, positions);
+
+    AdjustCoordinates(pool, positions);
+
+    if( order == NodeOrder::Hilbert )
+        Renumber(HilbertOrder(m_Nodes));
+    else if( order == NodeOrder::BreadthFirst )
+        Renumber(BreadthFirstOrder(*this));
+    m_Order = order;
 
     std::sort(m_Roads.begin(), m_Roads.end(), [](const auto &_1st, const auto &_2nd){
         return (int)_1st.type < (int)_2nd.type; 
     });
 }
 
-void Model::LoadData(const std::vector<std::byte> &xml)
+// Rebuilds the multipolygons stored by GraphCache::Save from their four
+// sections: outer offsets, outer ways, inner offsets, inner ways. The ways are
+// appended to `ring_ways`, each multipolygon's outer rings before its inner.
+template <typename Multipolygon>
+static std::vector<Multipolygon> ReadMultipolygons(const GraphCache &cache, std::uint32_t first, std::vector<int> &ring_ways)
 {
-    using namespace pugi;
-    
-    xml_document doc;
-    if( !doc.load_buffer(xml.data(), xml.size()) )
-        throw std::logic_error("failed to parse the xml file");
-    
-    if( auto bounds = doc.select_nodes("/osm/bounds"); !bounds.empty() ) {
-        auto node = bounds.first().node();
-        m_MinLat = atof(node.attribute("minlat").as_string());
-        m_MaxLat = atof(node.attribute("maxlat").as_string());
-        m_MinLon = atof(node.attribute("minlon").as_string());
-        m_MaxLon = atof(node.attribute("maxlon").as_string());
+    auto outer_offsets = cache.Read<int>(GraphCache::Section(first));
+    auto outer = cache.Read<int>(GraphCache::Section(first + 1));
+    auto inner_offsets = cache.Read<int>(GraphCache::Section(first + 2));
+    auto inner = cache.Read<int>(GraphCache::Section(first + 3));
+    if( outer_offsets.size() != inner_offsets.size() || outer_offsets.empty() ||
+        outer_offsets.back() != (int)outer.size() || inner_offsets.back() != (int)inner.size() )
+        throw std::logic_error("graph cache holds malformed multipolygons");
+
+    auto append = [&]( const std::vector<int> &ways, int first, int last ) {
+        if( first < 0 || last < first || last > (int)ways.size() )
+            throw std::logic_error("graph cache holds malformed multipolygons");
+        Model::Span span{(int)ring_ways.size(), last - first};
+        ring_ways.insert(ring_ways.end(), ways.begin() + first, ways.begin() + last);
+        return span;
+    };
+    std::vector<Multipolygon> multipolygons(outer_offsets.size() - 1);
+    ring_ways.reserve(ring_ways.size() + outer.size() + inner.size());
+    for( size_t i = 0; i < multipolygons.size(); ++i ) {
+        multipolygons[i].outer = append(outer, outer_offsets[i], outer_offsets[i + 1]);
+        multipolygons[i].inner = append(inner, inner_offsets[i], inner_offsets[i + 1]);
     }
-    else 
-        throw std::logic_error("map's bounds are not defined");
+    return multipolygons;
+}
+
+Model::Model( const GraphCache &cache )
+{
+    auto bounds = cache.Read<double>(GraphCache::Bounds);
+    if( bounds.size() != 5 )
+        throw std::logic_error("graph cache holds malformed bounds");
+    m_MinLat = bounds[0];
+    m_MaxLat = bounds[1];
+    m_MinLon = bounds[2];
+    m_MaxLon = bounds[3];
+    m_MetricScale = bounds[4];
 
-    std::unordered_map<std::string, int> node_id_to_num;
-    for( const auto &node: doc.select_nodes("/osm/node") ) {
-        node_id_to_num[node.node().attribute("id").as_string()] = (int)m_Nodes.size();
-        m_Nodes.emplace_back();        
-        m_Nodes.back().y = atof(node.node().attribute("lat").as_string());
-        m_Nodes.back().x = atof(node.node().attribute("lon").as_string());
+    m_Nodes.m_Xs = cache.View<float>(GraphCache::NodeXs);
+    m_Nodes.m_Ys = cache.View<float>(GraphCache::NodeYs);
+    if( m_Nodes.m_Xs.size() != m_Nodes.m_Ys.size() )
+        throw std::logic_error("graph cache holds malformed nodes");
+    auto order = cache.Read<NodeOrder>(GraphCache::NodeOrdering);
+    m_FileIndex = cache.Read<int>(GraphCache::FileIndices);
+    if( order.size() != 1 || (order[0] == NodeOrder::File) != m_FileIndex.empty() ||
+        (!m_FileIndex.empty() && m_FileIndex.size() != m_Nodes.size()) )
+        throw std::logic_error("graph cache holds a malformed node order");
+    m_Order = order[0];
+    if( !m_FileIndex.empty() ) {
+        m_NodeIndex.assign(m_Nodes.size(), -1);
+        for( int node = 0; node < (int)m_Nodes.size(); ++node ) {
+            const int file_index = m_FileIndex[node];
+            if( file_index < 0 || file_index >= (int)m_Nodes.size() || m_NodeIndex[file_index] >= 0 )
+                throw std::logic_error("graph cache holds a malformed node order");
+            m_NodeIndex[file_index] = node;
+        }
+    }
+    auto way_offsets = cache.Read<int>(GraphCache::WayOffsets);
+    m_WayNodes = cache.Read<int>(GraphCache::WayNodes);
+    if( way_offsets.empty() || way_offsets.front() != 0 || way_offsets.back() != (int)m_WayNodes.size() )
+        throw std::logic_error("graph cache holds malformed ways");
+    m_Ways.resize(way_offsets.size() - 1);
+    for( size_t i = 0; i < m_Ways.size(); ++i ) {
+        if( way_offsets[i + 1] < way_offsets[i] )
+            throw std::logic_error("graph cache holds malformed ways");
+        m_Ways[i].nodes = {way_offsets[i], way_offsets[i + 1] - way_offsets[i]};
     }
 
-    std::unordered_map<std::string, int> way_id_to_num;    
-    for( const auto &way: doc.select_nodes("/osm/way") ) {
-        auto node = way.node();
-        
-        const auto way_num = (int)m_Ways.size();
-        way_id_to_num[node.attribute("id").as_string()] = way_num;
-        m_Ways.emplace_back();
-        auto &new_way = m_Ways.back();
-        
-        for( auto child: node.children() ) {
-            auto name = std::string_view{child.name()}; 
-            if( name == "nd" ) {
-                auto ref = child.attribute("ref").as_string();
-                if( auto it = node_id_to_num.find(ref); it != end(node_id_to_num) )
-                    new_way.nodes.emplace_back(it->second);
-            }
-            else if( name == "tag" ) {
-                auto category = std::string_view{child.attribute("k").as_string()};
-                auto type = std::string_view{child.attribute("v").as_string()};
-                if( category == "highway" ) {
-                    if( auto road_type = String2RoadType(type); road_type != Road::Invalid ) {
-                        m_Roads.emplace_back();
-                        m_Roads.back().way = way_num;
-                        m_Roads.back().type = road_type;
-                    }
-                }
-                if( category == "railway" ) {
-                    m_Railways.emplace_back();
-                    m_Railways.back().way = way_num;
-                }                
-                else if( category == "building" ) {
-                    m_Buildings.emplace_back();
-                    m_Buildings.back().outer = {way_num};
-                }
-                else if( category == "leisure" ||
-                        (category == "natural" && (type == "wood"  || type == "tree_row" || type == "scrub" || type == "grassland")) ||
-                        (category == "landcover" && type == "grass" ) ) {
-                    m_Leisures.emplace_back();
-                    m_Leisures.back().outer = {way_num};
-                }
-                else if( category == "natural" && type == "water" ) {
-                    m_Waters.emplace_back();
-                    m_Waters.back().outer = {way_num};
-                }
-                else if( category == "landuse" ) {
-                    if( auto landuse_type = String2LanduseType(type); landuse_type != Landuse::Invalid ) {
-                        m_Landuses.emplace_back();
-                        m_Landuses.back().outer = {way_num};
-                        m_Landuses.back().type = landuse_type;
-                    }                    
-                }
-            }
+    m_Roads = cache.Read<Road>(GraphCache::Roads);
+    m_Railways = cache.Read<Railway>(GraphCache::Railways);
+    m_Buildings = ReadMultipolygons<Building>(cache, GraphCache::Buildings, m_RingWays);
+    m_Leisures = ReadMultipolygons<Leisure>(cache, GraphCache::Leisures, m_RingWays);
+    m_Waters = ReadMultipolygons<Water>(cache, GraphCache::Waters, m_RingWays);
+    m_Landuses = ReadMultipolygons<Landuse>(cache, GraphCache::Landuses, m_RingWays);
+    auto landuse_types = cache.Read<Landuse::Type>(GraphCache::LanduseTypes);
+    if( landuse_types.size() != m_Landuses.size() )
+        throw std::logic_error("graph cache holds malformed landuses");
+    for( size_t i = 0; i < m_Landuses.size(); ++i )
+        m_Landuses[i].type = landuse_types[i];
+    m_TurnRestrictions = cache.Read<TurnRestriction>(GraphCache::TurnRestrictions);
+}
+
+static double ParseCoordinate(std::string_view value)
+{
+    double result = 0.;
+    if( auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+        ec != std::errc{} || ptr != value.data() + value.size() || !std::isfinite(result) )
+        throw std::logic_error("invalid OSM coordinate \"" + std::string{value} + "\"");
+    return result;
+}
+
+static std::int64_t ParseId(std::string_view value)
+{
+    std::int64_t id = 0;
+    if( auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), id);
+        ec != std::errc{} || ptr != value.data() + value.size() )
+        throw std::logic_error("invalid OSM id \"" + std::string{value} + "\"");
+    return id;
+}
+
+// Bytes of XML handed to one parse task.
+static constexpr std::size_t kChunkSize = 1 << 20;
+
+namespace {
+
+// Nodes read from one chunk of the node section.
+struct NodeChunk {
+    std::vector<std::int64_t> ids;
+    std::vector<double> lons;
+    std::vector<double> lats;
+};
+
+// Ways read from one chunk of the way section. Way numbers in roads and
+// ring_ways count from the first way of the chunk, and the spans of ways and
+// multipolygons from the start of the chunk's own way_nodes and ring_ways.
+struct WayChunk {
+    std::vector<std::int64_t> ids;
+    std::vector<Model::Way> ways;
+    std::vector<int> way_nodes;
+    std::vector<int> ring_ways;
+    std::vector<Model::Road> roads;
+    std::vector<Model::Railway> railways;
+    std::vector<Model::Building> buildings;
+    std::vector<Model::Leisure> leisures;
+    std::vector<Model::Water> waters;
+    std::vector<Model::Landuse> landuses;
+};
+
+// Byte offsets where the node, way and relation sections begin and where the
+// last of them ends.
+struct Sections {
+    std::size_t nodes, ways, relations, end;
+};
+
+}
+
+// Locates the sections of a file that lists all nodes, then all ways, then all
+// relations, as OSM exports do. Other files are read front to back instead.
+static std::optional<Sections> FindSections(std::string_view text)
+{
+    constexpr auto npos = std::string_view::npos;
+    const auto first_node = text.find("<node "), last_node = text.rfind("<node ");
+    const auto first_way = text.find("<way "), last_way = text.rfind("<way ");
+    const auto first_relation = text.find("<relation ");
+    const auto end = text.rfind("</osm>");
+    if( first_node == npos || end == npos )
+        return std::nullopt;
+
+    Sections sections;
+    sections.nodes = first_node;
+    sections.relations = first_relation != npos ? first_relation : end;
+    sections.ways = first_way != npos ? first_way : sections.relations;
+    sections.end = end;
+    if( last_node > sections.ways || (last_way != npos && last_way > sections.relations) )
+        return std::nullopt;
+    return sections;
+}
+
+// Cuts [begin, end) into pieces of about `chunk_size` bytes, each starting at
+// `tag`, so every piece holds whole elements.
+static std::vector<std::size_t> SplitSection(std::string_view text, std::size_t begin, std::size_t end,
+                                             std::string_view tag, std::size_t chunk_size)
+{
+    std::vector<std::size_t> bounds{begin};
+    for( auto target = begin + chunk_size; target < end; target += chunk_size ) {
+        auto pos = text.find(tag, target);
+        if( pos >= end )
+            break;
+        if( pos > bounds.back() )
+            bounds.push_back(pos);
+    }
+    bounds.push_back(end);
+    return bounds;
+}
+
+static NodeChunk ParseNodes(const std::byte *data, std::size_t size)
+{
+    NodeChunk chunk;
+    OsmReader reader{data, size, OsmReader::Fragment};
+    for( auto event = reader.Next(); event != OsmReader::EndOfDocument; event = reader.Next() )
+        if( event == OsmReader::StartElement && reader.Name() == "node" ) {
+            chunk.ids.emplace_back(ParseId(reader.Attribute("id")));
+            chunk.lats.emplace_back(ParseCoordinate(reader.Attribute("lat")));
+            chunk.lons.emplace_back(ParseCoordinate(reader.Attribute("lon")));
+        }
+    return chunk;
+}
+
+static void AddWayTag(WayChunk &chunk, int way_num, std::string_view category, std::string_view type)
+{
+    // Way-based multipolygons have the way as their single outer ring.
+    auto add_ring = [&]( Model::Multipolygon &mp ) {
+        mp.outer = {(int)chunk.ring_ways.size(), 1};
+        chunk.ring_ways.emplace_back(way_num);
+    };
+
+    if( category == "highway" ) {
+        if( auto road_type = String2RoadType(type); road_type != Model::Road::Invalid ) {
+            chunk.roads.emplace_back();
+            chunk.roads.back().way = way_num;
+            chunk.roads.back().type = road_type;
         }
     }
-    
-    for( const auto &relation: doc.select_nodes("/osm/relation") ) {
-        auto node = relation.node();
-        auto noode_id = std::string_view{node.attribute("id").as_string()};
-        std::vector<int> outer, inner;
-        auto commit = [&](Multipolygon &mp) {
-            mp.outer = std::move(outer);
-            mp.inner = std::move(inner);
-        };
-        for( auto child: node.children() ) {
-            auto name = std::string_view{child.name()}; 
-            if( name == "member" ) {
-                if( std::string_view{child.attribute("type").as_string()} == "way" ) {
-                    if( !way_id_to_num.count(child.attribute("ref").as_string()) )
-                        continue;
-                    auto way_num = way_id_to_num[child.attribute("ref").as_string()];
-                    if( std::string_view{child.attribute("role").as_string()} == "outer" )
-                        outer.emplace_back(way_num);
-                    else
-                        inner.emplace_back(way_num);
-                }
+    if( category == "railway" ) {
+        chunk.railways.emplace_back();
+        chunk.railways.back().way = way_num;
+    }
+    else if( category == "building" ) {
+        add_ring( chunk.buildings.emplace_back() );
+    }
+    else if( category == "leisure" ||
+            (category == "natural" && (type == "wood"  || type == "tree_row" || type == "scrub" || type == "grassland")) ||
+            (category == "landcover" && type == "grass" ) ) {
+        add_ring( chunk.leisures.emplace_back() );
+    }
+    else if( category == "natural" && type == "water" ) {
+        add_ring( chunk.waters.emplace_back() );
+    }
+    else if( category == "landuse" ) {
+        if( auto landuse_type = String2LanduseType(type); landuse_type != Model::Landuse::Invalid ) {
+            add_ring( chunk.landuses.emplace_back() );
+            chunk.landuses.back().type = landuse_type;
+        }
+    }
+}
+
+static WayChunk ParseWays(const std::byte *data, std::size_t size, const IdMap &node_id_to_num)
+{
+    WayChunk chunk;
+    OsmReader reader{data, size, OsmReader::Fragment};
+    bool in_way = false;
+    for( auto event = reader.Next(); event != OsmReader::EndOfDocument; event = reader.Next() ) {
+        auto name = reader.Name();
+        if( event == OsmReader::EndElement ) {
+            if( name == "way" )
+                in_way = false;
+        }
+        else if( name == "way" ) {
+            in_way = true;
+            chunk.ids.emplace_back(ParseId(reader.Attribute("id")));
+            chunk.ways.emplace_back().nodes.offset = (int)chunk.way_nodes.size();
+        }
+        else if( name == "nd" && in_way ) {
+            if( auto node_num = node_id_to_num.Find(ParseId(reader.Attribute("ref"))); node_num != IdMap::kMissing ) {
+                chunk.way_nodes.emplace_back(node_num);
+                chunk.ways.back().nodes.length++;
             }
-            else if( name == "tag" ) { 
-                auto category = std::string_view{child.attribute("k").as_string()};
-                auto type = std::string_view{child.attribute("v").as_string()};
-                if( category == "building" ) {
+        }
+        else if( name == "tag" && in_way )
+            AddWayTag(chunk, (int)chunk.ways.size() - 1, reader.Attribute("k"), reader.Attribute("v"));
+    }
+    return chunk;
+}
+
+// Moves the roads, railways or multipolygons of a chunk over, renumbering
+// their ways by `way_offset` and moving their ring spans by `ring_offset`.
+template <typename T>
+static void AppendShifted(std::vector<T> &to, std::vector<T> &from, int way_offset, int ring_offset)
+{
+    for( auto &item: from ) {
+        if constexpr( std::is_base_of_v<Model::Multipolygon, T> )
+            item.outer.offset += ring_offset;
+        else
+            item.way += way_offset;
+        to.emplace_back(std::move(item));
+    }
+}
+
+void Model::LoadData(const std::vector<std::byte> &xml, ThreadPool &pool, std::vector<LonLat> &positions)
+{
+    const std::string_view text{reinterpret_cast<const char *>(xml.data()), xml.size()};
+    const auto sections = FindSections(text);
+    // Without a known layout every pass reads the whole document.
+    std::size_t nodes_begin = 0, nodes_end = xml.size(), ways_begin = 0, ways_end = xml.size();
+    if( sections ) {
+        nodes_begin = sections->nodes;
+        nodes_end = ways_begin = sections->ways;
+        ways_end = sections->relations;
+    }
+
+    // Nodes, in chunks parsed side by side.
+    auto node_bounds = SplitSection(text, nodes_begin, nodes_end, "<node ", kChunkSize);
+    std::vector<NodeChunk> node_chunks(node_bounds.size() - 1);
+    pool.ParallelFor((int)node_chunks.size(), [&](int i) {
+        node_chunks[i] = ParseNodes(xml.data() + node_bounds[i], node_bounds[i + 1] - node_bounds[i]);
+    });
+    std::size_t node_count = 0;
+    for( auto &chunk: node_chunks )
+        node_count += chunk.ids.size();
+    IdMap node_id_to_num{node_count};
+    positions.reserve(node_count);
+    for( auto &chunk: node_chunks ) {
+        for( std::size_t i = 0; i < chunk.ids.size(); ++i ) {
+            node_id_to_num.Insert(chunk.ids[i], (int)positions.size());
+            positions.push_back({chunk.lons[i], chunk.lats[i]});
+        }
+        chunk = NodeChunk{};
+    }
+
+    // Then ways, the same way, once every node id is known.
+    auto way_bounds = SplitSection(text, ways_begin, ways_end, "<way ", kChunkSize);
+    std::vector<WayChunk> way_chunks(way_bounds.size() - 1);
+    pool.ParallelFor((int)way_chunks.size(), [&](int i) {
+        way_chunks[i] = ParseWays(xml.data() + way_bounds[i], way_bounds[i + 1] - way_bounds[i], node_id_to_num);
+    });
+    std::size_t way_count = 0, way_node_count = 0, ring_way_count = 0;
+    for( auto &chunk: way_chunks ) {
+        way_count += chunk.ways.size();
+        way_node_count += chunk.way_nodes.size();
+        ring_way_count += chunk.ring_ways.size();
+    }
+    IdMap way_id_to_num{way_count};
+    m_Ways.reserve(way_count);
+    m_WayNodes.reserve(way_node_count);
+    m_RingWays.reserve(ring_way_count);
+    for( auto &chunk: way_chunks ) {
+        const int offset = (int)m_Ways.size();
+        const int node_offset = (int)m_WayNodes.size();
+        const int ring_offset = (int)m_RingWays.size();
+        for( std::size_t i = 0; i < chunk.ways.size(); ++i ) {
+            way_id_to_num.Insert(chunk.ids[i], (int)m_Ways.size());
+            chunk.ways[i].nodes.offset += node_offset;
+            m_Ways.emplace_back(chunk.ways[i]);
+        }
+        m_WayNodes.insert(m_WayNodes.end(), chunk.way_nodes.begin(), chunk.way_nodes.end());
+        for( auto way_num: chunk.ring_ways )
+            m_RingWays.emplace_back(way_num + offset);
+        AppendShifted(m_Roads, chunk.roads, offset, ring_offset);
+        AppendShifted(m_Railways, chunk.railways, offset, ring_offset);
+        AppendShifted(m_Buildings, chunk.buildings, offset, ring_offset);
+        AppendShifted(m_Leisures, chunk.leisures, offset, ring_offset);
+        AppendShifted(m_Waters, chunk.waters, offset, ring_offset);
+        AppendShifted(m_Landuses, chunk.landuses, offset, ring_offset);
+        chunk = WayChunk{};
+    }
+
+    // The bounds and the relations are few and read sequentially.
+    std::vector<PendingRings> pending;
+    bool has_bounds;
+    if( sections ) {
+        has_bounds = LoadRelations(xml.data(), sections->nodes, node_id_to_num, way_id_to_num, pending);
+        LoadRelations(xml.data() + sections->relations, sections->end - sections->relations, node_id_to_num,
+                      way_id_to_num, pending);
+    }
+    else
+        has_bounds = LoadRelations(xml.data(), xml.size(), node_id_to_num, way_id_to_num, pending);
+    if( !has_bounds )
+        throw std::logic_error("map's bounds are not defined");
+
+    BuildRings(pool, pending);
+}
+
+bool Model::LoadRelations(const std::byte *data, std::size_t size, const IdMap &node_id_to_num,
+                          const IdMap &way_id_to_num, std::vector<PendingRings> &pending)
+{
+    OsmReader reader{data, size, OsmReader::Fragment};
+
+    // What the relation being read turns into, decided by its first relevant tag.
+    enum class RelationKind { None, Undecided, Building, Water, Landuse, Restriction, Ignored } relation_kind = RelationKind::None;
+
+    bool has_bounds = false;
+    std::vector<int> outer, inner;
+    Landuse::Type relation_landuse = Landuse::Invalid;
+    // Members and value of a turn restriction. The value may be tagged before
+    // or after type=restriction, and restriction:motorcar overrides restriction.
+    int from_way = -1, to_way = -1, via_node = IdMap::kMissing;
+    bool via_way = false;
+    std::string_view restriction, motorcar_restriction;
+
+    // Members come in any order of roles, so they are gathered apart and then
+    // laid out as the outer rings followed by the inner ones.
+    auto commit = [&](Multipolygon &mp) {
+        mp.outer = {(int)m_RingWays.size(), (int)outer.size()};
+        m_RingWays.insert(m_RingWays.end(), outer.begin(), outer.end());
+        mp.inner = {(int)m_RingWays.size(), (int)inner.size()};
+        m_RingWays.insert(m_RingWays.end(), inner.begin(), inner.end());
+    };
+
+    for( auto event = reader.Next(); event != OsmReader::EndOfDocument; event = reader.Next() ) {
+        auto name = reader.Name();
+        if( event == OsmReader::EndElement ) {
+            if( name == "relation" ) {
+                if( relation_kind == RelationKind::Building )
                     commit( m_Buildings.emplace_back() );
-                    break;
-                }
-                if( category == "natural" && type == "water" ) {
+                else if( relation_kind == RelationKind::Water ) {
                     commit( m_Waters.emplace_back() );
-                    BuildRings(m_Waters.back());
-                    break;
+                    pending.push_back({true, (int)m_Waters.size() - 1});
+                }
+                else if( relation_kind == RelationKind::Landuse ) {
+                    commit( m_Landuses.emplace_back() );
+                    m_Landuses.back().type = relation_landuse;
+                    pending.push_back({false, (int)m_Landuses.size() - 1});
                 }
-                if( category == "landuse" ) {
-                    if( auto landuse_type = String2LanduseType(type); landuse_type != Landuse::Invalid ) {
-                        commit( m_Landuses.emplace_back() );
-                        m_Landuses.back().type = landuse_type;
-                        BuildRings(m_Landuses.back());
-                    }
-                    break;
+                else if( relation_kind == RelationKind::Restriction ) {
+                    auto value = motorcar_restriction.empty() ? restriction : motorcar_restriction;
+                    const bool only = value.substr(0, 5) == "only_";
+                    const auto kind = value.substr(only ? 5 : 3);
+                    auto turn = TurnKind::Any;
+                    if( kind == "left_turn" )
+                        turn = TurnKind::Left;
+                    else if( kind == "right_turn" )
+                        turn = TurnKind::Right;
+                    else if( kind == "straight_on" )
+                        turn = TurnKind::Straight;
+                    else if( kind == "u_turn" )
+                        turn = TurnKind::UTurn;
+                    if( (only || value.substr(0, 3) == "no_") && from_way >= 0 && to_way >= 0 &&
+                        via_node != IdMap::kMissing && !via_way )
+                        m_TurnRestrictions.push_back({from_way, via_node, to_way, only, turn});
                 }
+                outer.clear();
+                inner.clear();
+                from_way = to_way = -1;
+                via_node = IdMap::kMissing;
+                via_way = false;
+                restriction = motorcar_restriction = {};
+                relation_kind = RelationKind::None;
+            }
+            continue;
+        }
+
+        if( name == "relation" )
+            relation_kind = RelationKind::Undecided;
+        else if( name == "member" && relation_kind != RelationKind::None ) {
+            auto type = reader.Attribute("type");
+            auto role = reader.Attribute("role");
+            if( type == "node" && role == "via" )
+                via_node = node_id_to_num.Find(ParseId(reader.Attribute("ref")));
+            if( type != "way" )
+                continue;
+            if( role == "via" )
+                via_way = true;
+            auto member_num = way_id_to_num.Find(ParseId(reader.Attribute("ref")));
+            if( member_num == IdMap::kMissing )
+                continue;
+            if( role == "outer" )
+                outer.emplace_back(member_num);
+            else if( role == "from" )
+                from_way = member_num;
+            else if( role == "to" )
+                to_way = member_num;
+            else if( role != "via" )
+                inner.emplace_back(member_num);
+        }
+        else if( name == "tag" && relation_kind != RelationKind::None && reader.Attribute("k") == "restriction" )
+            restriction = reader.Attribute("v");
+        else if( name == "tag" && relation_kind != RelationKind::None && reader.Attribute("k") == "restriction:motorcar" )
+            motorcar_restriction = reader.Attribute("v");
+        else if( name == "tag" && relation_kind == RelationKind::Undecided ) {
+            auto category = reader.Attribute("k");
+            auto type = reader.Attribute("v");
+            if( category == "building" )
+                relation_kind = RelationKind::Building;
+            else if( category == "natural" && type == "water" )
+                relation_kind = RelationKind::Water;
+            else if( category == "type" && type == "restriction" )
+                relation_kind = RelationKind::Restriction;
+            else if( category == "landuse" ) {
+                relation_landuse = String2LanduseType(type);
+                relation_kind = relation_landuse != Landuse::Invalid ? RelationKind::Landuse : RelationKind::Ignored;
             }
         }
+        else if( name == "bounds" && reader.Depth() == 2 ) {
+            has_bounds = true;
+            m_MinLat = ParseCoordinate(reader.Attribute("minlat"));
+            m_MaxLat = ParseCoordinate(reader.Attribute("maxlat"));
+            m_MinLon = ParseCoordinate(reader.Attribute("minlon"));
+            m_MaxLon = ParseCoordinate(reader.Attribute("maxlon"));
+        }
     }
+    return has_bounds;
 }
 
-void Model::AdjustCoordinates()
-{    
+void Model::AdjustCoordinates(ThreadPool &pool, const std::vector<LonLat> &positions)
+{
     const auto pi = 3.14159265358979323846264338327950288;
     const auto deg_to_rad = 2. * pi / 360.;
     const auto earth_radius = 6378137.;
@@ -186,96 +553,151 @@ void Model::AdjustCoordinates()
     const auto dy = lat2ym(m_MaxLat) - lat2ym(m_MinLat);
     const auto min_y = lat2ym(m_MinLat);
     const auto min_x = lon2xm(m_MinLon);
-    m_MetricScale = std::min(dx, dy);
-    for( auto &node: m_Nodes ) {
-        node.x = (lon2xm(node.x) - min_x) / m_MetricScale;
-        node.y = (lat2ym(node.y) - min_y) / m_MetricScale;        
-    }
+    const auto scale = m_MetricScale = std::min(dx, dy);
+
+    // Each node is projected on its own, so blocks of them go to different
+    // threads. The projection runs in double and only its result, relative
+    // to the map's corner, is narrowed to float.
+    constexpr int block = 1 << 14;
+    const int node_count = (int)positions.size();
+    std::vector<float> xs(node_count), ys(node_count);
+    pool.ParallelFor((node_count + block - 1) / block, [&](int b) {
+        const int last = std::min(node_count, (b + 1) * block);
+        for( int i = b * block; i < last; ++i ) {
+            xs[i] = float((lon2xm(positions[i].lon) - min_x) / scale);
+            ys[i] = float((lat2ym(positions[i].lat) - min_y) / scale);
+        }
+    });
+    m_Nodes.m_Xs = std::move(xs);
+    m_Nodes.m_Ys = std::move(ys);
 }
 
-static bool TrackRec(const std::vector<int> &open_ways,
-                     const Model::Way *ways,
-                     std::vector<bool> &used,
-                     std::vector<int> &nodes) 
+void Model::Renumber( const std::vector<int> &order )
 {
-    if( nodes.empty() ) {
-        for( int i = 0; i < open_ways.size(); ++i )
-            if( !used[i] ) {
-                used[i] = true;
-                const auto &way_nodes = ways[open_ways[i]].nodes;
-                nodes = way_nodes;
-                if( TrackRec(open_ways, ways, used, nodes) )
-                    return true;
-                nodes.clear();
-                used[i] = false;
-            }
-        return false;
-    }
-    else {
-        const auto head = nodes.front();
-        const auto tail = nodes.back();
-        if( head == tail && nodes.size() > 1 )
-            return true;
-        for( int i = 0; i < open_ways.size(); ++i )
-            if( !used[i] ) {
-                const auto &way_nodes = ways[open_ways[i]].nodes;
-                const auto way_head = way_nodes.front();
-                const auto way_tail = way_nodes.back();
-                if( way_head == tail || way_tail == tail ) {
-                    used[i] = true;
-                    const auto len = nodes.size();
-                    if( way_head == tail ) 
-                        nodes.insert(nodes.end(), way_nodes.begin(), way_nodes.end());
-                    else
-                        nodes.insert(nodes.end(), way_nodes.rbegin(), way_nodes.rend());
-                    if( TrackRec(open_ways, ways, used, nodes) )
-                        return true;
-                    nodes.resize(len);                    
-                    used[i] = false;
-                }
-            }
-        return false;
+    std::vector<int> node_index(order.size());
+    std::vector<float> xs(order.size()), ys(order.size());
+    for( int i = 0; i < (int)order.size(); ++i ) {
+        node_index[order[i]] = i;
+        xs[i] = m_Nodes.m_Xs[order[i]];
+        ys[i] = m_Nodes.m_Ys[order[i]];
     }
+    m_Nodes.m_Xs = std::move(xs);
+    m_Nodes.m_Ys = std::move(ys);
+    for( auto &node: m_WayNodes )
+        node = node_index[node];
+    for( auto &ring: m_UnclosedRings )
+        for( auto &node: ring.nodes )
+            node = node_index[node];
+    for( auto &restriction: m_TurnRestrictions )
+        restriction.via_node = node_index[restriction.via_node];
+    m_FileIndex = order;
+    m_NodeIndex = std::move(node_index);
 }
 
-static std::vector<int> Track(std::vector<int> &open_ways, const Model::Way *ways)
-{
-    assert( !open_ways.empty() );
-    std::vector<bool> used(open_ways.size(), false);
-    std::vector<int> nodes;    
-    if( TrackRec(open_ways, ways, used, nodes) )
-        for( int i = 0; i < open_ways.size(); ++i )
-            if( used[i] )
-                open_ways[i] = -1;
-    return nodes;
+namespace {
+
+// Rings for one role of a multipolygon: the member ways that are closed already,
+// the node lists of rings joined from open members, and the chains of open
+// members that could not be closed.
+struct Rings {
+    std::vector<int> closed;
+    std::vector<std::vector<int>> joined;
+    std::vector<std::vector<int>> unclosed;
+};
+
 }
 
-void Model::BuildRings( Multipolygon &mp )
+// Joins open member ways into rings. Every open way is indexed under both end
+// nodes, and a chain is grown from its tail one lookup at a time until it comes
+// back to its head, so the assembly takes time linear in the number of ways.
+// At an end shared by more than two ways the lowest numbered member is taken;
+// valid multipolygons only share ends pairwise.
+static Rings AssembleRings(const Model &model, Model::IndexRange way_nums)
 {
-    auto is_closed = []( const Model::Way &way ) {
-        return way.nodes.size() > 1 && way.nodes.front() == way.nodes.back();    
+    auto is_closed = []( Model::IndexRange nodes ) {
+        return nodes.size() > 1 && nodes.front() == nodes.back();
     };
 
-    auto process = [&]( std::vector<int> &ways_nums ) {
-        auto ways = m_Ways.data();
-        std::vector<int> closed, open;
-        
-        for( auto &way_num: ways_nums )
-            (is_closed(ways[way_num]) ? closed : open).emplace_back(way_num);  
-        
-        while( !open.empty() ) {            
-            auto new_nodes = Track(open, ways);
-            if( new_nodes.empty() )
+    Rings rings;
+    std::vector<int> open;
+    for( auto way_num: way_nums ) {
+        if( model.WayNodes(way_num).empty() )
+            continue;
+        (is_closed(model.WayNodes(way_num)) ? rings.closed : open).emplace_back(way_num);
+    }
+
+    std::unordered_multimap<int, int> ends;
+    ends.reserve(2 * open.size());
+    for( int i = 0; i < (int)open.size(); ++i ) {
+        ends.emplace(model.WayNodes(open[i]).front(), i);
+        ends.emplace(model.WayNodes(open[i]).back(), i);
+    }
+    std::vector<bool> used(open.size(), false);
+    auto unused_way_at = [&]( int node ) {
+        int found = -1;
+        auto [first, last] = ends.equal_range(node);
+        for( auto it = first; it != last; ++it )
+            if( !used[it->second] && (found < 0 || it->second < found) )
+                found = it->second;
+        return found;
+    };
+
+    for( int start = 0; start < (int)open.size(); ++start ) {
+        if( used[start] )
+            continue;
+        used[start] = true;
+        const auto start_nodes = model.WayNodes(open[start]);
+        std::vector<int> nodes(start_nodes.begin(), start_nodes.end());
+        while( nodes.size() < 2 || nodes.front() != nodes.back() ) {
+            auto next = unused_way_at(nodes.back());
+            if( next < 0 )
                 break;
-            open.erase(std::remove_if(open.begin(), open.end(), [](auto v){return v < 0;}), open.end() );
-            closed.emplace_back( (int)m_Ways.size() );
-            Model::Way new_way;
-            new_way.nodes = std::move(new_nodes);
-            m_Ways.emplace_back(new_way);
-        }        
-        std::swap(ways_nums, closed);        
+            used[next] = true;
+            const auto way_nodes = model.WayNodes(open[next]);
+            if( way_nodes.front() == nodes.back() )
+                nodes.insert(nodes.end(), way_nodes.begin(), way_nodes.end());
+            else
+                nodes.insert(nodes.end(), std::make_reverse_iterator(way_nodes.end()),
+                             std::make_reverse_iterator(way_nodes.begin()));
+        }
+        const bool closed = nodes.size() > 1 && nodes.front() == nodes.back();
+        (closed ? rings.joined : rings.unclosed).emplace_back(std::move(nodes));
+    }
+    return rings;
+}
+
+void Model::BuildRings( ThreadPool &pool, const std::vector<PendingRings> &pending )
+{
+    auto multipolygon = [&]( const PendingRings &p ) -> Multipolygon & {
+        if( p.water )
+            return m_Waters[p.index];
+        return m_Landuses[p.index];
     };
 
-    process(mp.outer);
-    process(mp.inner);
+    // Joining only reads the ways, so relations are assembled in parallel...
+    std::vector<Rings> outer(pending.size()), inner(pending.size());
+    pool.ParallelFor((int)pending.size(), [&](int i) {
+        outer[i] = AssembleRings(*this, Outer(multipolygon(pending[i])));
+        inner[i] = AssembleRings(*this, Inner(multipolygon(pending[i])));
+    });
+
+    // ...and the joined rings are added as new ways in relation order. Every
+    // joined or broken ring uses up at least one open member, so the rings
+    // that are left always fit in the span of the members, and are written
+    // over it.
+    auto commit = [&]( const PendingRings &p, Rings &rings, Span &span ) {
+        for( auto &nodes: rings.joined ) {
+            rings.closed.emplace_back( (int)m_Ways.size() );
+            m_Ways.emplace_back().nodes = {(int)m_WayNodes.size(), (int)nodes.size()};
+            m_WayNodes.insert(m_WayNodes.end(), nodes.begin(), nodes.end());
+        }
+        std::copy(rings.closed.begin(), rings.closed.end(), m_RingWays.begin() + span.offset);
+        span.length = (int)rings.closed.size();
+        for( auto &nodes: rings.unclosed )
+            m_UnclosedRings.push_back({p.water, p.index, std::move(nodes)});
+    };
+    for( size_t i = 0; i < pending.size(); ++i ) {
+        commit(pending[i], outer[i], multipolygon(pending[i]).outer);
+        commit(pending[i], inner[i], multipolygon(pending[i]).inner);
+    }
 }
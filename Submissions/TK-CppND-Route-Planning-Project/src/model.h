@@ -4,17 +4,69 @@
 #include <unordered_map>
 #include <string>
 #include <cstddef>
+#include <cstdint>
+#include "flat_array.h"
+
+class GraphCache;
+class IdMap;
+class ThreadPool;
 
 class Model
 {
 public:
     struct Node {
-        double x = 0.f;
-        double y = 0.f;
+        float x = 0.f;
+        float y = 0.f;
+    };
+
+    // Projected coordinates of every node, one array per axis. A Node is put
+    // together on access; loops over many nodes read just the floats they
+    // use, which also lets them run on SIMD lanes.
+    class NodeStore
+    {
+    public:
+        std::size_t size() const noexcept { return m_Xs.size(); }
+        bool empty() const noexcept { return m_Xs.empty(); }
+        Node operator[]( std::size_t i ) const noexcept { return {m_Xs[i], m_Ys[i]}; }
+        const float *Xs() const noexcept { return m_Xs.data(); }
+        const float *Ys() const noexcept { return m_Ys.data(); }
+
+    private:
+        friend class Model;
+        FlatArray<float> m_Xs;
+        FlatArray<float> m_Ys;
     };
     
+    // `length` consecutive entries, from `offset` on, of one of the model's
+    // flat index arrays.
+    struct Span {
+        int offset = 0;
+        int length = 0;
+    };
+
+    // Read-only view of the indices a Span covers. It stays valid as long as
+    // the model does.
+    class IndexRange
+    {
+    public:
+        IndexRange( const int *first, const int *last ) noexcept : m_First{first}, m_Last{last} {}
+
+        const int *begin() const noexcept { return m_First; }
+        const int *end() const noexcept { return m_Last; }
+        std::size_t size() const noexcept { return std::size_t(m_Last - m_First); }
+        bool empty() const noexcept { return m_First == m_Last; }
+        int front() const noexcept { return *m_First; }
+        int back() const noexcept { return m_Last[-1]; }
+        int operator[]( std::size_t i ) const noexcept { return m_First[i]; }
+
+    private:
+        const int *m_First;
+        const int *m_Last;
+    };
+
+    // Its node indices are WayNodes(way), a span of one array shared by all ways.
     struct Way {
-        std::vector<int> nodes;
+        Span nodes;
     };
     
     struct Road {
@@ -28,9 +80,11 @@ public:
         int way;
     };    
     
+    // Its way numbers are Outer(mp) and Inner(mp), spans of one array shared
+    // by all multipolygons.
     struct Multipolygon {
-        std::vector<int> outer;
-        std::vector<int> inner;
+        Span outer;
+        Span inner;
     };
     
     struct Building : Multipolygon {};
@@ -44,32 +98,110 @@ public:
         Type type;
     };
     
-    Model( const std::vector<std::byte> &xml );
+    // Chain of member ways of a water or landuse relation whose ends never
+    // meet. It is left out of Waters()[multipolygon] or Landuses()[multipolygon].
+    struct UnclosedRing {
+        bool water;
+        int multipolygon;
+        std::vector<int> nodes;
+    };
+
+    // A turn at node `via` from way `from_way` onto way `to_way`, read from
+    // a type=restriction relation. A no_* restriction forbids that turn; an
+    // only_* one (`only` set) forbids every other turn off `from_way` at `via`.
+    // `turn` is the kind of turn the value names, Any for no_entry and the
+    // like. Restrictions whose via member is a way are not kept.
+    enum class TurnKind : std::uint8_t { Any, Left, Right, Straight, UTurn };
+    struct TurnRestriction {
+        int from_way;
+        int via_node;
+        int to_way;
+        bool only;
+        TurnKind turn;
+    };
+
+    // How the nodes are numbered. File keeps the order of the OSM document;
+    // Hilbert and BreadthFirst renumber them after loading so that nodes a
+    // search visits together sit together in memory (see node_order.h).
+    enum class NodeOrder { File, Hilbert, BreadthFirst };
+
+    // Parses and projects the map on `thread_count` threads, 0 meaning one per core.
+    Model( const std::vector<std::byte> &xml, int thread_count = 0, NodeOrder order = NodeOrder::File );
+    explicit Model( const GraphCache &cache );
     
     auto MetricScale() const noexcept { return m_MetricScale; }    
     
+    auto Order() const noexcept { return m_Order; }
+    // Index a node has in file order, and the node with a given file order
+    // index, for ids that stay the same whatever the order.
+    int FileIndex( int node ) const noexcept { return m_FileIndex.empty() ? node : m_FileIndex[node]; }
+    int NodeAtFileIndex( int file_index ) const noexcept { return m_NodeIndex.empty() ? file_index : m_NodeIndex[file_index]; }
+    // FileIndex() of every node; empty in file order.
+    auto &NodePermutation() const noexcept { return m_FileIndex; }
+    
     auto &Nodes() const noexcept { return m_Nodes; }
     auto &Ways() const noexcept { return m_Ways; }
+    IndexRange WayNodes( const Way &way ) const noexcept { return Range(m_WayNodes, way.nodes); }
+    IndexRange WayNodes( int way ) const noexcept { return WayNodes(m_Ways[way]); }
+    IndexRange Outer( const Multipolygon &mp ) const noexcept { return Range(m_RingWays, mp.outer); }
+    IndexRange Inner( const Multipolygon &mp ) const noexcept { return Range(m_RingWays, mp.inner); }
+    // The arrays behind the spans: node indices of every way, way after way,
+    // and way numbers of every multipolygon ring.
+    auto &WayNodeArray() const noexcept { return m_WayNodes; }
+    auto &RingWayArray() const noexcept { return m_RingWays; }
     auto &Roads() const noexcept { return m_Roads; }
     auto &Buildings() const noexcept { return m_Buildings; }
     auto &Leisures() const noexcept { return m_Leisures; }
     auto &Waters() const noexcept { return m_Waters; }
     auto &Landuses() const noexcept { return m_Landuses; }
     auto &Railways() const noexcept { return m_Railways; }
+    auto &TurnRestrictions() const noexcept { return m_TurnRestrictions; }
+    // Rings found broken while parsing; not kept in a GraphCache.
+    auto &UnclosedRings() const noexcept { return m_UnclosedRings; }
     
 private:
-    void AdjustCoordinates();
-    void BuildRings( Multipolygon &mp );
-    void LoadData(const std::vector<std::byte> &xml);
+    friend class GraphCache;
+
+    // Position of a node as read from the file, kept until it is projected.
+    struct LonLat {
+        double lon;
+        double lat;
+    };
+
+    // A relation whose rings are still to be joined: m_Waters[index] if
+    // `water`, m_Landuses[index] otherwise.
+    struct PendingRings {
+        bool water;
+        int index;
+    };
+
+    static IndexRange Range( const std::vector<int> &array, Span span ) noexcept {
+        return {array.data() + span.offset, array.data() + span.offset + span.length};
+    }
+
+    void AdjustCoordinates( ThreadPool &pool, const std::vector<LonLat> &positions );
+    // Moves the node at index order[i] to index i.
+    void Renumber( const std::vector<int> &order );
+    void BuildRings( ThreadPool &pool, const std::vector<PendingRings> &pending );
+    void LoadData(const std::vector<std::byte> &xml, ThreadPool &pool, std::vector<LonLat> &positions);
+    bool LoadRelations(const std::byte *data, std::size_t size, const IdMap &node_id_to_num,
+                       const IdMap &way_id_to_num, std::vector<PendingRings> &pending);
     
-    std::vector<Node> m_Nodes;
+    NodeStore m_Nodes;
     std::vector<Way> m_Ways;
+    std::vector<int> m_WayNodes;
     std::vector<Road> m_Roads;
     std::vector<Railway> m_Railways;
     std::vector<Building> m_Buildings;
     std::vector<Leisure> m_Leisures;
     std::vector<Water> m_Waters;
     std::vector<Landuse> m_Landuses;
+    std::vector<int> m_RingWays;
+    std::vector<UnclosedRing> m_UnclosedRings;
+    std::vector<TurnRestriction> m_TurnRestrictions;
+    NodeOrder m_Order = NodeOrder::File;
+    std::vector<int> m_FileIndex;
+    std::vector<int> m_NodeIndex;
     
     double m_MinLat = 0.;
     double m_MaxLat = 0.;
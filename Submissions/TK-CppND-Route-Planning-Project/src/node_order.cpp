@@ -0,0 +1,92 @@
+#include "node_order.h"
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+
+// Cells per side of the grid the coordinates are snapped to.
+static constexpr std::uint32_t kHilbertSide = 1u << 16;
+
+// Distance of cell (x, y) along the Hilbert curve that fills the grid.
+static std::uint64_t HilbertDistance(std::uint32_t x, std::uint32_t y) {
+    std::uint64_t distance = 0;
+    for (std::uint32_t s = kHilbertSide / 2; s > 0; s /= 2) {
+        std::uint32_t rx = (x & s) > 0, ry = (y & s) > 0;
+        distance += std::uint64_t(s) * s * ((3 * rx) ^ ry);
+        // Rotate the quadrant so the curve inside it starts where it enters.
+        if (ry == 0) {
+            if (rx == 1) {
+                x = kHilbertSide - 1 - x;
+                y = kHilbertSide - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return distance;
+}
+
+
+std::vector<int> HilbertOrder(const Model::NodeStore &nodes) {
+    std::vector<int> order(nodes.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (nodes.empty())
+        return order;
+
+    const float *xs = nodes.Xs(), *ys = nodes.Ys();
+    double min_x = *std::min_element(xs, xs + nodes.size()), max_x = *std::max_element(xs, xs + nodes.size());
+    double min_y = *std::min_element(ys, ys + nodes.size()), max_y = *std::max_element(ys, ys + nodes.size());
+    // One scale for both axes keeps the cells square.
+    const double extent = std::max({max_x - min_x, max_y - min_y, 1e-12});
+    const double scale = (kHilbertSide - 1) / extent;
+    std::vector<std::uint64_t> keys(nodes.size());
+    for (std::size_t i = 0; i < nodes.size(); i++)
+        keys[i] = HilbertDistance((std::uint32_t)((xs[i] - min_x) * scale), (std::uint32_t)((ys[i] - min_y) * scale));
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+    return order;
+}
+
+
+std::vector<int> BreadthFirstOrder(const Model &model) {
+    const int node_count = (int)model.Nodes().size();
+
+    // Road segments in both directions, as offsets and targets per node.
+    std::vector<int> offsets(node_count + 1, 0), targets;
+    for (const Model::Road &road : model.Roads()) {
+        Model::IndexRange way_nodes = model.WayNodes(road.way);
+        for (std::size_t i = 1; i < way_nodes.size(); i++) {
+            offsets[way_nodes[i - 1] + 1]++;
+            offsets[way_nodes[i] + 1]++;
+        }
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    targets.resize(offsets.back());
+    std::vector<int> next(offsets.begin(), offsets.end() - 1);
+    for (const Model::Road &road : model.Roads()) {
+        Model::IndexRange way_nodes = model.WayNodes(road.way);
+        for (std::size_t i = 1; i < way_nodes.size(); i++) {
+            targets[next[way_nodes[i - 1]]++] = way_nodes[i];
+            targets[next[way_nodes[i]]++] = way_nodes[i - 1];
+        }
+    }
+
+    // The order itself doubles as the queue.
+    std::vector<int> order;
+    order.reserve(node_count);
+    std::vector<bool> seen(node_count, false);
+    for (int start : HilbertOrder(model.Nodes())) {
+        if (seen[start])
+            continue;
+        seen[start] = true;
+        std::size_t head = order.size();
+        order.push_back(start);
+        for (; head < order.size(); head++) {
+            const int node = order[head];
+            for (int i = offsets[node]; i < offsets[node + 1]; i++)
+                if (!seen[targets[i]]) {
+                    seen[targets[i]] = true;
+                    order.push_back(targets[i]);
+                }
+        }
+    }
+    return order;
+}
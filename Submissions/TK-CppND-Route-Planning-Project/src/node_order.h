@@ -0,0 +1,21 @@
+#ifndef NODE_ORDER_H
+#define NODE_ORDER_H
+
+#include <vector>
+#include "model.h"
+
+// Numberings of the nodes of a Model that keep nodes which a search visits
+// one after another close together in memory. Each returns, for every new
+// node index, the index the node has now.
+
+// Nodes sorted along a Hilbert curve through their coordinates, so that
+// nodes near each other on the map are mostly near each other in the arrays.
+std::vector<int> HilbertOrder(const Model::NodeStore &nodes);
+
+// Nodes in breadth-first order over the road network, which follows the way
+// a search front spreads. Every connected part of the network is started
+// from the node that comes first on the Hilbert curve, and nodes on no road
+// keep their place on the curve.
+std::vector<int> BreadthFirstOrder(const Model &model);
+
+#endif
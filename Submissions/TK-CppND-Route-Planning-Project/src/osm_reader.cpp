@@ -0,0 +1,133 @@
+#include "osm_reader.h"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+static bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+
+OsmReader::OsmReader(const std::byte *data, std::size_t size, Mode mode)
+    : begin(reinterpret_cast<const char *>(data)), pos(begin), end(begin + size), mode(mode) {}
+
+
+OsmReader::Event OsmReader::Next() {
+    attributes.clear();
+    if (pending_end) {
+        pending_end = false;
+        depth--;
+        return EndElement;
+    }
+
+    while (true) {
+        const char *open = static_cast<const char *>(std::memchr(pos, '<', end - pos));
+        if (open == nullptr) {
+            if (depth != 0 && mode == Document)
+                Fail("unexpected end of document");
+            pos = end;
+            return EndOfDocument;
+        }
+        pos = open + 1;
+        if (pos == end)
+            Fail("unexpected end of document");
+
+        if (*pos == '?') {
+            SkipPast("?>");
+        }
+        else if (*pos == '!') {
+            std::string_view rest{pos, std::size_t(end - pos)};
+            if (rest.substr(0, 3) == "!--")
+                SkipPast("-->");
+            else if (rest.substr(0, 8) == "![CDATA[")
+                SkipPast("]]>");
+            else
+                SkipPast(">");
+        }
+        else if (*pos == '/') {
+            pos++;
+            name = ReadName();
+            SkipSpace();
+            if (pos == end || *pos != '>')
+                Fail("expected '>' after an end tag");
+            pos++;
+            if (--depth < 0 && mode == Document)
+                Fail("end tag without a start tag");
+            return EndElement;
+        }
+        else {
+            name = ReadName();
+            while (true) {
+                SkipSpace();
+                if (pos == end)
+                    Fail("unexpected end of document");
+                if (*pos == '>') {
+                    pos++;
+                    depth++;
+                    return StartElement;
+                }
+                if (*pos == '/') {
+                    if (pos + 1 == end || pos[1] != '>')
+                        Fail("expected '/>'");
+                    pos += 2;
+                    depth++;
+                    pending_end = true;
+                    return StartElement;
+                }
+                std::string_view key = ReadName();
+                SkipSpace();
+                if (pos == end || *pos != '=')
+                    Fail("expected '=' after an attribute name");
+                pos++;
+                SkipSpace();
+                if (pos == end || (*pos != '"' && *pos != '\''))
+                    Fail("expected a quoted attribute value");
+                const char *value = pos + 1;
+                const char *close = static_cast<const char *>(std::memchr(value, *pos, end - value));
+                if (close == nullptr)
+                    Fail("unterminated attribute value");
+                attributes.emplace_back(key, std::string_view{value, std::size_t(close - value)});
+                pos = close + 1;
+            }
+        }
+    }
+}
+
+
+std::string_view OsmReader::Attribute(std::string_view key) const {
+    for (const auto &attribute : attributes)
+        if (attribute.first == key)
+            return attribute.second;
+    return {};
+}
+
+
+void OsmReader::Fail(const char *what) const {
+    throw std::logic_error("failed to parse the xml file: " + std::string(what) +
+                           " at byte " + std::to_string(pos - begin));
+}
+
+
+void OsmReader::SkipPast(std::string_view terminator) {
+    std::string_view rest{pos, std::size_t(end - pos)};
+    std::size_t found = rest.find(terminator);
+    if (found == std::string_view::npos)
+        Fail("unterminated markup");
+    pos += found + terminator.size();
+}
+
+
+void OsmReader::SkipSpace() {
+    while (pos != end && IsSpace(*pos))
+        pos++;
+}
+
+
+std::string_view OsmReader::ReadName() {
+    const char *first = pos;
+    while (pos != end && !IsSpace(*pos) && *pos != '>' && *pos != '/' && *pos != '=')
+        pos++;
+    if (pos == first)
+        Fail("expected a name");
+    return {first, std::size_t(pos - first)};
+}
@@ -0,0 +1,55 @@
+#ifndef OSM_READER_H
+#define OSM_READER_H
+
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Forward-only pull reader for OSM XML. Each call to Next() reports the next
+// start or end tag straight from the input buffer, so no document tree is
+// built and the names and attribute values handed out are views into the
+// buffer that stay valid as long as it does. A self-closing tag is reported as
+// a start element immediately followed by its end element.
+//
+// In Fragment mode the input may be any stretch of a document cut at tag
+// boundaries, so unmatched start and end tags are accepted; Depth() is then
+// relative to the start of the stretch and may go negative.
+//
+// Only the subset of XML found in OSM exports is understood: declarations,
+// comments, CDATA and DOCTYPE are skipped, and attribute values are returned
+// raw, without resolving entities such as &amp;.
+class OsmReader {
+  public:
+    enum Event { StartElement, EndElement, EndOfDocument };
+    enum Mode { Document, Fragment };
+
+    OsmReader(const std::byte *data, std::size_t size, Mode mode = Document);
+
+    // Advances to the next tag. Throws std::logic_error on malformed input.
+    Event Next();
+
+    // Name of the current element.
+    std::string_view Name() const { return name; }
+    // Value of an attribute of the current start element, empty when absent.
+    std::string_view Attribute(std::string_view key) const;
+    // Number of elements enclosing the current one.
+    int Depth() const { return depth; }
+
+  private:
+    [[noreturn]] void Fail(const char *what) const;
+    void SkipPast(std::string_view terminator);
+    void SkipSpace();
+    std::string_view ReadName();
+
+    const char *begin;
+    const char *pos;
+    const char *end;
+    Mode mode;
+    std::string_view name;
+    std::vector<std::pair<std::string_view, std::string_view>> attributes;
+    bool pending_end = false;
+    int depth = 0;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef READ_FILE_H
+#define READ_FILE_H
+
+#include <cstddef>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Whole contents of the file at `path`, or nothing if it cannot be read or is
+// empty.
+inline std::optional<std::vector<std::byte>> ReadFile(const std::string &path)
+{
+    std::ifstream is{path, std::ios::binary | std::ios::ate};
+    if( !is )
+        return std::nullopt;
+
+    auto size = is.tellg();
+    std::vector<std::byte> contents(size);
+
+    is.seekg(0);
+    is.read((char*)contents.data(), size);
+
+    if( contents.empty() )
+        return std::nullopt;
+    return contents;
+}
+
+#endif
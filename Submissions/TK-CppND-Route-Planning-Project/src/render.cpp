@@ -6,8 +6,10 @@ static io2d::rgba_color RoadColor(Model::Road::Type type);
 static io2d::dashes RoadDashes(Model::Road::Type type);
 static io2d::point_2d ToPoint2D( const Model::Node &node ) noexcept; 
 
-Render::Render( RouteModel &model ):
-    m_Model(model)
+Render::Render( const RouteModel &model, RoutePath path, std::vector<Model::Node> isochrone ):
+    m_Model(model),
+    m_Path(std::move(path)),
+    m_Isochrone(std::move(isochrone))
 {
     BuildRoadReps();
     BuildLanduseBrushes();
@@ -27,6 +29,7 @@ void Render::Display( io2d::output_surface &surface )
     DrawRailways(surface);
     DrawHighways(surface);    
     DrawBuildings(surface);  
+    DrawIsochrone(surface);
     DrawPath(surface);
     DrawStartPosition(surface);   
     DrawEndPosition(surface);
@@ -41,14 +44,14 @@ void Render::DrawPath(io2d::output_surface &surface) const{
 }
 
 void Render::DrawEndPosition(io2d::output_surface &surface) const{
-    if (m_Model.path.empty()) return;
+    if (m_Path.Empty()) return;
     io2d::render_props aliased{ io2d::antialias::none };
     io2d::brush foreBrush{ io2d::rgba_color::red };
 
     auto pb = io2d::path_builder{}; 
     pb.matrix(m_Matrix);
 
-    pb.new_figure({(float) m_Model.path.back().x, (float) m_Model.path.back().y});
+    pb.new_figure({(float) m_Path.end.x, (float) m_Path.end.y});
     float constexpr l_marker = 0.01f;
     pb.rel_line({l_marker, 0.f});
     pb.rel_line({0.f, l_marker});
@@ -61,7 +64,7 @@ void Render::DrawEndPosition(io2d::output_surface &surface) const{
 }
 
 void Render::DrawStartPosition(io2d::output_surface &surface) const{
-    if (m_Model.path.empty()) return;
+    if (m_Path.Empty()) return;
 
     io2d::render_props aliased{ io2d::antialias::none };
     io2d::brush foreBrush{ io2d::rgba_color::green };
@@ -69,7 +72,7 @@ void Render::DrawStartPosition(io2d::output_surface &surface) const{
     auto pb = io2d::path_builder{}; 
     pb.matrix(m_Matrix);
 
-    pb.new_figure({(float) m_Model.path.front().x, (float) m_Model.path.front().y});
+    pb.new_figure({(float) m_Path.start.x, (float) m_Path.start.y});
     float constexpr l_marker = 0.01f;
     pb.rel_line({l_marker, 0.f});
     pb.rel_line({0.f, l_marker});
@@ -105,6 +108,19 @@ void Render::DrawWater(io2d::output_surface &surface) const
         surface.fill(m_WaterFillBrush, PathFromMP(water));
 }
 
+void Render::DrawIsochrone(io2d::output_surface &surface) const
+{
+    if( m_Isochrone.empty() )
+        return;
+    auto pb = io2d::path_builder{};
+    pb.matrix(m_Matrix);
+    pb.new_figure( ToPoint2D(m_Isochrone.front()) );
+    for( auto it = ++m_Isochrone.begin(); it != std::end(m_Isochrone); ++it )
+        pb.line( ToPoint2D(*it) );
+    pb.close_figure();
+    surface.fill(m_IsochroneFillBrush, io2d::interpreted_path{pb});
+}
+
 void Render::DrawLanduses(io2d::output_surface &surface) const
 {
     for( auto &landuse: m_Model.Landuses() )
@@ -138,17 +154,15 @@ void Render::DrawRailways(io2d::output_surface &surface) const
 
 io2d::interpreted_path Render::PathLine() const
 {    
-    if( m_Model.path.empty() )
+    if( m_Path.Empty() )
         return {};
 
-    const auto nodes = m_Model.path;    
-    
     auto pb = io2d::path_builder{};
     pb.matrix(m_Matrix);
-    pb.new_figure( ToPoint2D( m_Model.path[0]));
+    pb.new_figure( ToPoint2D( m_Path.start ));
 
-    for( int i=1; i< m_Model.path.size();i++ )
-        pb.line( ToPoint2D(m_Model.path[i])); 
+    for( std::size_t i = 1; i < m_Path.Size(); i++ )
+        pb.line( ToPoint2D(m_Path.Point(i, m_Model)) ); 
 
       
     return io2d::interpreted_path{pb};
@@ -156,40 +170,41 @@ io2d::interpreted_path Render::PathLine() const
 
 io2d::interpreted_path Render::PathFromWay(const Model::Way &way) const
 {    
-    if( way.nodes.empty() )
+    const auto way_nodes = m_Model.WayNodes(way);
+    if( way_nodes.empty() )
         return {};
 
-    const auto nodes = m_Model.Nodes().data();    
+    const auto &nodes = m_Model.Nodes();    
     
     auto pb = io2d::path_builder{};
     pb.matrix(m_Matrix);
-    pb.new_figure( ToPoint2D(nodes[way.nodes.front()]) );
-    for( auto it = ++way.nodes.begin(); it != std::end(way.nodes); ++it )
+    pb.new_figure( ToPoint2D(nodes[way_nodes.front()]) );
+    for( auto it = way_nodes.begin() + 1; it != way_nodes.end(); ++it )
         pb.line( ToPoint2D(nodes[*it]) );     
     return io2d::interpreted_path{pb};
 }
 
 io2d::interpreted_path Render::PathFromMP(const Model::Multipolygon &mp) const
 {
-    const auto nodes = m_Model.Nodes().data();
-    const auto ways = m_Model.Ways().data();
+    const auto &nodes = m_Model.Nodes();
 
     auto pb = io2d::path_builder{};    
     pb.matrix(m_Matrix);    
     
-    auto commit = [&](const Model::Way &way) {
-        if( way.nodes.empty() )
+    auto commit = [&](int way_num) {
+        const auto way_nodes = m_Model.WayNodes(way_num);
+        if( way_nodes.empty() )
             return;
-        pb.new_figure( ToPoint2D(nodes[way.nodes.front()]) );
-        for( auto it = ++way.nodes.begin(); it != std::end(way.nodes); ++it )
+        pb.new_figure( ToPoint2D(nodes[way_nodes.front()]) );
+        for( auto it = way_nodes.begin() + 1; it != way_nodes.end(); ++it )
             pb.line( ToPoint2D(nodes[*it]) );        
         pb.close_figure();        
     };
     
-    for( auto way_num: mp.outer )
-        commit( ways[way_num] );
-    for( auto way_num: mp.inner )
-        commit( ways[way_num] );
+    for( auto way_num: m_Model.Outer(mp) )
+        commit( way_num );
+    for( auto way_num: m_Model.Inner(mp) )
+        commit( way_num );
     
     return io2d::interpreted_path{pb};
 }
@@ -257,5 +272,5 @@ static io2d::dashes RoadDashes(Model::Road::Type type)
 
 static io2d::point_2d ToPoint2D( const Model::Node &node ) noexcept
 {
-    return io2d::point_2d(static_cast<float>(node.x), static_cast<float>(node.y));
+    return io2d::point_2d(node.x, node.y);
 }
\ No newline at end of file
@@ -3,13 +3,15 @@
 #include <unordered_map>
 #include <io2d.h>
 #include "route_model.h"
+#include "route_path.h"
 
 using namespace std::experimental;
 
 class Render
 {
 public:
-    Render(RouteModel &model );
+    // `isochrone` is a boundary polygon (see Isochrone) shaded over the map.
+    Render(const RouteModel &model, RoutePath path, std::vector<Model::Node> isochrone = {});
     void Display( io2d::output_surface &surface );
     
 private:
@@ -21,6 +23,7 @@ private:
     void DrawRailways(io2d::output_surface &surface) const;
     void DrawLeisure(io2d::output_surface &surface) const;
     void DrawWater(io2d::output_surface &surface) const;
+    void DrawIsochrone(io2d::output_surface &surface) const;
     void DrawLanduses(io2d::output_surface &surface) const;
     void DrawStartPosition(io2d::output_surface &surface) const;
     void DrawEndPosition(io2d::output_surface &surface) const;
@@ -30,7 +33,9 @@ private:
     io2d::interpreted_path PathLine() const;
 
     
-    RouteModel &m_Model;
+    const RouteModel &m_Model;
+    RoutePath m_Path;
+    std::vector<Model::Node> m_Isochrone;
     float m_Scale = 1.f;
     float m_PixelsInMeter = 1.f;
     io2d::matrix_2d m_Matrix;
@@ -46,6 +51,8 @@ private:
     io2d::stroke_props m_LeisureOutlineStrokeProps{1.f};
 
     io2d::brush m_WaterFillBrush{ io2d::rgba_color{155, 201, 215} };    
+    
+    io2d::brush m_IsochroneFillBrush{ io2d::rgba_color{255, 140, 0, 70} };
         
     io2d::brush m_RailwayStrokeBrush{ io2d::rgba_color{93,93,93} };
     io2d::brush m_RailwayDashBrush{ io2d::rgba_color::white };
@@ -0,0 +1,114 @@
+#include "route_cache.h"
+#include <cstring>
+
+bool RouteCache::Key::operator==(const Key &other) const {
+    return start_from == other.start_from && start_to == other.start_to && start_t == other.start_t &&
+           end_from == other.end_from && end_to == other.end_to && end_t == other.end_t && profile == other.profile;
+}
+
+
+std::size_t RouteCache::KeyHash::operator()(const Key &key) const {
+    auto bits = [](float value) {
+        std::uint32_t result;
+        std::memcpy(&result, &value, sizeof(result));
+        return result;
+    };
+    std::uint64_t hash = 1469598103934665603ull;
+    for (std::uint64_t part : {(std::uint64_t)(std::uint32_t)key.start_from, (std::uint64_t)(std::uint32_t)key.start_to,
+                               (std::uint64_t)bits(key.start_t), (std::uint64_t)(std::uint32_t)key.end_from,
+                               (std::uint64_t)(std::uint32_t)key.end_to, (std::uint64_t)bits(key.end_t),
+                               (std::uint64_t)(std::uint32_t)key.profile})
+        hash = (hash ^ part) * 1099511628211ull;
+    return (std::size_t)(hash ^ (hash >> 32));
+}
+
+
+RouteCache::RouteCache(std::size_t capacity) : capacity(capacity) {}
+
+
+RouteCache::Key RouteCache::MakeKey(const RouteModel::EdgePoint &start, const RouteModel::EdgePoint &end, int profile) {
+    return {start.from, start.to, start.t, end.from, end.to, end.t, profile};
+}
+
+
+void RouteCache::Sync(std::uint64_t graph_version) {
+    if (graph_version == version)
+        return;
+    if (!entries.empty())
+        stats.invalidations++;
+    entries.clear();
+    index.clear();
+    version = graph_version;
+}
+
+
+std::shared_ptr<const RouteCache::Route> RouteCache::Find(const Key &key, std::uint64_t graph_version) {
+    std::lock_guard<std::mutex> lock{mutex};
+    Sync(graph_version);
+    auto it = index.find(key);
+    if (it == index.end()) {
+        stats.misses++;
+        return nullptr;
+    }
+    stats.hits++;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+}
+
+
+void RouteCache::Insert(const Key &key, std::shared_ptr<const Route> route, std::uint64_t graph_version) {
+    std::lock_guard<std::mutex> lock{mutex};
+    // A route computed before the graphs changed is not worth keeping.
+    if (graph_version < version || capacity == 0)
+        return;
+    Sync(graph_version);
+    if (auto it = index.find(key); it != index.end()) {
+        it->second->second = std::move(route);
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+    if (entries.size() == capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+        stats.evictions++;
+    }
+    entries.emplace_front(key, std::move(route));
+    index.emplace(key, entries.begin());
+}
+
+
+std::shared_ptr<const RouteCache::Route> RouteCache::FindOrRoute(const RouteModel &model, SearchWorkspace &workspace, float start_x,
+                                                                 float start_y, float end_x, float end_y, RoutePlanner::Snap snap,
+                                                                 int profile) {
+    const RouteModel::EdgePoint start = RoutePlanner::SnapPoint(model, start_x, start_y, snap, profile);
+    const RouteModel::EdgePoint end = RoutePlanner::SnapPoint(model, end_x, end_y, snap, profile);
+    const Key key = MakeKey(start, end, profile);
+    const std::uint64_t graph_version = model.GraphVersion();
+    if (std::shared_ptr<const Route> cached = Find(key, graph_version))
+        return cached;
+
+    RoutePlanner planner{model, workspace, start, end, snap, profile};
+    planner.AStarSearch();
+    auto route = std::make_shared<Route>();
+    for (int node : planner.GetPath().nodes)
+        if (node != RoutePath::kSnappedPoint)
+            route->nodes.push_back(node);
+    route->distance = planner.GetPath().Empty() ? SearchWorkspace::kInfinity : planner.GetDistance();
+    Insert(key, route, graph_version);
+    return route;
+}
+
+
+RouteCache::Stats RouteCache::GetStats() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    Stats result = stats;
+    result.size = entries.size();
+    return result;
+}
+
+
+void RouteCache::Clear() {
+    std::lock_guard<std::mutex> lock{mutex};
+    entries.clear();
+    index.clear();
+}
@@ -0,0 +1,86 @@
+#ifndef ROUTE_CACHE_H
+#define ROUTE_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "route_model.h"
+#include "route_planner.h"
+#include "search_workspace.h"
+
+// Bounded least-recently-used cache of routes in front of RoutePlanner, safe
+// to share between threads. Routes are keyed by their snapped endpoints and
+// profile, so every query that snaps to the same place shares an entry; with
+// Snap::ToNode the key is just the start and end node pair.
+//
+// Every entry belongs to the RouteModel::GraphVersion it was computed on.
+// The first lookup after the graphs change drops all entries.
+class RouteCache {
+  public:
+    struct Key {
+        int start_from, start_to;
+        float start_t;
+        int end_from, end_to;
+        float end_t;
+        int profile;
+
+        bool operator==(const Key &other) const;
+    };
+    // Indices of the model nodes along the route, without the virtual nodes
+    // of Snap::ToEdge, and its length in metres; no nodes and an infinite
+    // distance when the end cannot be reached.
+    struct Route {
+        std::vector<int> nodes;
+        float distance = 0.0f;
+    };
+    struct Stats {
+        long hits = 0;
+        long misses = 0;
+        long evictions = 0;
+        // Times the entries were dropped for a change of the graphs.
+        long invalidations = 0;
+        std::size_t size = 0;
+
+        double HitRate() const { return hits + misses == 0 ? 0.0 : (double)hits / (hits + misses); }
+    };
+
+    explicit RouteCache(std::size_t capacity);
+
+    static Key MakeKey(const RouteModel::EdgePoint &start, const RouteModel::EdgePoint &end, int profile);
+
+    // The cached route, or null. Entries are shared, so a route stays valid
+    // for its holder after being evicted.
+    std::shared_ptr<const Route> Find(const Key &key, std::uint64_t graph_version);
+    void Insert(const Key &key, std::shared_ptr<const Route> route, std::uint64_t graph_version);
+
+    // Snaps the query and answers it from the cache, running AStarSearch in
+    // the given workspace on a miss.
+    std::shared_ptr<const Route> FindOrRoute(const RouteModel &model, SearchWorkspace &workspace, float start_x, float start_y,
+                                             float end_x, float end_y, RoutePlanner::Snap snap = RoutePlanner::Snap::ToNode,
+                                             int profile = RouteModel::kDefaultProfile);
+
+    Stats GetStats() const;
+    void Clear();
+
+  private:
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const;
+    };
+    using Entry = std::pair<Key, std::shared_ptr<const Route>>;
+
+    // Drops everything computed on another graph version; needs the lock.
+    void Sync(std::uint64_t graph_version);
+
+    const std::size_t capacity;
+    mutable std::mutex mutex;
+    // Most recently used first.
+    std::list<Entry> entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    std::uint64_t version = 0;
+    Stats stats;
+};
+
+#endif
@@ -1,77 +1,200 @@
 #include "route_model.h"
 #include <iostream>
+#include <stdexcept>
 
-RouteModel::RouteModel(const std::vector<std::byte> &xml) : Model(xml) {
-    // Create RouteModel nodes.
-    int counter = 0;
-    for (Model::Node node : this->Nodes()) {
-        m_Nodes.emplace_back(Node(counter, this, node));
-        counter++;
+RouteModel::RouteModel(const std::vector<std::byte> &xml, int thread_count, NodeOrder order)
+    : Model(xml, thread_count, order) {
+    for (const RoutingProfile &profile : RoutingProfile::Defaults())
+        m_Profiles.push_back({profile, {}, {}, {}, {}});
+    BuildProfiles();
+}
+
+
+RouteModel::RouteModel(const GraphCache &cache) : Model(cache) {
+    const int node_count = (int)Nodes().size();
+    std::vector<RoutingProfile> profiles = RoutingProfile::Defaults();
+    for (int profile = 0; profile < (int)profiles.size(); profile++) {
+        Graph graph(cache.View<int>(GraphCache::ProfileSection(profile, GraphCache::GraphOffsets)),
+                    cache.View<Graph::Edge>(GraphCache::ProfileSection(profile, GraphCache::GraphEdges)));
+        const int edge_count = graph.EdgeCount();
+        m_Profiles.push_back({std::move(profiles[profile]), std::move(graph), KdTree(cache, profile, node_count),
+                              SegmentIndex(cache, profile, node_count), TurnTable(cache, profile, edge_count)});
     }
-    CreateNodeToRoadHashmap();
+    CheckIndices();
 }
 
 
-void RouteModel::CreateNodeToRoadHashmap() {
-    for (const Model::Road &road : Roads()) {
-        if (road.type != Model::Road::Type::Footway) {
-            for (int node_idx : Ways()[road.way].nodes) {
-                if (node_to_road.find(node_idx) == node_to_road.end()) {
-                    node_to_road[node_idx] = std::vector<const Model::Road *> ();
-                }
-                node_to_road[node_idx].push_back(&road);
-            }
-        }
+void RouteModel::BuildProfiles() {
+    for (ProfileIndex &index : m_Profiles) {
+        BuildRoadGraph(index);
+        BuildNodeIndex(index);
+        BuildSegmentIndex(index);
+        BuildTurnTable(index);
     }
 }
 
 
-RouteModel::Node *RouteModel::Node::FindNeighbor(std::vector<int> node_indices) {
-    Node *closest_node = nullptr;
-    Node node;
+int RouteModel::FindProfile(const std::string &name) const {
+    for (int i = 0; i < ProfileCount(); i++)
+        if (m_Profiles[i].profile.name == name)
+            return i;
+    return -1;
+}
 
-    for (int node_index : node_indices) {
-        node = parent_model->SNodes()[node_index];
-        if (this->distance(node) != 0 && !node.visited) {
-            if (closest_node == nullptr || this->distance(node) < this->distance(*closest_node)) {
-                closest_node = &parent_model->SNodes()[node_index];
-            }
-        }
-    }
-    return closest_node;
+
+void RouteModel::SetProfile(int profile, RoutingProfile routing) {
+    ProfileIndex &index = m_Profiles[profile];
+    index.profile = std::move(routing);
+    BuildRoadGraph(index);
+    BuildNodeIndex(index);
+    BuildSegmentIndex(index);
+    BuildTurnTable(index);
+    m_GraphVersion++;
 }
 
 
-void RouteModel::Node::FindNeighbors() {
-    for (auto & road : parent_model->node_to_road[this->index]) {
-        RouteModel::Node *new_neighbor = this->FindNeighbor(parent_model->Ways()[road->way].nodes);
-        if (new_neighbor) {
-            this->neighbors.emplace_back(new_neighbor);
-        }
+// A cache is tied to its source by checksum only, so make sure a damaged file
+// cannot send the indexes built on top of it out of bounds.
+void RouteModel::CheckIndices() const {
+    const int node_count = (int)Nodes().size();
+    const int way_count = (int)Ways().size();
+    for (int node_idx : WayNodeArray())
+        if (node_idx < 0 || node_idx >= node_count)
+            throw std::logic_error("graph cache refers to a missing node");
+    for (const Model::Road &road : Roads())
+        if (road.way < 0 || road.way >= way_count)
+            throw std::logic_error("graph cache refers to a missing way");
+    for (const Model::Railway &railway : Railways())
+        if (railway.way < 0 || railway.way >= way_count)
+            throw std::logic_error("graph cache refers to a missing way");
+    for (int way : RingWayArray())
+        if (way < 0 || way >= way_count)
+            throw std::logic_error("graph cache refers to a missing way");
+    for (const Model::TurnRestriction &restriction : TurnRestrictions())
+        if (restriction.from_way < 0 || restriction.from_way >= way_count || restriction.to_way < 0 ||
+            restriction.to_way >= way_count || restriction.via_node < 0 || restriction.via_node >= node_count)
+            throw std::logic_error("graph cache holds a malformed turn restriction");
+
+    for (const ProfileIndex &index : m_Profiles) {
+        const FlatArray<int> &offsets = index.graph.Offsets();
+        if (offsets.size() != Nodes().size() + 1 || offsets.front() != 0 || offsets.back() != index.graph.EdgeCount())
+            throw std::logic_error("graph cache holds a malformed road graph");
+        for (std::size_t i = 1; i < offsets.size(); i++)
+            if (offsets[i] < offsets[i - 1])
+                throw std::logic_error("graph cache holds a malformed road graph");
+        for (const Graph::Edge &edge : index.graph.EdgeArray())
+            if (edge.to < 0 || edge.to >= node_count)
+                throw std::logic_error("graph cache refers to a missing node");
     }
 }
 
 
-RouteModel::Node &RouteModel::FindClosestNode(float x, float y) {
-    Node input;
-    input.x = x;
-    input.y = y;
+// Links every pair of consecutive nodes on a road the profile may use in both
+// directions, weighted once here so that searches never look at road types.
+void RouteModel::BuildRoadGraph(ProfileIndex &index) {
+    std::vector<Graph::Arc> arcs;
+    for (const Model::Road &road : Roads()) {
+        if (index.profile.Allows(road.type)) {
+            Model::IndexRange way_nodes = WayNodes(road.way);
+            for (std::size_t i = 1; i < way_nodes.size(); i++) {
+                int from = way_nodes[i - 1], to = way_nodes[i];
+                float weight = index.profile.Weight(SNodes()[from].distance(SNodes()[to]), road.type);
+                arcs.push_back({from, to, weight});
+                arcs.push_back({to, from, weight});
+            }
+        }
+    }
+    index.graph = Graph((int)Nodes().size(), arcs);
+}
 
-    float min_dist = std::numeric_limits<float>::max();
-    float dist;
-    int closest_idx;
 
+// Indexes every node that lies on a road of the profile, each node once.
+void RouteModel::BuildNodeIndex(ProfileIndex &index) {
+    std::vector<bool> routable(Nodes().size(), false);
+    std::vector<KdTree::Point> points;
     for (const Model::Road &road : Roads()) {
-        if (road.type != Model::Road::Type::Footway) {
-            for (int node_idx : Ways()[road.way].nodes) {
-                dist = input.distance(SNodes()[node_idx]);
-                if (dist < min_dist) {
-                    closest_idx = node_idx;
-                    min_dist = dist;
+        if (index.profile.Allows(road.type)) {
+            for (int node_idx : WayNodes(road.way)) {
+                if (!routable[node_idx]) {
+                    routable[node_idx] = true;
+                    points.push_back({Nodes().Xs()[node_idx], Nodes().Ys()[node_idx], node_idx});
                 }
             }
         }
     }
+    index.nodes = KdTree(std::move(points));
+}
+
 
+// Indexes every road segment once, taken from the road graph with from < to.
+void RouteModel::BuildSegmentIndex(ProfileIndex &index) {
+    std::vector<SegmentIndex::Segment> segments;
+    for (int from = 0; from < index.graph.NodeCount(); from++) {
+        for (const Graph::Edge &edge : index.graph.Edges(from)) {
+            if (from < edge.to) {
+                const Model::Node a = Nodes()[from], b = Nodes()[edge.to];
+                segments.push_back({a.x, a.y, b.x, b.y, from, edge.to});
+            }
+        }
+    }
+    index.segments = SegmentIndex(std::move(segments));
+}
+
+
+void RouteModel::BuildTurnTable(ProfileIndex &index) {
+    index.turns = index.profile.obeys_turn_restrictions ? TurnTable(*this, index.graph) : TurnTable();
+}
+
+
+RouteModel::Node RouteModel::FindClosestNode(float x, float y, int profile) const {
+    int closest_idx = m_Profiles[profile].nodes.Nearest(x, y);
+    if (closest_idx < 0)
+        throw std::logic_error("the map has no roads for the " + Profile(profile).name + " profile");
     return SNodes()[closest_idx];
-}
\ No newline at end of file
+}
+
+
+std::vector<int> RouteModel::FindClosestNodes(float x, float y, int k, int profile) const {
+    return m_Profiles[profile].nodes.KNearest(x, y, k);
+}
+
+
+std::vector<int> RouteModel::FindNodesWithin(float x, float y, float radius, int profile) const {
+    return m_Profiles[profile].nodes.WithinRadius(x, y, radius);
+}
+
+
+RouteModel::EdgePoint RouteModel::FindClosestEdgePoint(float x, float y, int profile) const {
+    const SegmentIndex &segments = m_Profiles[profile].segments;
+    SegmentIndex::Projection projection = segments.Nearest(x, y);
+    if (projection.segment < 0)
+        throw std::logic_error("the map has no roads for the " + Profile(profile).name + " profile");
+
+    const SegmentIndex::Segment &segment = segments[projection.segment];
+    EdgePoint point;
+    point.from = segment.from;
+    point.to = segment.to;
+    point.t = (float)projection.t;
+    point.x = (float)projection.x;
+    point.y = (float)projection.y;
+    return point;
+}
+
+
+// Time weights are the distance covered at the profile's top speed (km/h) in
+// the same time.
+float RouteModel::WeightScale(int profile) const {
+    const RoutingProfile &routing = Profile(profile);
+    float scale = MetricScale();
+    if (routing.metric == RoutingProfile::Metric::Time)
+        scale /= routing.TopSpeed() / 3.6f;
+    return scale;
+}
+
+
+float RouteModel::SegmentWeight(int from, int to, int profile) const {
+    for (const Graph::Edge &edge : Neighbors(from, profile))
+        if (edge.to == to)
+            return edge.weight;
+    return SNodes()[from].distance(SNodes()[to]);
+}
@@ -1,46 +1,123 @@
 #ifndef ROUTE_MODEL_H
 #define ROUTE_MODEL_H
 
+#include <cstdint>
 #include <limits>
 #include <cmath>
-#include <unordered_map>
 #include "model.h"
+#include "graph.h"
+#include "kd_tree.h"
+#include "segment_index.h"
+#include "graph_cache.h"
+#include "routing_profile.h"
+#include "turn_table.h"
 #include <iostream>
 
+// Read-only routing graph. Search state (parents, g and h values, the closed
+// set) lives in a SearchWorkspace, so one loaded map can answer any number of
+// queries, also from several threads at the same time.
+//
+// Every RoutingProfile gets its own road graph and spatial indexes, built at
+// load; the queries below take the index of the profile to use.
 class RouteModel : public Model {
 
   public:
     class Node : public Model::Node {
       public:
-        Node * parent = nullptr;
-        float h_value = std::numeric_limits<float>::max();
-        float g_value = 0.0;
-        bool visited = false;
-        std::vector<Node *> neighbors;
-
-        void FindNeighbors();
-        float distance(Node other) const {
-            return std::sqrt(std::pow((x - other.x), 2) + std::pow((y - other.y), 2));
+        int Index() const { return index; }
+        // Rounds like the kernels of distance_kernels.h.
+        float distance(const Model::Node &other) const {
+            float dx = x - other.x, dy = y - other.y;
+            return std::sqrt(dx * dx + dy * dy);
         }
 
         Node(){}
-        Node(int idx, RouteModel * search_model, Model::Node node) : Model::Node(node), parent_model(search_model), index(idx) {}
+        Node(int idx, Model::Node node) : Model::Node(node), index(idx) {}
 
       private:
-        int index;
-        Node * FindNeighbor(std::vector<int> node_indices);
-        RouteModel * parent_model = nullptr;
+        int index = -1;
     };
 
-    RouteModel(const std::vector<std::byte> &xml);
-    Node &FindClosestNode(float x, float y);
-    auto &SNodes() { return m_Nodes; }
-    std::vector<Node> path;
+    // The model's nodes as Node values, put together on access from the
+    // coordinates of Model::Nodes(); RouteModel keeps no copy of its own.
+    class NodeView {
+      public:
+        explicit NodeView(const NodeStore &store) : store(&store) {}
+        std::size_t size() const { return store->size(); }
+        Node operator[](std::size_t i) const { return Node((int)i, (*store)[i]); }
+
+      private:
+        const NodeStore *store;
+    };
+
+    // A point on a road segment: the segment runs from node `from` to node `to`
+    // and the point sits at fraction `t` of its length away from `from`.
+    struct EdgePoint {
+        int from = -1;
+        int to = -1;
+        float t = 0.0f;
+        float x = 0.0f;
+        float y = 0.0f;
+    };
+
+    // The car profile, the one a RouteModel routes on unless told otherwise.
+    static constexpr int kDefaultProfile = 0;
+
+    // Builds the graphs of RoutingProfile::Defaults() over the nodes numbered
+    // in the given order.
+    RouteModel(const std::vector<std::byte> &xml, int thread_count = 0, NodeOrder order = NodeOrder::File);
+    // Restores a model saved with GraphCache::Save without touching the XML.
+    explicit RouteModel(const GraphCache &cache);
+
+    int ProfileCount() const { return (int)m_Profiles.size(); }
+    const RoutingProfile &Profile(int profile) const { return m_Profiles[profile].profile; }
+    // Index of the profile with the given name, -1 if there is none.
+    int FindProfile(const std::string &name) const;
+    // Replaces a profile and rebuilds its graph and indexes, say with new
+    // speeds. Must not run while queries use the model.
+    void SetProfile(int profile, RoutingProfile routing);
+    // Bumped whenever a graph or its weights change, so that results kept
+    // from earlier queries (see RouteCache) can tell they are stale.
+    std::uint64_t GraphVersion() const { return m_GraphVersion; }
+
+    // Spatial queries over the nodes of the roads a profile may use.
+    Node FindClosestNode(float x, float y, int profile = kDefaultProfile) const;
+    std::vector<int> FindClosestNodes(float x, float y, int k, int profile = kDefaultProfile) const;
+    std::vector<int> FindNodesWithin(float x, float y, float radius, int profile = kDefaultProfile) const;
+    // Projection of (x, y) onto the closest road segment a profile may use.
+    EdgePoint FindClosestEdgePoint(float x, float y, int profile = kDefaultProfile) const;
+    NodeView SNodes() const { return NodeView(Nodes()); }
+    // Road segments leaving a node, weighted as the profile values them.
+    Graph::EdgeRange Neighbors(int node, int profile = kDefaultProfile) const { return m_Profiles[profile].graph.Edges(node); }
+    const Graph &RoadGraph(int profile = kDefaultProfile) const { return m_Profiles[profile].graph; }
+    // Turns between edges of RoadGraph(profile) that the map forbids; empty
+    // for profiles that do not obey turn restrictions.
+    const TurnTable &Turns(int profile = kDefaultProfile) const { return m_Profiles[profile].turns; }
+    // Metres, or seconds for profiles that minimise time, per unit of edge weight.
+    float WeightScale(int profile = kDefaultProfile) const;
+    // Weight of the road segment between two neighbouring nodes in the profile.
+    float SegmentWeight(int from, int to, int profile = kDefaultProfile) const;
     
   private:
-    void CreateNodeToRoadHashmap();
-    std::unordered_map<int, std::vector<const Model::Road *>> node_to_road;
-    std::vector<Node> m_Nodes;
+    friend class GraphCache;
+
+    struct ProfileIndex {
+        RoutingProfile profile;
+        Graph graph;
+        KdTree nodes;
+        SegmentIndex segments;
+        TurnTable turns;
+    };
+
+    // Builds the graph and indexes of every profile.
+    void BuildProfiles();
+    void BuildRoadGraph(ProfileIndex &index);
+    void BuildNodeIndex(ProfileIndex &index);
+    void BuildSegmentIndex(ProfileIndex &index);
+    void BuildTurnTable(ProfileIndex &index);
+    void CheckIndices() const;
+    std::vector<ProfileIndex> m_Profiles;
+    std::uint64_t m_GraphVersion = 0;
 
 };
 
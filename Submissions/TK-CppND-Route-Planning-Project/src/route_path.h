@@ -0,0 +1,42 @@
+#ifndef ROUTE_PATH_H
+#define ROUTE_PATH_H
+
+#include <cstddef>
+#include <vector>
+#include "model.h"
+
+// A route as the indices of the model nodes it passes, with the distance
+// covered up to each of them. The planners fill one in place from the back,
+// following parent labels from the end, so handing over a long route costs
+// two flat arrays instead of a copy of every node.
+struct RoutePath {
+    // Marks a vertex that is a point snapped onto a road (Snap::ToEdge)
+    // rather than a model node; only the first and last vertex can be one.
+    static constexpr int kSnappedPoint = -1;
+
+    std::vector<int> nodes;
+    // Metres from the start to each vertex, 0 for the first.
+    std::vector<float> distances;
+    // Coordinates of the first and last vertex, which need not be nodes.
+    Model::Node start;
+    Model::Node end;
+
+    bool Empty() const { return nodes.empty(); }
+    std::size_t Size() const { return nodes.size(); }
+    // Metres from the start to the end.
+    float Length() const { return distances.empty() ? 0.0f : distances.back(); }
+
+    // Map coordinates of the i-th vertex.
+    Model::Node Point(std::size_t i, const Model &model) const {
+        if (nodes[i] != kSnappedPoint)
+            return model.Nodes()[nodes[i]];
+        return i == 0 ? start : end;
+    }
+
+    void Clear() {
+        nodes.clear();
+        distances.clear();
+    }
+};
+
+#endif
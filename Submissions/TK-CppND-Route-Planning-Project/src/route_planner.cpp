@@ -1,17 +1,81 @@
 #include "route_planner.h"
 #include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include "distance_kernels.h"
 
-RoutePlanner::RoutePlanner(RouteModel &model, float start_x, float start_y, float end_x, float end_y): m_Model(model) {
+RoutePlanner::RoutePlanner(const RouteModel &model, float start_x, float start_y, float end_x, float end_y, Snap snap, int profile)
+    : RoutePlanner(model, owned_workspace, start_x, start_y, end_x, end_y, snap, profile) {}
+
+RoutePlanner::RoutePlanner(const RouteModel &model, SearchWorkspace &workspace, float start_x, float start_y, float end_x, float end_y, Snap snap, int profile)
+    : RoutePlanner(model, workspace, SnapPoint(model, start_x, start_y, snap, profile), SnapPoint(model, end_x, end_y, snap, profile), snap, profile) {}
+
+RoutePlanner::RoutePlanner(const RouteModel &model, SearchWorkspace &workspace, const RouteModel::EdgePoint &start, const RouteModel::EdgePoint &end,
+                           Snap snap, int profile)
+    : m_Model(model), profile(profile), graph(model.RoadGraph(profile)), workspace(workspace) {
+    if (snap == Snap::ToEdge) {
+        SnapToEdges(start, end);
+    }
+    else {
+        this->start_node = m_Model.SNodes()[start.from];
+        this->end_node = m_Model.SNodes()[end.from];
+    }
+    ResetSearch();
+}
+
+
+RouteModel::EdgePoint RoutePlanner::SnapPoint(const RouteModel &model, float x, float y, Snap snap, int profile) {
     // Convert inputs to percentage:
-    start_x *= 0.01;
-    start_y *= 0.01;
-    end_x *= 0.01;
-    end_y *= 0.01;
+    x *= 0.01;
+    y *= 0.01;
 
     // TODO 2: Use the m_Model.FindClosestNode method to find the closest nodes to the starting and ending coordinates.
-    // Store the nodes you find in the RoutePlanner's start_node and end_node attributes.
-  	this->start_node = &m_Model.FindClosestNode(start_x, start_y);
-	this->end_node = &m_Model.FindClosestNode(end_x, end_y);
+    // The node, or with Snap::ToEdge the closest point on a road segment, is returned as an EdgePoint; the
+    // constructor turns the start and end points into start_node and end_node.
+    if (snap == Snap::ToEdge)
+        return model.FindClosestEdgePoint(x, y, profile);
+    const RouteModel::Node node = model.FindClosestNode(x, y, profile);
+    return {node.Index(), node.Index(), 0.0f, node.x, node.y};
+}
+
+
+// Places virtual start and end nodes on the snapped road segments and links
+// each one to both ends of its segment. A start and end on the same segment
+// are also linked directly.
+void RoutePlanner::SnapToEdges(const RouteModel::EdgePoint &start, const RouteModel::EdgePoint &end) {
+    const int node_count = (int)m_Model.SNodes().size();
+    virtual_start = RouteModel::Node(node_count, Model::Node{start.x, start.y});
+    virtual_end = RouteModel::Node(node_count + 1, Model::Node{end.x, end.y});
+    start_node = virtual_start;
+    end_node = virtual_end;
+
+    float start_length = m_Model.SegmentWeight(start.from, start.to, profile);
+    float end_length = m_Model.SegmentWeight(end.from, end.to, profile);
+    virtual_arcs = {
+        {virtual_start.Index(), start.from, start.t * start_length},
+        {virtual_start.Index(), start.to, (1.0f - start.t) * start_length},
+        {end.from, virtual_end.Index(), end.t * end_length},
+        {end.to, virtual_end.Index(), (1.0f - end.t) * end_length},
+    };
+    if (start.from == end.from && start.to == end.to)
+        virtual_arcs.push_back({virtual_start.Index(), virtual_end.Index(), std::abs(start.t - end.t) * start_length});
+}
+
+
+// Starts a fresh query in the workspace with only the start node labelled.
+void RoutePlanner::ResetSearch() {
+    workspace.Reset((int)m_Model.SNodes().size() + 2);
+    workspace.Reach(start_node.Index(), 0.0f, CalculateHValue(&start_node), -1);
+}
+
+
+// Looks up a node by index, including the two virtual nodes of Snap::ToEdge.
+RouteModel::Node RoutePlanner::NodeAt(int index) const {
+    const int node_count = (int)m_Model.SNodes().size();
+    if (index < node_count)
+        return m_Model.SNodes()[index];
+    return index == node_count ? virtual_start : virtual_end;
 }
 
 
@@ -20,99 +84,634 @@ RoutePlanner::RoutePlanner(RouteModel &model, float start_x, float start_y, floa
 // - You can use the distance to the end_node for the h value.
 // - Node objects have a distance method to determine the distance to another node.
 
-float RoutePlanner::CalculateHValue(RouteModel::Node const *node) {
-  return node->distance(*end_node);
+float RoutePlanner::CalculateHValue(RouteModel::Node const *node) const {
+  return HValue(node->Index(), node->distance(end_node));
+}
+
+
+// The h value of a node whose straight-line distance to the end is known.
+float RoutePlanner::HValue(int node, float distance) const {
+  if (landmarks != nullptr && node < (int)m_Model.SNodes().size())
+    return std::max(distance, LandmarkBound(node));
+  return distance;
+}
+
+
+void RoutePlanner::UseLandmarks(const Landmarks &landmarks) {
+  if (landmarks.NodeCount() != (int)m_Model.SNodes().size())
+    throw std::logic_error("landmarks were computed for a different map");
+  if (landmarks.Profile() != profile || landmarks.GraphVersion() != m_Model.GraphVersion())
+    throw std::logic_error("landmarks were computed for a different profile or graph version");
+  this->landmarks = &landmarks;
+  // AStarSearch stops at any node on the end's position, so all of them are
+  // targets; with Snap::ToEdge the search leaves the graph at either end of
+  // the end segment.
+  landmark_targets.clear();
+  if (virtual_arcs.empty()) {
+    // The spatial index takes float coordinates, so search a little around.
+    for (int node : m_Model.FindNodesWithin(end_node.x, end_node.y, 1e-6f, profile))
+      if (m_Model.SNodes()[node].distance(end_node) == 0)
+        landmark_targets.emplace_back(node, 0.0f);
+  }
+  for (const Graph::Arc &arc : virtual_arcs)
+    if (arc.to == virtual_end.Index() && arc.from != virtual_start.Index())
+      landmark_targets.emplace_back(arc.from, arc.weight);
+  ResetSearch();
+}
+
 
+// Lower bound on the distance from a node to the closest target. Every term is
+// a consistent potential, and so is their minimum, which keeps A* exact.
+float RoutePlanner::LandmarkBound(int node) const {
+  float bound = SearchWorkspace::kInfinity;
+  for (const auto &[target, remaining] : landmark_targets)
+    bound = std::min(bound, landmarks->LowerBound(node, target) + remaining);
+  return bound;
 }
 
 
 // TODO 4: Complete the AddNeighbors method to expand the current node by adding all unvisited neighbors to the open list.
 // Tips:
-// - Use the FindNeighbors() method of the current_node to populate current_node.neighbors vector with all the neighbors.
-// - For each node in current_node.neighbors, set the parent, the h_value, the g_value. 
+// - Use the profile's road graph to walk the road segments leaving current_node; each edge carries its weight.
+// - For each neighbor, record the parent, the h_value and the g_value in the workspace.
 // - Use CalculateHValue below to implement the h-Value calculation.
-// - For each node in current_node.neighbors, add the neighbor to open_list and set the node's visited attribute to true.
+// - For each neighbor, add the neighbor to the open list.
+//
+// A neighbor is closed only once it is expanded (see NextNode). A neighbor that is
+// already on the open list is relaxed instead: if the path through current_node is
+// shorter, its parent and g value are updated and its key lowered.
+//
+// The straight-line distances of the neighbors to the end are computed
+// together by GatherDistances, in batches of up to kBatch. Most road nodes
+// have fewer than kMinBatch neighbors, too few to fill a vector, and those
+// are measured one by one, which is faster for them.
 
-void RoutePlanner::AddNeighbors(RouteModel::Node *current_node) {
-  current_node->FindNeighbors();
-  for (RouteModel::Node* neighbour_node : current_node->neighbors) {
-    neighbour_node->parent = current_node;
-    neighbour_node->h_value = CalculateHValue(neighbour_node);
-    neighbour_node->g_value = current_node->g_value + current_node->distance(*neighbour_node);
-    open_list.emplace_back(neighbour_node);
-    neighbour_node->visited = true;
-  	}
+void RoutePlanner::AddNeighbors(const RouteModel::Node *current_node) {
+  constexpr int kMinBatch = 4, kBatch = 16;
+  int current = current_node->Index();
+  float current_g_value = workspace.GValue(current);
+  auto edges = current < (int)m_Model.SNodes().size() ? graph.Edges(current) : Graph::EdgeRange(nullptr, nullptr);
+  if (edges.size() < kMinBatch) {
+    for (const Graph::Edge &edge : edges)
+      ScanEdge(current, current_g_value, edge.to, edge.weight, m_Model.SNodes()[edge.to].distance(end_node));
+  }
+  else {
+    int targets[kBatch];
+    float distances[kBatch];
+    const float *xs = m_Model.Nodes().Xs(), *ys = m_Model.Nodes().Ys();
+    for (auto batch = edges.begin(); batch != edges.end();) {
+      int count = 0;
+      for (auto edge = batch; edge != edges.end() && count < kBatch; ++edge)
+        targets[count++] = edge->to;
+      GatherDistances(xs, ys, targets, count, end_node.x, end_node.y, distances);
+      for (int i = 0; i < count; i++, ++batch)
+        ScanEdge(current, current_g_value, batch->to, batch->weight, distances[i]);
+    }
+  }
+  for (const Graph::Arc &arc : virtual_arcs)
+    if (arc.from == current)
+      ScanEdge(current, current_g_value, arc.to, arc.weight, NodeAt(arc.to).distance(end_node));
 }
 
-// Helper function for sorting nodes in the open list based on the sum of their
-// h and g values.
-bool Compare(RouteModel::Node* node1, RouteModel::Node* node2) {
-  auto sum_node1 = node1->g_value + node1->h_value;
-  auto sum_node2 = node2->g_value + node2->h_value;
-  return sum_node1 > sum_node2;
+// `distance` is the straight-line distance from `to` to the end.
+void RoutePlanner::ScanEdge(int current, float current_g_value, int to, float weight, float distance) {
+  if (workspace.Closed(to))
+    return;
+  float g_value = current_g_value + weight;
+  if (!workspace.Reached(to)) {
+    float h_value = HValue(to, distance);
+    workspace.Reach(to, g_value, h_value, current);
+    workspace.OpenList().Push(to, g_value + h_value);
+  }
+  else if (g_value < workspace.GValue(to)) {
+    workspace.Relax(to, g_value, current);
+    workspace.OpenList().DecreaseKey(to, g_value + workspace.HValue(to));
+  }
 }
 
-// TODO 5: Complete the NextNode method to sort the open list and return the next node.
+// TODO 5: Complete the NextNode method to take the next node off the open list.
 // Tips:
-// - Sort the open_list according to the sum of the h value and g value.
-// - Create a pointer to the node in the list with the lowest sum.
-// - Remove that node from the open_list.
-// - Return the pointer.
+// - The open list is a heap keyed on the sum of the g value and h value, so
+//   popping it yields the node with the lowest sum.
+// - Close that node in the workspace so that it is not expanded again.
+// - Return the node by value.
 
-RouteModel::Node *RoutePlanner::NextNode() {
-  std::sort(this->open_list.begin(), open_list.end(), Compare);
-  RouteModel::Node* next_node = this->open_list.back();
-  this->open_list.pop_back();
-  return next_node;
+RouteModel::Node RoutePlanner::NextNode() {
+  int next = workspace.OpenList().Pop();
+  workspace.Close(next);
+  return NodeAt(next);
 }
 
 
 // TODO 6: Complete the ConstructFinalPath method to return the final path found from your A* search.
 // Tips:
-// - This method should take the current (final) node as an argument and iteratively follow the 
+// - This method should take the current (final) node as an argument and iteratively follow the
 //   chain of parents of nodes until the starting node is found.
-// - For each node in the chain, add the distance from the node to its parent to the distance variable.
-// - The returned vector should be in the correct order: the start node should be the first element
-//   of the vector, the end node should be the last element.
+// - The path keeps the node indices with the distance covered up to each, and the total in the
+//   distance variable.
+// - The nodes should be in the correct order: the start node first, the end node last.
 
-std::vector<RouteModel::Node> RoutePlanner::ConstructFinalPath(RouteModel::Node *current_node) {
-    // Create path_found vector
-    distance = 0.0f;
-    std::vector<RouteModel::Node> path_found;
+const RoutePath &RoutePlanner::ConstructFinalPath(const RouteModel::Node *current_node) {
+    FillPath(current_node->Index(), nullptr);
+    return path;
+}
 
-    // TODO: Implement your solution here.
-	while (current_node->parent != nullptr) {
-      path_found.emplace_back(*current_node);
-      distance += current_node->distance(*current_node->parent);
-      current_node = current_node->parent;
+
+// Fills the path from the start to `meeting` by following the parents in the
+// workspace, and on from `meeting` to the end by following those of the
+// backward search, if any. The nodes are counted first so that every one can
+// be written straight to its place, the forward half from the back.
+void RoutePlanner::FillPath(int meeting, const SearchWorkspace *backward) {
+    int forward_count = 1, backward_count = 0;
+    for (int node = meeting; workspace.Parent(node) != -1; node = workspace.Parent(node))
+        forward_count++;
+    if (backward != nullptr)
+        for (int node = backward->Parent(meeting); node != -1; node = backward->Parent(node))
+            backward_count++;
+
+    const int node_count = (int)m_Model.SNodes().size();
+    auto path_index = [node_count](int node) { return node < node_count ? node : RoutePath::kSnappedPoint; };
+    path.nodes.resize(forward_count + backward_count);
+    int first = meeting, last = meeting;
+    for (int i = forward_count - 1; i >= 0; i--) {
+        path.nodes[i] = path_index(first);
+        if (i > 0)
+            first = workspace.Parent(first);
+    }
+    if (backward != nullptr)
+        for (int i = forward_count; i < forward_count + backward_count; i++) {
+            last = backward->Parent(last);
+            path.nodes[i] = path_index(last);
+        }
+    FinishPath(first, last);
+}
+
+
+// Records where the path filled into path.nodes starts and ends, the search
+// indices of its first and last vertex, and adds up the distances.
+void RoutePlanner::FinishPath(int first, int last) {
+    path.start = NodeAt(first);
+    path.end = NodeAt(last);
+    path.distances.resize(path.nodes.size());
+    double covered = 0.0;
+    Model::Node previous = path.start;
+    for (std::size_t i = 0; i < path.nodes.size(); i++) {
+        const Model::Node point = path.Point(i, m_Model);
+        covered += std::hypot(point.x - previous.x, point.y - previous.y) * m_Model.MetricScale();
+        path.distances[i] = (float)covered;
+        previous = point;
     }
-  	path_found.emplace_back(*current_node);
-    distance *= m_Model.MetricScale(); // Multiply the distance by the scale of the map to get meters.
-  	// Reverse the path vector so that start and end nodes are ordered correctly.
-  	std::reverse(path_found.begin(), path_found.end());
-    return path_found;
+    distance = path.Length();
 }
 
 
 // TODO 7: Write the A* Search algorithm here.
 // Tips:
-// - Use the AddNeighbors method to add all of the neighbors of the current node to the open_list.
-// - Use the NextNode() method to sort the open_list and return the next node.
-// - When the search has reached the end_node, use the ConstructFinalPath method to return the final path that was found.
-// - Store the final path in the m_Model.path attribute before the method exits. This path will then be displayed on the map tile.
+// - Use the AddNeighbors method to add all of the neighbors of the current node to the open list.
+// - Use the NextNode() method to take the node with the lowest g + h value off the open list.
+// - When the search has reached the end_node, use the ConstructFinalPath method to build the final path that was found.
+// - The model is shared and read-only, so the final path is kept by the planner; GetPath returns it and
+//   the map tile displays it.
 
 void RoutePlanner::AStarSearch() {
-    RouteModel::Node *current_node = nullptr;
-  	start_node->visited = true;
-  	open_list.emplace_back(start_node);
+    RouteModel::Node current_node;
+    expanded_nodes = 0;
+    path.Clear();
+    ResetSearch();
+  	workspace.OpenList().Push(start_node.Index(), workspace.HValue(start_node.Index()));
     // TODO: Implement your solution here.
-  	while (this->open_list.size() > 0) {
+  	while (!workspace.OpenList().Empty()) {
       current_node = NextNode();
-      if (current_node->distance(*end_node) == 0) {
-        m_Model.path = ConstructFinalPath(current_node);
+      expanded_nodes++;
+      if (current_node.distance(end_node) == 0) {
+        ConstructFinalPath(&current_node);
         return;
       } // end if
-      AddNeighbors(current_node);
+      AddNeighbors(&current_node);
     } // end while
 
-}
\ No newline at end of file
+}
+
+
+// The states of the search are the edges of the road graph, numbered as in
+// Graph::EdgeArray(), plus one for the end; the label of an edge holds the
+// cost of arriving at its head along it. The edge a state came in on is its
+// parent, whose head is the state's tail, so turns are judged without a
+// reverse lookup. ClassifyTurn judges turns from the map coordinates, the
+// same way TurnTable reads the kind a restriction names. Where only two roads
+// meet, a bend is not a turn.
+//
+// An edge into a node can take every turn there for at most the largest turn
+// cost, unless the TurnTable restricts it. So an edge into a node that
+// arrives at least that much later than the best unrestricted one can only
+// still matter where the best one would have to make a u-turn, back to its
+// own tail or onto a road leaving at a sharp angle, and arriving later by the
+// largest cost of all, u-turns included, it cannot matter at all. A label
+// per node, after those of the edges, holds the best unrestricted arrival
+// seen and the tail it came from. Without turn costs this keeps the search
+// to as many states as AStarSearch settles nodes.
+void RoutePlanner::EdgeBasedAStarSearch() {
+  const FlatArray<Graph::Edge> &edges = graph.EdgeArray();
+  const FlatArray<int> &offsets = graph.Offsets();
+  const TurnTable &turns = m_Model.Turns(profile);
+  const int goal = graph.EdgeCount(), arrivals = goal + 1;
+  const bool snapped = !virtual_arcs.empty();
+  expanded_nodes = 0;
+  path.Clear();
+  workspace.Reset(arrivals + graph.NodeCount());
+
+  const RoutingProfile::TurnCosts &costs = m_Model.Profile(profile).turn_costs;
+  const float scale = m_Model.WeightScale(profile);
+  const float left = costs.left / scale, right = costs.right / scale, u_turn = costs.u_turn / scale;
+  const float turn_bound = std::max(left, right), bound = std::max(turn_bound, u_turn);
+
+  // Cost of going on to node `to` after arriving at `via` from `from`, with
+  // `junction` set if more than two roads meet at `via`.
+  auto turn_cost = [&](int from, int via, int to, bool junction) {
+    if (bound == 0.0f)
+      return 0.0f;
+    switch (ClassifyTurn(m_Model.Nodes(), from, via, to)) {
+      case Model::TurnKind::UTurn: return u_turn;
+      case Model::TurnKind::Left:  return junction ? left : 0.0f;
+      case Model::TurnKind::Right: return junction ? right : 0.0f;
+      default:                     return 0.0f;
+    }
+  };
+  // `tail` is where the edge `state` starts.
+  auto reach = [&](int state, float g_value, int parent, int tail) {
+    if (workspace.Closed(state))
+      return;
+    float h_value = 0.0f;
+    if (state != goal) {
+      const int head = edges[state].to, arrival = arrivals + head;
+      if (g_value >= workspace.GValue(arrival) + bound)
+        return;
+      if (!turns.Restricted(state) && g_value < workspace.GValue(arrival)) {
+        if (workspace.Reached(arrival))
+          workspace.Relax(arrival, g_value, tail);
+        else
+          workspace.Reach(arrival, g_value, 0.0f, tail);
+      }
+      if (!workspace.Reached(state))
+        h_value = HValue(head, m_Model.SNodes()[head].distance(end_node));
+    }
+    if (!workspace.Reached(state)) {
+      workspace.Reach(state, g_value, h_value, parent);
+      workspace.OpenList().Push(state, g_value + h_value);
+    }
+    else if (g_value < workspace.GValue(state)) {
+      workspace.Relax(state, g_value, parent);
+      workspace.OpenList().DecreaseKey(state, g_value + workspace.HValue(state));
+    }
+  };
+
+  // With Snap::ToEdge the search leaves the end segment's nodes along the
+  // segment: at virtual_arcs[2].from towards the other end, and vice versa.
+  int goal_edges[2] = {-1, -1};
+  if (snapped) {
+    goal_edges[0] = graph.FindEdge(virtual_arcs[2].from, virtual_arcs[3].from);
+    goal_edges[1] = graph.FindEdge(virtual_arcs[3].from, virtual_arcs[2].from);
+  }
+
+  // Entry states start on the start node, or run from the virtual start to
+  // either end of its segment.
+  if (!snapped) {
+    const int start = start_node.Index();
+    if (start == end_node.Index()) {
+      path.nodes = {start};
+      FinishPath(start, start);
+      return;
+    }
+    for (int edge = offsets[start]; edge < offsets[start + 1]; edge++)
+      reach(edge, edges[edge].weight, -1, start);
+  }
+  else {
+    for (int k = 0; k < 2; k++) {
+      int edge = graph.FindEdge(virtual_arcs[1 - k].to, virtual_arcs[k].to);
+      if (edge >= 0)
+        reach(edge, virtual_arcs[k].weight, -1, virtual_arcs[1 - k].to);
+    }
+    if (virtual_arcs.size() > 4)
+      reach(goal, virtual_arcs[4].weight, -1, -1);
+  }
+  auto tail = [&](int state) {
+    int parent = workspace.Parent(state);
+    if (parent >= 0)
+      return edges[parent].to;
+    return snapped ? (edges[state].to == virtual_arcs[0].to ? virtual_arcs[1].to : virtual_arcs[0].to) : start_node.Index();
+  };
+
+  while (!workspace.OpenList().Empty()) {
+    const int current = workspace.OpenList().Pop();
+    workspace.Close(current);
+    if (current == goal) {
+      expanded_nodes++;
+      break;
+    }
+
+    const int from = tail(current), via = edges[current].to;
+    const float g_value = workspace.GValue(current);
+    // Unless this is the best arrival at `via`, it may only be worth taking
+    // the turns the best one makes as u-turns, or none at all: it was queued
+    // before the best one was found.
+    const int arrival = arrivals + via, best_from = workspace.Parent(arrival);
+    bool late = false;
+    if (from != best_from) {
+      if (g_value >= workspace.GValue(arrival) + bound)
+        continue;
+      late = g_value >= workspace.GValue(arrival) + turn_bound;
+    }
+    expanded_nodes++;
+    const int first = offsets[via], last = offsets[via + 1];
+    const bool junction = last - first > 2;
+    auto worth = [&](int to) { return !late || turn_cost(best_from, via, to, junction) > turn_bound; };
+
+    if (!snapped && via == end_node.Index())
+      reach(goal, g_value, current, via);
+    for (int k = 0; k < 2; k++)
+      if (snapped && via == virtual_arcs[2 + k].from && goal_edges[k] >= 0 && worth(edges[goal_edges[k]].to) &&
+          turns.Allowed(current, goal_edges[k]))
+        reach(goal, g_value + turn_cost(from, via, edges[goal_edges[k]].to, junction) + virtual_arcs[2 + k].weight, current, via);
+    for (int next = first; next < last; next++) {
+      const int to = edges[next].to;
+      if (worth(to) && turns.Allowed(current, next))
+        reach(next, g_value + turn_cost(from, via, to, junction) + edges[next].weight, current, via);
+    }
+  }
+  if (!workspace.Closed(goal))
+    return;
+
+  // Entry tail, then the head of every edge, then the end if it is snapped.
+  int count = 0;
+  for (int state = workspace.Parent(goal); state != -1; state = workspace.Parent(state))
+    count++;
+  path.nodes.resize(count + (snapped ? 2 : 1));
+  path.nodes.front() = snapped ? RoutePath::kSnappedPoint : start_node.Index();
+  if (snapped)
+    path.nodes.back() = RoutePath::kSnappedPoint;
+  int i = count;
+  for (int state = workspace.Parent(goal); state != -1; state = workspace.Parent(state))
+    path.nodes[i--] = edges[state].to;
+  FinishPath(start_node.Index(), end_node.Index());
+}
+
+
+// Potential of the forward search in BidirectionalAStarSearch; the backward
+// search uses its negation. Averaging the distances to both ends keeps the two
+// potentials consistent with each other, so the searches can meet anywhere
+// and still stop with a shortest path.
+float RoutePlanner::AveragedPotential(const RouteModel::Node &node) const {
+  return 0.5f * (node.distance(end_node) - node.distance(start_node));
+}
+
+void RoutePlanner::BidirectionalAStarSearch() {
+  BidirectionalAStarSearch(owned_backward_workspace);
+}
+
+void RoutePlanner::BidirectionalAStarSearch(SearchWorkspace &backward) {
+  const int meeting = MeetBidirectional(backward, 0.0f, StartBidirectional(backward), nullptr);
+  if (meeting < 0)
+    return;
+  FillPath(meeting, &backward);
+}
+
+
+// Labels the start and the end for MeetBidirectional, and returns the start
+// if it is the end as well, -1 otherwise.
+int RoutePlanner::StartBidirectional(SearchWorkspace &backward) {
+  SearchWorkspace &forward = workspace;
+  const int start = start_node.Index(), end = end_node.Index();
+  expanded_nodes = 0;
+  path.Clear();
+  ResetSearch();
+  backward.Reset(forward.Size());
+  forward.Reach(start, 0.0f, AveragedPotential(start_node), -1);
+  forward.OpenList().Push(start, forward.HValue(start));
+  backward.Reach(end, 0.0f, -AveragedPotential(end_node), -1);
+  backward.OpenList().Push(end, backward.HValue(end));
+  return start == end ? start : -1;
+}
+
+
+// Runs the two searches of BidirectionalAStarSearch until no path left
+// unseen can be within `stretch` times the shortest one found, and returns
+// the node that path runs through, -1 if the end cannot be reached.
+// `meeting` is the node returned before, so a larger stretch carries on
+// where the last call stopped. Nodes labelled by both searches are added to
+// `both`, if given, once each.
+int RoutePlanner::MeetBidirectional(SearchWorkspace &backward, float stretch, int meeting, std::vector<int> *both) {
+  SearchWorkspace &forward = workspace;
+
+  // Shortest start-end path seen so far, through `meeting`.
+  float best = meeting < 0 ? SearchWorkspace::kInfinity : forward.GValue(meeting) + backward.GValue(meeting);
+
+  // With potentials p and -p the keys of the two open lists add up to at most
+  // the length of any path not seen yet, so the search stops once their
+  // minimums reach the best path found, stretched if asked to.
+  while (!forward.OpenList().Empty() && !backward.OpenList().Empty() &&
+         forward.OpenList().MinKey() + backward.OpenList().MinKey() < best * (1.0f + stretch)) {
+    const bool is_forward = forward.OpenList().MinKey() <= backward.OpenList().MinKey();
+    SearchWorkspace &side = is_forward ? forward : backward;
+    SearchWorkspace &other = is_forward ? backward : forward;
+    const int current = side.OpenList().Pop();
+    side.Close(current);
+    expanded_nodes++;
+
+    const float current_g_value = side.GValue(current);
+    auto scan = [&](int to, float weight) {
+      if (side.Closed(to))
+        return;
+      float g_value = current_g_value + weight;
+      if (!side.Reached(to)) {
+        float potential = AveragedPotential(NodeAt(to));
+        side.Reach(to, g_value, is_forward ? potential : -potential, current);
+        side.OpenList().Push(to, g_value + side.HValue(to));
+        if (both != nullptr && other.Reached(to))
+          both->push_back(to);
+      }
+      else if (g_value < side.GValue(to)) {
+        side.Relax(to, g_value, current);
+        side.OpenList().DecreaseKey(to, g_value + side.HValue(to));
+      }
+      else
+        return;
+      if (other.Reached(to) && g_value + other.GValue(to) < best) {
+        best = g_value + other.GValue(to);
+        meeting = to;
+      }
+    };
+
+    // Every road segment is stored in both directions, so the backward search
+    // walks the same edges; only the virtual arcs are one-way.
+    if (current < (int)m_Model.SNodes().size())
+      for (const Graph::Edge &edge : graph.Edges(current))
+        scan(edge.to, edge.weight);
+    for (const Graph::Arc &arc : virtual_arcs) {
+      if (is_forward && arc.from == current)
+        scan(arc.to, arc.weight);
+      else if (!is_forward && arc.to == current)
+        scan(arc.from, arc.weight);
+    }
+  }
+  return meeting;
+}
+
+
+std::vector<RoutePath> RoutePlanner::AlternativeRoutesSearch(const AlternativeRouteOptions &options) {
+  return AlternativeRoutesSearch(owned_backward_workspace, options);
+}
+
+// The plateau method. Run on past the shortest path, the two searches leave a
+// tree of shortest paths from the start and one towards the end, final for
+// the nodes each has settled. A chain of segments that both trees take
+// between nodes both have settled, a plateau, lies on the shortest path from
+// the start through any of its nodes and on to the end, so following the
+// forward tree up to the plateau, the plateau and then the backward tree
+// gives a route with no needless detour along the plateau. Every plateau
+// gives one route; they are tried shorter first and kept unless too much of
+// their length is shared with a route kept before.
+//
+// The nodes settled grow quickly with the stretch while the routes kept are
+// mostly short ones, so the searches are run on a step at a time, doubling
+// the stretch from kFirstStretch, and stop once enough routes turn up.
+std::vector<RoutePath> RoutePlanner::AlternativeRoutesSearch(SearchWorkspace &backward, const AlternativeRouteOptions &options) {
+  constexpr float kFirstStretch = 0.025f;
+  SearchWorkspace &forward = workspace;
+  std::vector<int> both;
+  std::vector<RoutePath> routes;
+
+  // Plateaus are walked from their first node, the only one of them whose
+  // forward parent is not on the plateau, so each is walked once. Nodes only
+  // reached by either search may still get shorter parents and are left out.
+  auto settled = [&](int node) { return forward.Closed(node) && backward.Closed(node); };
+  auto on_plateau = [&](int from, int to) {
+    return forward.Parent(to) == from && backward.Parent(from) == to && settled(from) && settled(to);
+  };
+  struct Plateau {
+    float weight;
+    int first;
+  };
+  std::vector<Plateau> plateaus;
+
+  // The segments of a route between model nodes, each stored with its lower
+  // node first, sorted so that later routes can look theirs up.
+  using Segment = std::pair<int, int>;
+  auto segments = [](const RoutePath &route) {
+    std::vector<Segment> result;
+    for (std::size_t i = 1; i < route.nodes.size(); i++)
+      if (route.nodes[i - 1] != RoutePath::kSnappedPoint && route.nodes[i] != RoutePath::kSnappedPoint)
+        result.push_back(std::minmax(route.nodes[i - 1], route.nodes[i]));
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  std::vector<std::vector<Segment>> kept;
+
+  int meeting = StartBidirectional(backward);
+  for (float stretch = std::min(kFirstStretch, options.max_stretch);; stretch = std::min(2.0f * stretch, options.max_stretch)) {
+    meeting = MeetBidirectional(backward, stretch, meeting, &both);
+    if (meeting < 0)
+      return routes;
+    const float best = forward.GValue(meeting) + backward.GValue(meeting);
+
+    plateaus.clear();
+    for (int node : both) {
+      if (!settled(node) || (forward.Parent(node) != -1 && on_plateau(forward.Parent(node), node)))
+        continue;
+      int last = node;
+      while (backward.Parent(last) != -1 && on_plateau(last, backward.Parent(last)))
+        last = backward.Parent(last);
+      const float weight = forward.GValue(last) + backward.GValue(last);
+      if (weight <= best * (1.0f + stretch) && forward.GValue(last) - forward.GValue(node) >= best * options.min_plateau)
+        plateaus.push_back({weight, node});
+    }
+    std::sort(plateaus.begin(), plateaus.end(), [](const Plateau &a, const Plateau &b) { return a.weight < b.weight; });
+
+    routes.clear();
+    kept.clear();
+    FillPath(meeting, &backward);
+    routes.push_back(path);
+    kept.push_back(segments(path));
+    for (const Plateau &plateau : plateaus) {
+      if ((int)routes.size() >= options.max_routes)
+        break;
+      FillPath(plateau.first, &backward);
+      // The two trees may cross before and after the plateau; such a route
+      // passes a node twice and is left out.
+      std::vector<int> nodes = path.nodes;
+      std::sort(nodes.begin(), nodes.end());
+      if (std::adjacent_find(std::upper_bound(nodes.begin(), nodes.end(), RoutePath::kSnappedPoint), nodes.end()) != nodes.end())
+        continue;
+      bool similar = false;
+      for (const std::vector<Segment> &other : kept) {
+        float shared = 0.0f;
+        for (std::size_t i = 1; i < path.nodes.size(); i++)
+          if (std::binary_search(other.begin(), other.end(), Segment(std::minmax(path.nodes[i - 1], path.nodes[i]))))
+            shared += path.distances[i] - path.distances[i - 1];
+        similar = similar || shared > options.max_similarity * path.Length();
+      }
+      if (similar)
+        continue;
+      routes.push_back(path);
+      kept.push_back(segments(path));
+    }
+    if ((int)routes.size() >= options.max_routes || stretch >= options.max_stretch)
+      break;
+  }
+
+  path = routes.front();
+  distance = path.Length();
+  return routes;
+}
+
+
+void RoutePlanner::ContractionHierarchySearch(const ContractionHierarchy &hierarchy) {
+  ContractionHierarchySearch(hierarchy, owned_backward_workspace);
+}
+
+void RoutePlanner::ContractionHierarchySearch(const ContractionHierarchy &hierarchy, SearchWorkspace &backward) {
+  const int node_count = (int)m_Model.SNodes().size();
+  if (hierarchy.NodeCount() != node_count)
+    throw std::logic_error("contraction hierarchy was built for a different map");
+  if (hierarchy.Profile() != profile || hierarchy.GraphVersion() != m_Model.GraphVersion())
+    throw std::logic_error("contraction hierarchy was built for a different profile or graph version");
+  expanded_nodes = 0;
+  distance = 0.0f;
+  path.Clear();
+
+  // The virtual nodes are not part of the hierarchy: the query instead starts
+  // from the ends of the start segment and stops at the ends of the end
+  // segment, each already at the distance of its virtual arc.
+  std::vector<ContractionHierarchy::Seed> sources, targets;
+  float direct = SearchWorkspace::kInfinity;
+  if (virtual_arcs.empty()) {
+    sources.push_back({start_node.Index(), 0.0f});
+    targets.push_back({end_node.Index(), 0.0f});
+  }
+  for (const Graph::Arc &arc : virtual_arcs) {
+    if (arc.from == virtual_start.Index() && arc.to == virtual_end.Index())
+      direct = arc.weight;
+    else if (arc.from == virtual_start.Index())
+      sources.push_back({arc.to, arc.weight});
+    else
+      targets.push_back({arc.from, arc.weight});
+  }
+
+  ContractionHierarchy::Result result = hierarchy.Query(sources, targets, workspace, backward);
+  expanded_nodes = result.settled;
+  if (direct != SearchWorkspace::kInfinity && direct <= result.distance) {
+    path.nodes = {RoutePath::kSnappedPoint, RoutePath::kSnappedPoint};
+    FinishPath(virtual_start.Index(), virtual_end.Index());
+  }
+  else if (!result.nodes.empty()) {
+    const bool snapped = !virtual_arcs.empty();
+    path.nodes.resize(result.nodes.size() + (snapped ? 2 : 0));
+    std::copy(result.nodes.begin(), result.nodes.end(), path.nodes.begin() + (snapped ? 1 : 0));
+    if (snapped) {
+      path.nodes.front() = path.nodes.back() = RoutePath::kSnappedPoint;
+      FinishPath(virtual_start.Index(), virtual_end.Index());
+    }
+    else {
+      FinishPath(result.nodes.front(), result.nodes.back());
+    }
+  }
+}
@@ -4,30 +4,134 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include "contraction_hierarchy.h"
+#include "landmarks.h"
 #include "route_model.h"
+#include "route_path.h"
+#include "search_workspace.h"
+
+
+// What AlternativeRoutesSearch accepts as a route besides the shortest one.
+struct AlternativeRouteOptions {
+    // Most routes returned, the shortest one included.
+    int max_routes = 3;
+    // How much longer than the shortest route, in the profile's weight, an
+    // alternative may be: 0.25 allows 25% more.
+    float max_stretch = 0.25f;
+    // Largest share of an alternative's length it may have in common with
+    // any route picked before it.
+    float max_similarity = 0.6f;
+    // Shortest plateau, as a share of the shortest route's weight, that an
+    // alternative must run along; shorter ones make for needless detours.
+    float min_plateau = 0.1f;
+};
 
 
 class RoutePlanner {
   public:
-    RoutePlanner(RouteModel &model, float start_x, float start_y, float end_x, float end_y);
+    // How the start and end coordinates are attached to the road network.
+    enum class Snap {
+        ToNode, // the closest node of a drivable road
+        ToEdge, // the closest point on a drivable road segment
+    };
+
+    // `profile` picks the RouteModel profile whose roads and weights are used.
+    RoutePlanner(const RouteModel &model, float start_x, float start_y, float end_x, float end_y, Snap snap = Snap::ToNode,
+                 int profile = RouteModel::kDefaultProfile);
+    // Runs the query in a caller-owned workspace, which can be reused across
+    // queries against the same model (one workspace per thread).
+    RoutePlanner(const RouteModel &model, SearchWorkspace &workspace, float start_x, float start_y, float end_x, float end_y, Snap snap = Snap::ToNode,
+                 int profile = RouteModel::kDefaultProfile);
+    // Runs the query between endpoints snapped beforehand with SnapPoint, so
+    // callers routing many pairs snap every coordinate only once. The snap
+    // and profile must be the ones the endpoints were snapped with.
+    RoutePlanner(const RouteModel &model, SearchWorkspace &workspace, const RouteModel::EdgePoint &start, const RouteModel::EdgePoint &end,
+                 Snap snap = Snap::ToNode, int profile = RouteModel::kDefaultProfile);
+    // Attaches a point given in percent coordinates to the profile's roads.
+    // With Snap::ToNode the result lies on the closest node, `from` and `to`
+    // both being its index.
+    static RouteModel::EdgePoint SnapPoint(const RouteModel &model, float x, float y, Snap snap = Snap::ToNode,
+                                           int profile = RouteModel::kDefaultProfile);
     // Add public variables or methods declarations here.
     float GetDistance() const {return distance;}
+    int GetExpandedNodes() const {return expanded_nodes;}
+    const RoutePath &GetPath() const {return path;}
     void AStarSearch();
+    // Makes AStarSearch guide the search with landmark lower bounds as well as
+    // the straight-line distance. The landmarks must outlive the planner;
+    // throws std::logic_error unless they were computed for the planner's
+    // profile at the model's current GraphVersion.
+    void UseLandmarks(const Landmarks &landmarks);
+    // Searches forward from the start and backward from the end at the same
+    // time. Finds a path of the same length as AStarSearch while settling about
+    // half as many nodes on long queries. The backward search runs in a second
+    // workspace, either the one given or one owned by the planner.
+    void BidirectionalAStarSearch();
+    void BidirectionalAStarSearch(SearchWorkspace &backward_workspace);
+    // Finds up to options.max_routes meaningfully different routes, the
+    // shortest first, from one forward and one backward search run only as
+    // far past the shortest path as it takes to find them. GetPath returns the shortest route afterwards. Uses the
+    // same workspaces as BidirectionalAStarSearch.
+    std::vector<RoutePath> AlternativeRoutesSearch(const AlternativeRouteOptions &options = {});
+    std::vector<RoutePath> AlternativeRoutesSearch(SearchWorkspace &backward_workspace, const AlternativeRouteOptions &options = {});
+    // Answers the query from a hierarchy built over the model's road graph,
+    // unpacking its shortcuts into the same kind of path AStarSearch returns.
+    // Throws std::logic_error unless the hierarchy was built for this
+    // planner's profile at the model's current GraphVersion.
+    void ContractionHierarchySearch(const ContractionHierarchy &hierarchy);
+    void ContractionHierarchySearch(const ContractionHierarchy &hierarchy, SearchWorkspace &backward_workspace);
+    // Searches over the road segments rather than the nodes, so that every
+    // step knows the segment it came in on: turns the profile's TurnTable
+    // forbids are never taken and each turn adds the profile's turn cost.
+    // The workspace holds a label per edge of the road graph. Without
+    // restrictions and turn costs the path is as long as AStarSearch's.
+    void EdgeBasedAStarSearch();
 
     // The following methods have been made public so we can test them individually.
-    void AddNeighbors(RouteModel::Node *current_node);
-    float CalculateHValue(RouteModel::Node const *node);
-    std::vector<RouteModel::Node> ConstructFinalPath(RouteModel::Node *);
-    RouteModel::Node *NextNode();
+    void AddNeighbors(const RouteModel::Node *current_node);
+    float CalculateHValue(RouteModel::Node const *node) const;
+    const RoutePath &ConstructFinalPath(const RouteModel::Node *);
+    RouteModel::Node NextNode();
 
   private:
     // Add private variables or methods declarations here.
-    std::vector<RouteModel::Node*> open_list;
-    RouteModel::Node *start_node;
-    RouteModel::Node *end_node;
+    void ResetSearch();
+    void SnapToEdges(const RouteModel::EdgePoint &start, const RouteModel::EdgePoint &end);
+    void ScanEdge(int current, float current_g_value, int to, float weight, float distance);
+    RouteModel::Node NodeAt(int index) const;
+    float AveragedPotential(const RouteModel::Node &node) const;
+    int StartBidirectional(SearchWorkspace &backward);
+    int MeetBidirectional(SearchWorkspace &backward, float stretch, int meeting, std::vector<int> *both);
+    float HValue(int node, float distance) const;
+    float LandmarkBound(int node) const;
+    void FillPath(int meeting, const SearchWorkspace *backward);
+    void FinishPath(int first, int last);
+
+    RouteModel::Node start_node;
+    RouteModel::Node end_node;
+
+    // With Snap::ToEdge the search starts and ends at virtual nodes placed on the
+    // snapped segments. They are numbered right after the model's own nodes and
+    // joined to the ends of their segments by virtual_arcs.
+    RouteModel::Node virtual_start;
+    RouteModel::Node virtual_end;
+    std::vector<Graph::Arc> virtual_arcs;
+
+    // With landmarks, the nodes at which the search may leave the graph for
+    // the end, and the distance left from each.
+    const Landmarks *landmarks = nullptr;
+    std::vector<std::pair<int, float>> landmark_targets;
 
     float distance = 0.0f;
-    RouteModel &m_Model;
+    int expanded_nodes = 0;
+    RoutePath path;
+    const RouteModel &m_Model;
+    const int profile;
+    // The profile's road graph, weighted once at load.
+    const Graph &graph;
+    SearchWorkspace owned_workspace;
+    SearchWorkspace &workspace;
+    SearchWorkspace owned_backward_workspace;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,52 @@
+#include "routing_profile.h"
+#include <algorithm>
+
+float RoutingProfile::TopSpeed() const {
+    return *std::max_element(speeds.begin(), speeds.end());
+}
+
+
+RoutingProfile RoutingProfile::Car() {
+    RoutingProfile profile = CarFastest();
+    profile.name = "car";
+    profile.metric = Metric::Distance;
+    profile.turn_costs = {};
+    return profile;
+}
+
+
+RoutingProfile RoutingProfile::CarFastest() {
+    RoutingProfile profile;
+    profile.name = "car-fastest";
+    profile.metric = Metric::Time;
+    profile.speeds[Model::Road::Unclassified] = 40.0f;
+    profile.speeds[Model::Road::Service] = 20.0f;
+    profile.speeds[Model::Road::Residential] = 30.0f;
+    profile.speeds[Model::Road::Tertiary] = 50.0f;
+    profile.speeds[Model::Road::Secondary] = 60.0f;
+    profile.speeds[Model::Road::Primary] = 70.0f;
+    profile.speeds[Model::Road::Trunk] = 90.0f;
+    profile.speeds[Model::Road::Motorway] = 110.0f;
+    profile.obeys_turn_restrictions = true;
+    // Waiting for oncoming traffic before a left turn, slowing down for a
+    // right one, and a three-point turn.
+    profile.turn_costs = {8.0f, 3.0f, 20.0f};
+    return profile;
+}
+
+
+RoutingProfile RoutingProfile::Walking() {
+    RoutingProfile profile;
+    profile.name = "walking";
+    profile.metric = Metric::Distance;
+    for (Model::Road::Type type : {Model::Road::Unclassified, Model::Road::Service, Model::Road::Residential,
+                                   Model::Road::Tertiary, Model::Road::Secondary, Model::Road::Primary,
+                                   Model::Road::Footway})
+        profile.speeds[type] = 5.0f;
+    return profile;
+}
+
+
+std::vector<RoutingProfile> RoutingProfile::Defaults() {
+    return {Car(), CarFastest(), Walking()};
+}
@@ -0,0 +1,57 @@
+#ifndef ROUTING_PROFILE_H
+#define ROUTING_PROFILE_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include "model.h"
+
+// How one mode of travel values the roads of a map: which road types it may
+// use, how fast it moves on each, and whether routes minimise distance or
+// time. RouteModel turns every profile into its own weighted Graph once at
+// load, so a query only ever reads edge weights.
+//
+// Time weights are expressed as the distance covered at the profile's top
+// speed in the same time. Every edge then weighs at least its length, which
+// keeps the straight-line distance a valid A* heuristic for every profile.
+struct RoutingProfile {
+    enum class Metric { Distance, Time };
+    static constexpr int kRoadTypeCount = Model::Road::Footway + 1;
+
+    // What RoutePlanner::EdgeBasedAStarSearch adds for turning at a node, in
+    // metres for Metric::Distance and seconds for Metric::Time. Turns within
+    // 30 degrees of straight on, and bends where only two roads meet, are
+    // free; traffic keeps to the right.
+    struct TurnCosts {
+        float left = 0.0f;
+        float right = 0.0f;
+        float u_turn = 0.0f;
+    };
+
+    std::string name;
+    Metric metric = Metric::Distance;
+    // km/h per Model::Road::Type; 0 keeps the profile off that type of road.
+    std::array<float, kRoadTypeCount> speeds{};
+    // Whether the map's turn restrictions apply to this mode of travel.
+    bool obeys_turn_restrictions = false;
+    TurnCosts turn_costs;
+
+    bool Allows(Model::Road::Type type) const { return speeds[type] > 0.0f; }
+    float TopSpeed() const;
+    // Weight of a segment of the given length on a road of the given type.
+    float Weight(float length, Model::Road::Type type) const {
+        return metric == Metric::Distance ? length : length * (TopSpeed() / speeds[type]);
+    }
+
+    // Shortest routes by car over every road type but footways.
+    static RoutingProfile Car();
+    // Quickest routes by car, from typical urban speeds per road type.
+    static RoutingProfile CarFastest();
+    // Shortest routes on foot, footways included and trunk roads and motorways
+    // left out.
+    static RoutingProfile Walking();
+    // The profiles a RouteModel builds, Car first.
+    static std::vector<RoutingProfile> Defaults();
+};
+
+#endif
@@ -0,0 +1,18 @@
+#include "search_workspace.h"
+
+void SearchWorkspace::Reset(int size) {
+    if (size > Size()) {
+        labels.assign(size, Label{});
+        open_list.Resize(size);
+        generation = 1;
+        return;
+    }
+
+    open_list.Clear();
+    if (++generation == 0) {
+        // The stamp wrapped around: old labels could look current again.
+        for (Label &label : labels)
+            label.generation = 0;
+        generation = 1;
+    }
+}
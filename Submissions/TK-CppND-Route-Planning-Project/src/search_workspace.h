@@ -0,0 +1,62 @@
+#ifndef SEARCH_WORKSPACE_H
+#define SEARCH_WORKSPACE_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "indexed_heap.h"
+
+// Per-query search state for the nodes of one RouteModel: g and h values,
+// parents, the closed set and the open list. The model itself stays read-only,
+// so any number of workspaces (one per thread) can search the same map at once.
+//
+// Every label carries the generation it was written in. Reset() bumps the
+// generation instead of clearing the arrays, which makes labels from earlier
+// queries stale in O(1); only what is left on the open list is cleared.
+class SearchWorkspace {
+  public:
+    static constexpr float kInfinity = std::numeric_limits<float>::infinity();
+
+    SearchWorkspace() {}
+    explicit SearchWorkspace(int size) { Reset(size); }
+
+    // Starts a new query over node ids [0, size). The arrays only ever grow, so
+    // queries of different sizes can share a workspace without reallocating.
+    void Reset(int size);
+
+    int Size() const { return (int)labels.size(); }
+    bool Reached(int node) const { return labels[node].generation == generation; }
+    bool Closed(int node) const { return Reached(node) && labels[node].closed; }
+    float GValue(int node) const { return Reached(node) ? labels[node].g_value : kInfinity; }
+    float HValue(int node) const { return Reached(node) ? labels[node].h_value : kInfinity; }
+    int Parent(int node) const { return Reached(node) ? labels[node].parent : -1; }
+
+    // Labels a node seen for the first time in this query.
+    void Reach(int node, float g_value, float h_value, int parent) {
+        labels[node] = Label{g_value, h_value, parent, generation, false};
+    }
+    // Records a shorter path to a node that is already labelled.
+    void Relax(int node, float g_value, int parent) {
+        labels[node].g_value = g_value;
+        labels[node].parent = parent;
+    }
+    void Close(int node) { labels[node].closed = true; }
+
+    IndexedHeap<4> &OpenList() { return open_list; }
+    const IndexedHeap<4> &OpenList() const { return open_list; }
+
+  private:
+    struct Label {
+        float g_value = kInfinity;
+        float h_value = kInfinity;
+        int parent = -1;
+        std::uint32_t generation = 0;
+        bool closed = false;
+    };
+
+    std::vector<Label> labels;
+    std::uint32_t generation = 0;
+    IndexedHeap<4> open_list;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "segment_index.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+// Cap on the grid resolution along either axis.
+static constexpr int kMaxCells = 4096;
+
+static SegmentIndex::Projection Project(const SegmentIndex::Segment &segment, double x, double y) {
+    double dx = segment.bx - segment.ax, dy = segment.by - segment.ay;
+    double length2 = dx * dx + dy * dy;
+    double t = length2 > 0. ? ((x - segment.ax) * dx + (y - segment.ay) * dy) / length2 : 0.;
+    t = std::clamp(t, 0., 1.);
+
+    SegmentIndex::Projection projection;
+    projection.t = t;
+    projection.x = segment.ax + t * dx;
+    projection.y = segment.ay + t * dy;
+    projection.distance = std::hypot(projection.x - x, projection.y - y);
+    return projection;
+}
+
+SegmentIndex::SegmentIndex(std::vector<Segment> segments) : segments(std::move(segments)) {
+    if (this->segments.empty())
+        return;
+    std::vector<int> cell_offsets, cell_segments;
+
+    double max_x = std::numeric_limits<double>::lowest(), max_y = max_x;
+    min_x = min_y = std::numeric_limits<double>::max();
+    for (const Segment &s : this->segments) {
+        min_x = std::min({min_x, s.ax, s.bx});
+        max_x = std::max({max_x, s.ax, s.bx});
+        min_y = std::min({min_y, s.ay, s.by});
+        max_y = std::max({max_y, s.ay, s.by});
+    }
+
+    // About one segment per cell.
+    double width = max_x - min_x, height = max_y - min_y;
+    cell_size = std::sqrt(std::max(width * height, 1e-18) / Size());
+    cell_size = std::max({cell_size, width / kMaxCells, height / kMaxCells, 1e-12});
+    columns = std::min(kMaxCells, (int)(width / cell_size) + 1);
+    rows = std::min(kMaxCells, (int)(height / cell_size) + 1);
+
+    cell_offsets.assign(columns * rows + 1, 0);
+    for (const Segment &segment : this->segments)
+        ForEachCell(segment, [&](int cell) { cell_offsets[cell + 1]++; });
+    for (int cell = 0; cell < columns * rows; cell++)
+        cell_offsets[cell + 1] += cell_offsets[cell];
+    cell_segments.resize(cell_offsets.back());
+    std::vector<int> next(cell_offsets.begin(), cell_offsets.end() - 1);
+    for (int i = 0; i < Size(); i++)
+        ForEachCell(this->segments[i], [&](int cell) { cell_segments[next[cell]++] = i; });
+    this->cell_offsets = std::move(cell_offsets);
+    this->cell_segments = std::move(cell_segments);
+}
+
+SegmentIndex::SegmentIndex(const GraphCache &cache, int profile, int id_count)
+    : segments(cache.View<Segment>(GraphCache::ProfileSection(profile, GraphCache::Segments))),
+      cell_offsets(cache.View<int>(GraphCache::ProfileSection(profile, GraphCache::SegmentCellOffsets))),
+      cell_segments(cache.View<int>(GraphCache::ProfileSection(profile, GraphCache::SegmentCells))) {
+    auto grid = cache.Read<double>(GraphCache::ProfileSection(profile, GraphCache::SegmentGrid));
+    bool valid = grid.size() == 5 && grid[2] > 0. && grid[3] >= 0. && grid[3] <= kMaxCells && grid[4] >= 0. &&
+                 grid[4] <= kMaxCells;
+    if (valid) {
+        min_x = grid[0];
+        min_y = grid[1];
+        cell_size = grid[2];
+        columns = (int)grid[3];
+        rows = (int)grid[4];
+        if (segments.empty())
+            valid = cell_offsets.empty() && cell_segments.empty();
+        else
+            valid = columns > 0 && rows > 0 && (int)cell_offsets.size() == columns * rows + 1 &&
+                    cell_offsets.front() == 0 && cell_offsets.back() == (int)cell_segments.size();
+    }
+    for (std::size_t cell = 1; valid && cell < cell_offsets.size(); cell++)
+        valid = cell_offsets[cell - 1] <= cell_offsets[cell];
+    for (int segment : cell_segments)
+        valid = valid && segment >= 0 && segment < Size();
+    for (const Segment &segment : segments)
+        valid = valid && segment.from >= 0 && segment.from < id_count && segment.to >= 0 && segment.to < id_count;
+    if (!valid)
+        throw std::logic_error("graph cache holds a malformed segment index");
+}
+
+int SegmentIndex::Column(double x) const {
+    return std::clamp((int)std::floor((x - min_x) / cell_size), 0, columns - 1);
+}
+
+int SegmentIndex::Row(double y) const {
+    return std::clamp((int)std::floor((y - min_y) / cell_size), 0, rows - 1);
+}
+
+// Calls visit(cell) for every cell the segment passes through, column by column.
+template <typename Visit>
+void SegmentIndex::ForEachCell(const Segment &segment, Visit visit) const {
+    double x0 = std::min(segment.ax, segment.bx), x1 = std::max(segment.ax, segment.bx);
+    double dx = segment.bx - segment.ax;
+    auto y_at = [&](double x) {
+        return dx == 0. ? segment.ay : segment.ay + (x - segment.ax) / dx * (segment.by - segment.ay);
+    };
+
+    for (int column = Column(x0), last = Column(x1); column <= last; column++) {
+        double lo = std::max(x0, min_x + column * cell_size);
+        double hi = std::min(x1, min_x + (column + 1) * cell_size);
+        double y0 = dx == 0. ? std::min(segment.ay, segment.by) : std::min(y_at(lo), y_at(hi));
+        double y1 = dx == 0. ? std::max(segment.ay, segment.by) : std::max(y_at(lo), y_at(hi));
+        for (int row = Row(y0), last_row = Row(y1); row <= last_row; row++)
+            visit(row * columns + column);
+    }
+}
+
+SegmentIndex::Projection SegmentIndex::Nearest(double x, double y) const {
+    Projection best;
+    best.distance = std::numeric_limits<double>::infinity();
+    if (segments.empty())
+        return best;
+
+    int column = Column(x), row = Row(y);
+    for (int ring = 0; ; ring++) {
+        int c0 = column - ring, c1 = column + ring, r0 = row - ring, r1 = row + ring;
+        for (int r = std::max(r0, 0); r <= std::min(r1, rows - 1); r++) {
+            for (int c = std::max(c0, 0); c <= std::min(c1, columns - 1); c++) {
+                // Only the border of the square is new in this ring.
+                if (r != r0 && r != r1 && c != c0 && c != c1)
+                    continue;
+                int cell = r * columns + c;
+                for (int i = cell_offsets[cell]; i < cell_offsets[cell + 1]; i++) {
+                    Projection projection = Project(segments[cell_segments[i]], x, y);
+                    if (projection.distance < best.distance) {
+                        best = projection;
+                        best.segment = cell_segments[i];
+                    }
+                }
+            }
+        }
+
+        // Anything not searched yet lies outside the square of cells covered so far.
+        if (c0 <= 0 && r0 <= 0 && c1 >= columns - 1 && r1 >= rows - 1)
+            break;
+        double margin = std::min({x - (min_x + c0 * cell_size), min_x + (c1 + 1) * cell_size - x,
+                                  y - (min_y + r0 * cell_size), min_y + (r1 + 1) * cell_size - y});
+        if (best.distance <= margin)
+            break;
+    }
+    return best;
+}
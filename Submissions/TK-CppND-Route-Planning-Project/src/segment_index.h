@@ -0,0 +1,59 @@
+#ifndef SEGMENT_INDEX_H
+#define SEGMENT_INDEX_H
+
+#include <vector>
+#include "flat_array.h"
+#include "graph_cache.h"
+
+// Uniform grid over line segments for nearest-segment queries. Every segment is
+// listed in each cell it crosses, and a query searches rings of cells around the
+// query point until no unsearched cell can hold anything closer.
+class SegmentIndex {
+  public:
+    struct Segment {
+        double ax, ay;
+        double bx, by;
+        // Caller ids of the two endpoints.
+        int from, to;
+    };
+
+    struct Projection {
+        // Index of the segment in the constructor's list, -1 if there is none.
+        int segment = -1;
+        // Position of the projected point along the segment, 0 at a and 1 at b.
+        double t = 0.;
+        double x = 0.;
+        double y = 0.;
+        double distance = 0.;
+    };
+
+    SegmentIndex() {}
+    explicit SegmentIndex(std::vector<Segment> segments);
+    // Restores the index of `profile` saved in a GraphCache, checking that
+    // the segment endpoints are below `id_count`.
+    SegmentIndex(const GraphCache &cache, int profile, int id_count);
+
+    int Size() const { return (int)segments.size(); }
+    const Segment &operator[](int segment) const { return segments[segment]; }
+
+    // Closest point on any segment to (x, y).
+    Projection Nearest(double x, double y) const;
+
+  private:
+    friend class GraphCache;
+
+    template <typename Visit>
+    void ForEachCell(const Segment &segment, Visit visit) const;
+    int Column(double x) const;
+    int Row(double y) const;
+
+    FlatArray<Segment> segments;
+    double min_x = 0., min_y = 0.;
+    double cell_size = 1.;
+    int columns = 0, rows = 0;
+    // Segments of cell c are cell_segments[cell_offsets[c]] .. cell_segments[cell_offsets[c + 1]].
+    FlatArray<int> cell_offsets;
+    FlatArray<int> cell_segments;
+};
+
+#endif
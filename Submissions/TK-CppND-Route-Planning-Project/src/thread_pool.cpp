@@ -0,0 +1,64 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(int thread_count) {
+    if (thread_count <= 0)
+        thread_count = HardwareThreads();
+    for (int i = 1; i < thread_count; i++)
+        workers.emplace_back([this] { WorkerLoop(); });
+}
+
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    job_ready.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+
+int ThreadPool::HardwareThreads() {
+    unsigned threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : (int)threads;
+}
+
+
+void ThreadPool::RunWithHelpers(int helpers, const std::function<void()> &work) {
+    std::mutex done_mutex;
+    std::condition_variable done;
+    int running = helpers;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        for (int i = 0; i < helpers; i++) {
+            jobs.emplace_back([&] {
+                work();
+                std::lock_guard<std::mutex> done_lock{done_mutex};
+                if (--running == 0)
+                    done.notify_one();
+            });
+        }
+    }
+    job_ready.notify_all();
+
+    work();
+    std::unique_lock<std::mutex> lock{done_mutex};
+    done.wait(lock, [&] { return running == 0; });
+}
+
+
+void ThreadPool::WorkerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            job_ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
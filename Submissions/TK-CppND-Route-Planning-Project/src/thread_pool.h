@@ -0,0 +1,81 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads fed from one job queue. ParallelFor hands out
+// indices one at a time through an atomic counter, so uneven tasks (a huge
+// multipolygon next to tiny ones, a long query next to a short one) still
+// balance across the workers. The calling thread works on the loop too, which
+// also makes a pool of one thread plain sequential execution.
+class ThreadPool {
+  public:
+    // 0 uses one thread per hardware core.
+    explicit ThreadPool(int thread_count = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Threads taking part in ParallelFor, the caller included.
+    int ThreadCount() const { return (int)workers.size() + 1; }
+
+    // Calls task(i) for every i in [0, count) and returns once all calls are
+    // done. The first exception thrown by a task is rethrown here. Tasks must
+    // not call ParallelFor on the same pool.
+    //
+    // A task taking (i, thread) is also told which thread runs it, a slot in
+    // [0, ThreadCount()) that no other thread uses during the loop, for
+    // indexing per-thread scratch space such as search workspaces.
+    template <typename Task>
+    void ParallelFor(int count, Task &&task) {
+        std::atomic<int> next{0}, threads{0};
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        auto work = [&] {
+            const int thread = threads++;
+            for (int i = next++; i < count; i = next++) {
+                try {
+                    if constexpr (std::is_invocable_v<Task &, int, int>)
+                        task(i, thread);
+                    else
+                        task(i);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock{error_mutex};
+                    if (!error)
+                        error = std::current_exception();
+                    next = count;
+                }
+            }
+        };
+        const int helpers = std::max(0, std::min((int)workers.size(), count - 1));
+        RunWithHelpers(helpers, work);
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    static int HardwareThreads();
+
+  private:
+    // Runs `work` on the calling thread and on `helpers` workers, then waits
+    // for all of them.
+    void RunWithHelpers(int helpers, const std::function<void()> &work);
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable job_ready;
+    bool stopping = false;
+};
+
+#endif
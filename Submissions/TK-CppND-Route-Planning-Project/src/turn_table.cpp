@@ -0,0 +1,95 @@
+#include "turn_table.h"
+#include <stdexcept>
+#include <utility>
+
+// The edges of `graph` between `via` and its neighbours on `way`: into `via`
+// if `inbound`, out of it otherwise, each with the neighbour at its other end.
+// A via node in the middle of the way has a neighbour on either side.
+static std::vector<std::pair<int, int>> WayEdges(const Model &model, const Graph &graph, int way, int via, bool inbound) {
+    std::vector<std::pair<int, int>> edges;
+    Model::IndexRange nodes = model.WayNodes(way);
+    for (int i = 0; i < (int)nodes.size(); i++) {
+        if (nodes[i] != via)
+            continue;
+        for (int j : {i - 1, i + 1}) {
+            if (j < 0 || j >= (int)nodes.size())
+                continue;
+            int edge = inbound ? graph.FindEdge(nodes[j], via) : graph.FindEdge(via, nodes[j]);
+            if (edge >= 0)
+                edges.emplace_back(edge, nodes[j]);
+        }
+    }
+    return edges;
+}
+
+Model::TurnKind ClassifyTurn(const Model::NodeStore &nodes, int from, int via, int to) {
+    constexpr float kStraight = 1.0f / 3.0f, kBack = 0.0311f; // tan^2 of 30 and 10 degrees
+    if (to == from)
+        return Model::TurnKind::UTurn;
+    const float *xs = nodes.Xs(), *ys = nodes.Ys();
+    float in_x = xs[via] - xs[from], in_y = ys[via] - ys[from];
+    float out_x = xs[to] - xs[via], out_y = ys[to] - ys[via];
+    float dot = in_x * out_x + in_y * out_y, cross = in_x * out_y - in_y * out_x;
+    if (cross * cross <= kBack * dot * dot && dot < 0.0f)
+        return Model::TurnKind::UTurn;
+    if (cross * cross <= kStraight * dot * dot && dot > 0.0f)
+        return Model::TurnKind::Straight;
+    return cross > 0.0f ? Model::TurnKind::Left : Model::TurnKind::Right;
+}
+
+
+TurnTable::TurnTable(const Model &model, const Graph &graph) {
+    for (const Model::TurnRestriction &restriction : model.TurnRestrictions()) {
+        const int via = restriction.via_node;
+        if (via >= graph.NodeCount())
+            continue;
+        auto in = WayEdges(model, graph, restriction.from_way, via, true);
+        auto out = WayEdges(model, graph, restriction.to_way, via, false);
+        // With the via node in the middle of the from way the relation does
+        // not say which way along it the restriction holds. It is taken to
+        // hold for the directions from which a turn onto the to way is of
+        // the kind it names.
+        if (in.size() > 1 && restriction.turn != Model::TurnKind::Any)
+            in.erase(std::remove_if(in.begin(), in.end(), [&](auto &edge) {
+                return std::none_of(out.begin(), out.end(), [&](auto &to) {
+                    return ClassifyTurn(model.Nodes(), edge.second, via, to.second) == restriction.turn;
+                });
+            }), in.end());
+        if (in.empty() || out.empty())
+            continue;
+        for (auto [in_edge, from] : in) {
+            if (restriction.only) {
+                for (int out_edge = graph.Offsets()[via]; out_edge < graph.Offsets()[via + 1]; out_edge++)
+                    if (std::none_of(out.begin(), out.end(), [out_edge](auto &allowed) { return allowed.first == out_edge; }))
+                        forbidden.push_back({in_edge, out_edge});
+            }
+            else {
+                // A restriction from a way onto itself, no_u_turn say, only
+                // forbids turning back, not carrying on along the way.
+                for (auto [out_edge, to] : out)
+                    if (restriction.from_way != restriction.to_way || to == from)
+                        forbidden.push_back({in_edge, out_edge});
+            }
+        }
+    }
+    if (forbidden.empty())
+        return;
+
+    std::sort(forbidden.begin(), forbidden.end());
+    forbidden.erase(std::unique(forbidden.begin(), forbidden.end()), forbidden.end());
+    restricted.assign((graph.EdgeCount() + 63) / 64, 0);
+    for (const Turn &turn : forbidden)
+        restricted[turn.in >> 6] |= std::uint64_t(1) << (turn.in & 63);
+}
+
+
+TurnTable::TurnTable(const GraphCache &cache, int profile, int edge_count)
+    : restricted(cache.Read<std::uint64_t>(GraphCache::ProfileSection(profile, GraphCache::TurnRestrictedEdges))),
+      forbidden(cache.Read<Turn>(GraphCache::ProfileSection(profile, GraphCache::TurnForbidden))) {
+    bool valid = restricted.empty() ? forbidden.empty() : (int)restricted.size() == (edge_count + 63) / 64;
+    for (std::size_t i = 0; valid && i < forbidden.size(); i++)
+        valid = forbidden[i].in >= 0 && forbidden[i].in < edge_count && forbidden[i].out >= 0 &&
+                forbidden[i].out < edge_count && Restricted(forbidden[i].in) && (i == 0 || forbidden[i - 1] < forbidden[i]);
+    if (!valid)
+        throw std::logic_error("graph cache holds a malformed turn table");
+}
@@ -0,0 +1,54 @@
+#ifndef TURN_TABLE_H
+#define TURN_TABLE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "graph.h"
+#include "graph_cache.h"
+#include "model.h"
+
+// The kind of turn from node `from` over `via` to node `to`: within 30
+// degrees of straight on is straight, within 10 degrees of straight back or
+// back onto the same node a u-turn, anything else left or right.
+Model::TurnKind ClassifyTurn(const Model::NodeStore &nodes, int from, int via, int to);
+
+// The turns a Model's turn restrictions forbid on one road graph, each as the
+// pair of graph edges it joins: edge `in` into the via node, then edge `out`
+// out of it. A bit per edge marks the few edges that have any turn forbidden,
+// so a search pays one bit test for every other turn, and only those few look
+// through the sorted list of pairs.
+class TurnTable {
+  public:
+    struct Turn {
+        int in;
+        int out;
+        bool operator<(const Turn &other) const { return in < other.in || (in == other.in && out < other.out); }
+        bool operator==(const Turn &other) const { return in == other.in && out == other.out; }
+    };
+
+    TurnTable() {}
+    // Restrictions whose ways do not meet at their via node on `graph`, say
+    // because the profile may not use one of the roads, are left out.
+    TurnTable(const Model &model, const Graph &graph);
+    // Restores the table of `profile` saved in a GraphCache, checking it
+    // against the number of edges of the profile's graph.
+    TurnTable(const GraphCache &cache, int profile, int edge_count);
+
+    // Whether any turn off edge `in` is forbidden.
+    bool Restricted(int in) const { return !restricted.empty() && (restricted[in >> 6] >> (in & 63) & 1); }
+    bool Allowed(int in, int out) const {
+        return !Restricted(in) || !std::binary_search(forbidden.begin(), forbidden.end(), Turn{in, out});
+    }
+    // Number of forbidden turns.
+    int Size() const { return (int)forbidden.size(); }
+    const std::vector<Turn> &Forbidden() const { return forbidden; }
+
+  private:
+    friend class GraphCache;
+
+    std::vector<std::uint64_t> restricted;
+    std::vector<Turn> forbidden;
+};
+
+#endif
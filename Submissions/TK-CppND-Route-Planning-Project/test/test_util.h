@@ -0,0 +1,22 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+#include "../src/read_file.h"
+
+static std::vector<std::byte> ReadOSMData(const std::string &path) {
+    std::vector<std::byte> osm_data;
+    auto data = ReadFile(path);
+    if( !data ) {
+        std::cout << "Failed to read OSM data." << std::endl;
+    } else {
+        osm_data = std::move(*data);
+    }
+    return osm_data;
+}
+
+#endif
@@ -0,0 +1,103 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include "test_util.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+
+static std::vector<std::byte> Bytes(const std::string &text) {
+    std::vector<std::byte> bytes(text.size());
+    std::memcpy(bytes.data(), text.data(), text.size());
+    return bytes;
+}
+
+// Length two routes have in common, over the segments between model nodes.
+static float SharedLength(const RoutePath &route, const RoutePath &other) {
+    std::vector<std::pair<int, int>> segments;
+    for (std::size_t i = 1; i < other.nodes.size(); i++)
+        segments.push_back(std::minmax(other.nodes[i - 1], other.nodes[i]));
+    float shared = 0.0f;
+    for (std::size_t i = 1; i < route.nodes.size(); i++) {
+        std::pair<int, int> segment = std::minmax(route.nodes[i - 1], route.nodes[i]);
+        if (segment.first != RoutePath::kSnappedPoint &&
+            std::find(segments.begin(), segments.end(), segment) != segments.end())
+            shared += route.distances[i] - route.distances[i - 1];
+    }
+    return shared;
+}
+
+
+// Test that both ways round a block come back, the shorter first, and nothing else.
+TEST(AlternativeRoutesTest, TestBlock) {
+    // 1 - 2 and 5 - 8 along the middle, with 2 - 3 - 4 - 5 round the north
+    // side of the block between them and 2 - 6 - 7 - 5, a little longer,
+    // round the south side.
+    RouteModel model{Bytes(
+        "<osm><bounds minlat=\"-0.0006\" maxlat=\"0.0005\" minlon=\"0\" maxlon=\"0.003\"/>"
+        "<node id=\"1\" lat=\"0\" lon=\"0\"/><node id=\"2\" lat=\"0\" lon=\"0.001\"/>"
+        "<node id=\"3\" lat=\"0.0005\" lon=\"0.001\"/><node id=\"4\" lat=\"0.0005\" lon=\"0.002\"/>"
+        "<node id=\"5\" lat=\"0\" lon=\"0.002\"/><node id=\"6\" lat=\"-0.0006\" lon=\"0.001\"/>"
+        "<node id=\"7\" lat=\"-0.0006\" lon=\"0.002\"/><node id=\"8\" lat=\"0\" lon=\"0.003\"/>"
+        "<way id=\"10\"><nd ref=\"1\"/><nd ref=\"2\"/><tag k=\"highway\" v=\"residential\"/></way>"
+        "<way id=\"11\"><nd ref=\"2\"/><nd ref=\"3\"/><nd ref=\"4\"/><nd ref=\"5\"/><tag k=\"highway\" v=\"residential\"/></way>"
+        "<way id=\"12\"><nd ref=\"2\"/><nd ref=\"6\"/><nd ref=\"7\"/><nd ref=\"5\"/><tag k=\"highway\" v=\"residential\"/></way>"
+        "<way id=\"13\"><nd ref=\"5\"/><nd ref=\"8\"/><tag k=\"highway\" v=\"residential\"/></way>"
+        "</osm>")};
+    const RouteModel::Node start = model.SNodes()[0], end = model.SNodes()[7];
+    RoutePlanner planner{model, start.x * 100, start.y * 100, end.x * 100, end.y * 100};
+    std::vector<RoutePath> routes = planner.AlternativeRoutesSearch();
+
+    ASSERT_EQ(routes.size(), 2u);
+    EXPECT_EQ(routes[0].nodes, (std::vector<int>{0, 1, 2, 3, 4, 7}));
+    EXPECT_EQ(routes[1].nodes, (std::vector<int>{0, 1, 5, 6, 4, 7}));
+    EXPECT_LT(routes[0].Length(), routes[1].Length());
+    EXPECT_EQ(planner.GetPath().nodes, routes[0].nodes);
+    EXPECT_FLOAT_EQ(planner.GetDistance(), routes[0].Length());
+
+    // A tighter stretch or a single route leaves only the shortest one.
+    AlternativeRouteOptions options;
+    options.max_stretch = 0.01f;
+    EXPECT_EQ(planner.AlternativeRoutesSearch(options).size(), 1u);
+    options = AlternativeRouteOptions{};
+    options.max_routes = 1;
+    EXPECT_EQ(planner.AlternativeRoutesSearch(options).size(), 1u);
+}
+
+
+// Test that on the sample map the routes keep to the stretch and the similarity limits.
+TEST(AlternativeRoutesTest, TestLimits) {
+    auto osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    // Walking weighs segments by their length, so the stretch holds in metres.
+    const int walking = model.FindProfile("walking");
+    SearchWorkspace workspace, backward_workspace;
+    AlternativeRouteOptions options;
+    int alternatives = 0;
+    for (RoutePlanner::Snap snap : {RoutePlanner::Snap::ToNode, RoutePlanner::Snap::ToEdge}) {
+        for (int i = 0; i < 20; i++) {
+            float sx = (i * 37) % 100, sy = (i * 53) % 100, ex = (i * 71 + 13) % 100, ey = (i * 29 + 41) % 100;
+            RoutePlanner shortest{model, workspace, sx, sy, ex, ey, snap, walking};
+            shortest.AStarSearch();
+            RoutePlanner planner{model, workspace, sx, sy, ex, ey, snap, walking};
+            std::vector<RoutePath> routes = planner.AlternativeRoutesSearch(backward_workspace, options);
+            ASSERT_FALSE(routes.empty());
+            ASSERT_LE(routes.size(), std::size_t(options.max_routes));
+            EXPECT_NEAR(routes[0].Length(), shortest.GetDistance(), 1e-3f * shortest.GetDistance());
+            for (std::size_t r = 0; r < routes.size(); r++) {
+                EXPECT_EQ(routes[r].start.x, routes[0].start.x);
+                EXPECT_EQ(routes[r].start.y, routes[0].start.y);
+                EXPECT_EQ(routes[r].end.x, routes[0].end.x);
+                EXPECT_EQ(routes[r].end.y, routes[0].end.y);
+                EXPECT_LE(routes[r].Length(), (1.0f + options.max_stretch) * routes[0].Length() * 1.001f);
+                for (std::size_t other = 0; other < r; other++)
+                    EXPECT_LE(SharedLength(routes[r], routes[other]), options.max_similarity * routes[r].Length() * 1.001f);
+            }
+            alternatives += routes.size() - 1;
+        }
+    }
+    EXPECT_GT(alternatives, 20);
+}
@@ -0,0 +1,41 @@
+#include "gtest/gtest.h"
+#include <vector>
+#include "test_util.h"
+#include "../src/batch_router.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+
+// Test that a batch on several threads answers every query like a planner of its own would.
+TEST(BatchRouterTest, TestMatchesRoutePlanner) {
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    // A few origins and destinations, each used many times, as in a table.
+    std::vector<BatchRouter::Query> queries;
+    for (int from = 0; from < 6; from++)
+        for (int to = 0; to < 6; to++)
+            queries.push_back({from * 17.0f, 100.0f - from * 11.0f, to * 13.0f + 5.0f, to * 19.0f});
+
+    for (RoutePlanner::Snap snap : {RoutePlanner::Snap::ToNode, RoutePlanner::Snap::ToEdge}) {
+        BatchRouter router{model, 3, snap};
+        std::vector<BatchRouter::Result> results = router.Route(queries, true);
+        ASSERT_EQ(results.size(), queries.size());
+        for (std::size_t i = 0; i < queries.size(); i++) {
+            const BatchRouter::Query &q = queries[i];
+            RoutePlanner planner{model, q.start_x, q.start_y, q.end_x, q.end_y, snap};
+            planner.AStarSearch();
+            ASSERT_FALSE(planner.GetPath().Empty());
+            EXPECT_FLOAT_EQ(results[i].distance, planner.GetDistance());
+            EXPECT_EQ(results[i].settled, planner.GetExpandedNodes());
+            EXPECT_EQ(results[i].path.nodes, planner.GetPath().nodes);
+            EXPECT_EQ(results[i].path.distances, planner.GetPath().distances);
+        }
+
+        // Without paths only the distances come back.
+        std::vector<BatchRouter::Result> distances = router.Route(queries);
+        for (std::size_t i = 0; i < queries.size(); i++) {
+            EXPECT_EQ(distances[i].distance, results[i].distance);
+            EXPECT_TRUE(distances[i].path.Empty());
+        }
+    }
+}
@@ -0,0 +1,169 @@
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "test_util.h"
+#include "../src/contraction_hierarchy.h"
+#include "../src/graph_cache.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+
+// Plain Dijkstra distances from one node, the reference for the hierarchy.
+static std::vector<float> Distances(const Graph &graph, int source) {
+    SearchWorkspace workspace{graph.NodeCount()};
+    std::vector<float> distances(graph.NodeCount(), SearchWorkspace::kInfinity);
+    workspace.Reach(source, 0.0f, 0.0f, -1);
+    workspace.OpenList().Push(source, 0.0f);
+    while (!workspace.OpenList().Empty()) {
+        int current = workspace.OpenList().Pop();
+        distances[current] = workspace.GValue(current);
+        workspace.Close(current);
+        for (const Graph::Edge &edge : graph.Edges(current)) {
+            float g_value = distances[current] + edge.weight;
+            if (!workspace.Reached(edge.to)) {
+                workspace.Reach(edge.to, g_value, 0.0f, current);
+                workspace.OpenList().Push(edge.to, g_value);
+            }
+            else if (!workspace.Closed(edge.to) && g_value < workspace.GValue(edge.to)) {
+                workspace.Relax(edge.to, g_value, current);
+                workspace.OpenList().DecreaseKey(edge.to, g_value);
+            }
+        }
+    }
+    return distances;
+}
+
+
+// Test that queries on a random one-way graph match Dijkstra and unpack into real edges.
+TEST(ContractionHierarchyTest, TestMatchesDijkstra) {
+    const int node_count = 300;
+    std::mt19937 random{7};
+    std::uniform_int_distribution<int> node{0, node_count - 1};
+    std::uniform_real_distribution<float> weight{1.0f, 10.0f};
+    std::vector<Graph::Arc> arcs;
+    for (int i = 0; i < node_count * 3; i++)
+        arcs.push_back({node(random), node(random), weight(random)});
+    Graph graph{node_count, arcs};
+    ContractionHierarchy hierarchy{graph};
+    EXPECT_EQ(hierarchy.NodeCount(), node_count);
+
+    SearchWorkspace forward, backward;
+    for (int source = 0; source < node_count; source += 7) {
+        std::vector<float> expected = Distances(graph, source);
+        for (int target = 0; target < node_count; target += 3) {
+            ContractionHierarchy::Result result = hierarchy.Query({{source, 0.0f}}, {{target, 0.0f}}, forward, backward);
+            if (expected[target] == SearchWorkspace::kInfinity) {
+                EXPECT_TRUE(result.nodes.empty());
+                continue;
+            }
+            EXPECT_NEAR(result.distance, expected[target], 1e-3f);
+            ASSERT_FALSE(result.nodes.empty());
+            EXPECT_EQ(result.nodes.front(), source);
+            EXPECT_EQ(result.nodes.back(), target);
+            float length = 0.0f;
+            for (std::size_t i = 1; i < result.nodes.size(); i++) {
+                float step = SearchWorkspace::kInfinity;
+                for (const Graph::Edge &edge : graph.Edges(result.nodes[i - 1]))
+                    if (edge.to == result.nodes[i])
+                        step = std::min(step, edge.weight);
+                length += step;
+            }
+            EXPECT_NEAR(length, expected[target], 1e-3f);
+        }
+    }
+}
+
+
+class ContractionHierarchyMapTest : public ::testing::Test {
+  protected:
+    void TearDown() override { std::remove(cache_file.c_str()); }
+
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    ContractionHierarchy hierarchy{model, RouteModel::kDefaultProfile};
+    std::string cache_file = "utest_contraction_hierarchy.cache";
+};
+
+
+// Test that hierarchy queries on the map find paths as short as A*.
+TEST_F(ContractionHierarchyMapTest, TestMatchesAStar) {
+    SearchWorkspace workspace, backward_workspace;
+    for (RoutePlanner::Snap snap : {RoutePlanner::Snap::ToNode, RoutePlanner::Snap::ToEdge}) {
+        for (int i = 0; i < 40; i++) {
+            float sx = i * 7 % 100, sy = i * 13 % 100, ex = i * 31 % 100, ey = i * 53 % 100;
+            RoutePlanner a_star{model, workspace, sx, sy, ex, ey, snap};
+            a_star.AStarSearch();
+            RoutePlanner contracted{model, workspace, sx, sy, ex, ey, snap};
+            contracted.ContractionHierarchySearch(hierarchy, backward_workspace);
+
+            const RoutePath &path = contracted.GetPath();
+            ASSERT_EQ(path.Empty(), a_star.GetPath().Empty());
+            if (path.Empty())
+                continue;
+            float expected = a_star.GetDistance();
+            EXPECT_NEAR(contracted.GetDistance(), expected, 1e-4f * expected + 1e-3f);
+            EXPECT_EQ(path.nodes.front(), a_star.GetPath().nodes.front());
+            EXPECT_EQ(path.end.x, a_star.GetPath().end.x);
+            EXPECT_EQ(path.end.y, a_star.GetPath().end.y);
+            // Consecutive nodes are joined by road segments.
+            for (std::size_t j = 1; j < path.Size(); j++) {
+                if (path.nodes[j - 1] == RoutePath::kSnappedPoint || path.nodes[j] == RoutePath::kSnappedPoint)
+                    continue;
+                bool joined = false;
+                for (const Graph::Edge &edge : model.Neighbors(path.nodes[j - 1]))
+                    joined = joined || edge.to == path.nodes[j];
+                EXPECT_TRUE(joined);
+            }
+        }
+    }
+}
+
+
+// Test that a hierarchy stored in the graph cache comes back unchanged.
+TEST_F(ContractionHierarchyMapTest, TestCacheRoundTrip) {
+    std::uint64_t checksum = GraphCache::Checksum(osm_data.data(), osm_data.size());
+    ASSERT_TRUE(GraphCache::Save(cache_file, model, checksum));
+    auto cache = GraphCache::Open(cache_file, checksum);
+    ASSERT_TRUE(cache);
+    EXPECT_FALSE(cache->HasHierarchy());
+    EXPECT_THROW(ContractionHierarchy{*cache}, std::logic_error);
+
+    ASSERT_TRUE(GraphCache::Save(cache_file, model, checksum, &hierarchy));
+    cache = GraphCache::Open(cache_file, checksum);
+    ASSERT_TRUE(cache);
+    ASSERT_TRUE(cache->HasHierarchy());
+    ContractionHierarchy loaded{*cache};
+    EXPECT_EQ(loaded.Ranks(), hierarchy.Ranks());
+    EXPECT_EQ(loaded.Offsets(), hierarchy.Offsets());
+    ASSERT_EQ(loaded.EdgeCount(), hierarchy.EdgeCount());
+    EXPECT_EQ(loaded.ShortcutCount(), hierarchy.ShortcutCount());
+
+    RouteModel loaded_model{*cache};
+    RoutePlanner original{model, 10, 10, 90, 90};
+    original.ContractionHierarchySearch(hierarchy);
+    RoutePlanner restored{loaded_model, 10, 10, 90, 90};
+    restored.ContractionHierarchySearch(loaded);
+    EXPECT_EQ(restored.GetDistance(), original.GetDistance());
+    EXPECT_EQ(restored.GetPath().nodes, original.GetPath().nodes);
+}
+
+
+// Test that a hierarchy is only used for the profile and graph version it was built for.
+TEST_F(ContractionHierarchyMapTest, TestRejectsOtherGraphs) {
+    const int walking = model.FindProfile("walking");
+    RoutePlanner other_profile{model, 10, 10, 90, 90, RoutePlanner::Snap::ToNode, walking};
+    EXPECT_THROW(other_profile.ContractionHierarchySearch(hierarchy), std::logic_error);
+    ContractionHierarchy bare{model.RoadGraph()};
+    RoutePlanner planner{model, 10, 10, 90, 90};
+    EXPECT_THROW(planner.ContractionHierarchySearch(bare), std::logic_error);
+
+    model.SetProfile(RouteModel::kDefaultProfile, model.Profile(RouteModel::kDefaultProfile));
+    RoutePlanner rebuilt{model, 10, 10, 90, 90};
+    EXPECT_THROW(rebuilt.ContractionHierarchySearch(hierarchy), std::logic_error);
+    std::uint64_t checksum = GraphCache::Checksum(osm_data.data(), osm_data.size());
+    EXPECT_FALSE(GraphCache::Save(cache_file, model, checksum, &hierarchy));
+    ContractionHierarchy current{model, RouteModel::kDefaultProfile};
+    rebuilt.ContractionHierarchySearch(current);
+    EXPECT_FALSE(rebuilt.GetPath().Empty());
+}
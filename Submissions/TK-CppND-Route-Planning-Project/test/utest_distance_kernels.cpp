@@ -0,0 +1,91 @@
+#include "gtest/gtest.h"
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+#include "../src/distance_kernels.h"
+
+
+class DistanceKernelsTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        std::mt19937 rng{7};
+        std::uniform_real_distribution<float> coordinate{0.0f, 1.0f};
+        for (int i = 0; i < 100; i++) {
+            xs.push_back(coordinate(rng));
+            ys.push_back(coordinate(rng));
+        }
+    }
+    void TearDown() override { SelectSimdLevel(SupportedSimdLevel()); }
+
+    // Every level this machine can run, the scalar one first.
+    std::vector<SimdLevel> Levels() const {
+        std::vector<SimdLevel> levels;
+        for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2})
+            if (level <= SupportedSimdLevel())
+                levels.push_back(level);
+        return levels;
+    }
+
+    std::vector<float> xs;
+    std::vector<float> ys;
+    float x = 0.4f;
+    float y = 0.7f;
+};
+
+
+// Test that the kernels are picked at the widest level and that wider ones are clamped.
+TEST_F(DistanceKernelsTest, TestSelectSimdLevel) {
+    EXPECT_EQ(ActiveSimdLevel(), SupportedSimdLevel());
+    SelectSimdLevel(SimdLevel::Scalar);
+    EXPECT_EQ(ActiveSimdLevel(), SimdLevel::Scalar);
+    SelectSimdLevel(SimdLevel::AVX2);
+    EXPECT_EQ(ActiveSimdLevel(), SupportedSimdLevel());
+}
+
+
+// Test that every level returns the distances a plain loop computes, for batch sizes around the vector widths.
+TEST_F(DistanceKernelsTest, TestDistancesMatchAtEveryLevel) {
+    std::vector<int> indices;
+    for (int i = 0; i < 20; i++)
+        indices.push_back((i * 37) % (int)xs.size());
+    for (SimdLevel level : Levels()) {
+        SelectSimdLevel(level);
+        for (int count = 0; count <= 20; count++) {
+            std::vector<float> gathered(count + 1, -1.0f), squared(count + 1, -1.0f);
+            GatherDistances(xs.data(), ys.data(), indices.data(), count, x, y, gathered.data());
+            SquaredDistances(xs.data() + 3, ys.data() + 3, count, x, y, squared.data());
+            for (int i = 0; i < count; i++) {
+                float dx = xs[indices[i]] - x, dy = ys[indices[i]] - y;
+                EXPECT_EQ(gathered[i], std::sqrt(dx * dx + dy * dy)) << SimdLevelName(level) << " " << count;
+                dx = xs[3 + i] - x, dy = ys[3 + i] - y;
+                EXPECT_EQ(squared[i], dx * dx + dy * dy) << SimdLevelName(level) << " " << count;
+            }
+            // Nothing is written past the batch.
+            EXPECT_EQ(gathered[count], -1.0f);
+            EXPECT_EQ(squared[count], -1.0f);
+        }
+    }
+}
+
+
+// Test that NearestPoint finds the closest point, the first one on ties, at every level.
+TEST_F(DistanceKernelsTest, TestNearestPoint) {
+    // Equally close copies of the same point at 5 and 13.
+    xs[5] = xs[13] = x + 1e-3f;
+    ys[5] = ys[13] = y;
+    for (SimdLevel level : Levels()) {
+        SelectSimdLevel(level);
+        float d2 = 0.0f;
+        EXPECT_EQ(NearestPoint(xs.data(), ys.data(), 0, x, y, d2), -1);
+        EXPECT_EQ(d2, std::numeric_limits<float>::infinity());
+        for (int count = 1; count <= 20; count++) {
+            int expected = 0;
+            for (int i = 1; i < count; i++)
+                if (std::hypot(xs[i] - x, ys[i] - y) < std::hypot(xs[expected] - x, ys[expected] - y))
+                    expected = i;
+            EXPECT_EQ(NearestPoint(xs.data(), ys.data(), count, x, y, d2), expected) << SimdLevelName(level);
+            EXPECT_FLOAT_EQ(d2, std::pow(xs[expected] - x, 2.0f) + std::pow(ys[expected] - y, 2.0f));
+        }
+    }
+}
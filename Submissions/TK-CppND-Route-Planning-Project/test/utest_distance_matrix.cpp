@@ -0,0 +1,43 @@
+#include "gtest/gtest.h"
+#include <vector>
+#include "test_util.h"
+#include "../src/distance_matrix.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+
+// Test that every entry of the matrix matches a point query between the same points.
+TEST(DistanceMatrixTest, TestMatchesAStar) {
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    std::vector<DistanceMatrix::Point> sources, targets;
+    for (int i = 0; i < 5; i++)
+        sources.push_back({i * 23.0f + 3.0f, 100.0f - i * 17.0f});
+    for (int i = 0; i < 7; i++)
+        targets.push_back({i * 11.0f + 20.0f, i * 13.0f + 1.0f});
+    // A target equal to a source lies at distance 0.
+    targets.push_back(sources[2]);
+
+    for (RoutePlanner::Snap snap : {RoutePlanner::Snap::ToNode, RoutePlanner::Snap::ToEdge}) {
+        DistanceMatrix matrix{model, 2, snap};
+        DistanceMatrix::Table table = matrix.Compute(sources, targets);
+        ASSERT_EQ(table.rows, (int)sources.size());
+        ASSERT_EQ(table.columns, (int)targets.size());
+        ASSERT_EQ(table.values.size(), sources.size() * targets.size());
+        EXPECT_GT(matrix.SettledNodes(), 0);
+        for (int row = 0; row < table.rows; row++)
+            for (int column = 0; column < table.columns; column++) {
+                RoutePlanner planner{model, sources[row].x, sources[row].y, targets[column].x, targets[column].y, snap};
+                planner.AStarSearch();
+                ASSERT_FALSE(planner.GetPath().Empty());
+                float expected = planner.GetDistance();
+                EXPECT_NEAR(table.At(row, column), expected, 1e-4f * expected + 1e-2f);
+            }
+        EXPECT_EQ(table.At(2, table.columns - 1), 0.0f);
+    }
+
+    DistanceMatrix::Table empty = DistanceMatrix{model, 1}.Compute(sources, {});
+    EXPECT_EQ(empty.rows, (int)sources.size());
+    EXPECT_EQ(empty.columns, 0);
+    EXPECT_TRUE(empty.values.empty());
+}
@@ -0,0 +1,143 @@
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include "test_util.h"
+#include "../src/graph_cache.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+
+class GraphCacheTest : public ::testing::Test {
+  protected:
+    void TearDown() override { std::remove(cache_file.c_str()); }
+
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    std::uint64_t checksum = GraphCache::Checksum(osm_data.data(), osm_data.size());
+    std::string cache_file = "utest_graph_cache.cache";
+};
+
+
+static std::vector<int> Indices(Model::IndexRange range) {
+    return {range.begin(), range.end()};
+}
+
+static void ExpectSameMultipolygons(const Model &model_a, const std::vector<Model::Multipolygon> &a,
+                                    const Model &model_b, const std::vector<Model::Multipolygon> &b) {
+    ASSERT_EQ(a.size(), b.size());
+    for (std::size_t i = 0; i < a.size(); i++) {
+        EXPECT_EQ(Indices(model_a.Outer(a[i])), Indices(model_b.Outer(b[i])));
+        EXPECT_EQ(Indices(model_a.Inner(a[i])), Indices(model_b.Inner(b[i])));
+    }
+}
+
+template <typename T>
+static std::vector<Model::Multipolygon> Slice(const std::vector<T> &multipolygons) {
+    return {multipolygons.begin(), multipolygons.end()};
+}
+
+
+// Test that a model restored from the cache matches the parsed one and routes the same way.
+TEST_F(GraphCacheTest, TestRoundTrip) {
+    ASSERT_TRUE(GraphCache::Save(cache_file, model, checksum));
+    auto cache = GraphCache::Open(cache_file, checksum);
+    ASSERT_TRUE(cache);
+    RouteModel loaded{*cache};
+
+    EXPECT_EQ(loaded.MetricScale(), model.MetricScale());
+    ASSERT_EQ(loaded.Nodes().size(), model.Nodes().size());
+    for (std::size_t i = 0; i < model.Nodes().size(); i++) {
+        EXPECT_EQ(loaded.Nodes()[i].x, model.Nodes()[i].x);
+        EXPECT_EQ(loaded.Nodes()[i].y, model.Nodes()[i].y);
+    }
+    ASSERT_EQ(loaded.Ways().size(), model.Ways().size());
+    for (std::size_t i = 0; i < model.Ways().size(); i++)
+        EXPECT_EQ(Indices(loaded.WayNodes(i)), Indices(model.WayNodes(i)));
+    ASSERT_EQ(loaded.Roads().size(), model.Roads().size());
+    for (std::size_t i = 0; i < model.Roads().size(); i++) {
+        EXPECT_EQ(loaded.Roads()[i].way, model.Roads()[i].way);
+        EXPECT_EQ(loaded.Roads()[i].type, model.Roads()[i].type);
+    }
+    EXPECT_EQ(loaded.Railways().size(), model.Railways().size());
+    ExpectSameMultipolygons(loaded, Slice(loaded.Buildings()), model, Slice(model.Buildings()));
+    ExpectSameMultipolygons(loaded, Slice(loaded.Leisures()), model, Slice(model.Leisures()));
+    ExpectSameMultipolygons(loaded, Slice(loaded.Waters()), model, Slice(model.Waters()));
+    ExpectSameMultipolygons(loaded, Slice(loaded.Landuses()), model, Slice(model.Landuses()));
+    for (std::size_t i = 0; i < model.Landuses().size(); i++)
+        EXPECT_EQ(loaded.Landuses()[i].type, model.Landuses()[i].type);
+    // The arrays read in place keep the mapping alive without the cache.
+    cache.reset();
+    ASSERT_EQ(loaded.ProfileCount(), model.ProfileCount());
+    for (int profile = 0; profile < model.ProfileCount(); profile++) {
+        EXPECT_TRUE(loaded.RoadGraph(profile).Offsets().Borrowed());
+        EXPECT_TRUE(loaded.RoadGraph(profile).EdgeArray().Borrowed());
+        EXPECT_FALSE(model.RoadGraph(profile).EdgeArray().Borrowed());
+        EXPECT_EQ(loaded.Profile(profile).name, model.Profile(profile).name);
+        EXPECT_EQ(loaded.RoadGraph(profile).Offsets(), model.RoadGraph(profile).Offsets());
+        EXPECT_EQ(loaded.RoadGraph(profile).EdgeCount(), model.RoadGraph(profile).EdgeCount());
+
+        // The restored node, segment and turn indexes answer as the built ones.
+        for (RoutePlanner::Snap snap : {RoutePlanner::Snap::ToNode, RoutePlanner::Snap::ToEdge}) {
+            RoutePlanner original{model, 10, 10, 90, 90, snap, profile};
+            RoutePlanner restored{loaded, 10, 10, 90, 90, snap, profile};
+            original.AStarSearch();
+            restored.AStarSearch();
+            EXPECT_EQ(restored.GetDistance(), original.GetDistance());
+            EXPECT_EQ(restored.GetPath().nodes, original.GetPath().nodes);
+        }
+        RoutePlanner original{model, 20, 80, 70, 30, RoutePlanner::Snap::ToEdge, profile};
+        RoutePlanner restored{loaded, 20, 80, 70, 30, RoutePlanner::Snap::ToEdge, profile};
+        original.EdgeBasedAStarSearch();
+        restored.EdgeBasedAStarSearch();
+        EXPECT_EQ(restored.GetDistance(), original.GetDistance());
+        EXPECT_EQ(restored.GetPath().nodes, original.GetPath().nodes);
+    }
+}
+
+
+// Test that a cache built from different OSM data, or a damaged one, is not used.
+TEST_F(GraphCacheTest, TestInvalidation) {
+    ASSERT_TRUE(GraphCache::Save(cache_file, model, checksum));
+    EXPECT_FALSE(GraphCache::Open(cache_file, checksum + 1));
+    EXPECT_FALSE(GraphCache::Open("missing.cache", checksum));
+
+    auto contents = *ReadFile(cache_file);
+    {
+        // Truncated in the middle of the sections.
+        std::ofstream os{cache_file, std::ios::binary | std::ios::trunc};
+        os.write((const char *)contents.data(), contents.size() / 2);
+    }
+    EXPECT_FALSE(GraphCache::Open(cache_file, checksum));
+    {
+        // Wrong magic.
+        contents[0] = std::byte{'X'};
+        std::ofstream os{cache_file, std::ios::binary | std::ios::trunc};
+        os.write((const char *)contents.data(), contents.size());
+    }
+    EXPECT_FALSE(GraphCache::Open(cache_file, checksum));
+}
+
+
+// Test that a cache built with routing profiles other than the defaults is not used.
+TEST_F(GraphCacheTest, TestProfileInvalidation) {
+    RoutingProfile walking = model.Profile(model.FindProfile("walking"));
+    walking.speeds[Model::Road::Footway] = 1.0f;
+    model.SetProfile(model.FindProfile("walking"), walking);
+    ASSERT_TRUE(GraphCache::Save(cache_file, model, checksum));
+    EXPECT_FALSE(GraphCache::Open(cache_file, checksum));
+}
+
+
+// Test that the checksum changes with a single flipped byte.
+TEST(GraphCacheChecksumTest, TestChecksum) {
+    std::vector<unsigned char> data(1000);
+    for (std::size_t i = 0; i < data.size(); i++)
+        data[i] = (unsigned char)(i * 31);
+    auto checksum = GraphCache::Checksum(data.data(), data.size());
+    EXPECT_EQ(checksum, GraphCache::Checksum(data.data(), data.size()));
+    for (int size : {0, 3, 7, 31, 999})
+        EXPECT_NE(checksum, GraphCache::Checksum(data.data(), size));
+    data[500] ^= 1;
+    EXPECT_NE(checksum, GraphCache::Checksum(data.data(), data.size()));
+    EXPECT_EQ(GraphCache::Checksum(nullptr, 0), 0xEF46DB3751D8E999ULL);
+}
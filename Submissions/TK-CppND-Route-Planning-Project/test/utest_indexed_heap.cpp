@@ -0,0 +1,45 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "../src/indexed_heap.h"
+
+
+TEST(IndexedHeapTest, TestPopsInKeyOrder) {
+    std::mt19937 rng{7};
+    std::uniform_real_distribution<float> key{0.0f, 100.0f};
+    std::vector<float> keys(1000);
+    IndexedHeap<4> heap{(int)keys.size()};
+    for (int id = 0; id < (int)keys.size(); id++) {
+        keys[id] = key(rng);
+        heap.Push(id, keys[id]);
+    }
+
+    std::vector<float> popped;
+    while (!heap.Empty())
+        popped.push_back(keys[heap.Pop()]);
+    EXPECT_EQ(popped.size(), keys.size());
+    EXPECT_TRUE(std::is_sorted(popped.begin(), popped.end()));
+}
+
+
+TEST(IndexedHeapTest, TestDecreaseKey) {
+    IndexedHeap<2> heap{4};
+    heap.Push(0, 5.0f);
+    heap.Push(1, 3.0f);
+    heap.Push(2, 4.0f);
+
+    heap.DecreaseKey(0, 1.0f);
+    EXPECT_EQ(heap.Top(), 0);
+    // A larger key must not move the entry.
+    heap.DecreaseKey(2, 10.0f);
+    EXPECT_FLOAT_EQ(heap.Key(2), 4.0f);
+
+    heap.PushOrDecrease(3, 2.0f);
+    heap.PushOrDecrease(2, 0.5f);
+    std::vector<int> order;
+    while (!heap.Empty())
+        order.push_back(heap.Pop());
+    EXPECT_EQ(order, (std::vector<int>{2, 0, 3, 1}));
+    EXPECT_FALSE(heap.Contains(2));
+}
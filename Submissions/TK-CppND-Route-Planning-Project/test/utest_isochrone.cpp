@@ -0,0 +1,60 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "test_util.h"
+#include "../src/isochrone.h"
+#include "../src/route_model.h"
+
+
+// Test that the bounded search returns exactly the nodes an unbounded one finds within the budget.
+TEST(IsochroneTest, TestReachableNodes) {
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    for (RoutePlanner::Snap snap : {RoutePlanner::Snap::ToNode, RoutePlanner::Snap::ToEdge}) {
+        Isochrone all{model, 40.0f, 60.0f, SearchWorkspace::kInfinity, snap};
+        ASSERT_FALSE(all.Nodes().empty());
+        const float budget = all.Costs()[all.Costs().size() / 4];
+        SearchWorkspace workspace;
+        Isochrone bounded{model, workspace, 40.0f, 60.0f, budget, snap};
+
+        std::vector<int> expected;
+        for (std::size_t i = 0; i < all.Nodes().size(); i++)
+            if (all.Costs()[i] <= budget)
+                expected.push_back(all.Nodes()[i]);
+        std::vector<int> found = bounded.Nodes();
+        std::sort(expected.begin(), expected.end());
+        std::sort(found.begin(), found.end());
+        EXPECT_EQ(found, expected);
+        for (std::size_t i = 1; i < bounded.Costs().size(); i++)
+            EXPECT_LE(bounded.Costs()[i - 1], bounded.Costs()[i]);
+    }
+}
+
+
+// Test that the boundary circles the start counter-clockwise without leaving the budget.
+TEST(IsochroneTest, TestBoundary) {
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    const float budget = 400.0f;
+    Isochrone isochrone{model, 50.0f, 50.0f, budget};
+    const std::vector<Model::Node> &boundary = isochrone.Boundary();
+    ASSERT_GE(boundary.size(), 3u);
+    const Model::Node &origin = isochrone.Origin();
+    double previous_angle = -10.0, area = 0.0;
+    for (std::size_t i = 0; i < boundary.size(); i++) {
+        const double dx = boundary[i].x - origin.x, dy = boundary[i].y - origin.y;
+        // Roads are never shorter than the straight line.
+        EXPECT_LE(std::hypot(dx, dy) * model.MetricScale(), budget * 1.0001);
+        const double angle = std::atan2(dy, dx);
+        EXPECT_GT(angle, previous_angle);
+        previous_angle = angle;
+        const Model::Node &next = boundary[(i + 1) % boundary.size()];
+        area += boundary[i].x * next.y - next.x * boundary[i].y;
+    }
+    EXPECT_GT(area, 0.0);
+
+    // Nothing is reachable with no budget but the start itself.
+    Isochrone none{model, 50.0f, 50.0f, 0.0f};
+    EXPECT_TRUE(none.Boundary().empty());
+}
@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+#include <random>
+#include <vector>
+#include "test_util.h"
+#include "../src/landmarks.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+
+// Plain Dijkstra distances from one node, the reference for the bounds.
+static std::vector<float> Distances(const Graph &graph, int source) {
+    SearchWorkspace workspace{graph.NodeCount()};
+    std::vector<float> distances(graph.NodeCount(), SearchWorkspace::kInfinity);
+    workspace.Reach(source, 0.0f, 0.0f, -1);
+    workspace.OpenList().Push(source, 0.0f);
+    while (!workspace.OpenList().Empty()) {
+        int current = workspace.OpenList().Pop();
+        distances[current] = workspace.GValue(current);
+        workspace.Close(current);
+        for (const Graph::Edge &edge : graph.Edges(current)) {
+            float g_value = distances[current] + edge.weight;
+            if (!workspace.Reached(edge.to)) {
+                workspace.Reach(edge.to, g_value, 0.0f, current);
+                workspace.OpenList().Push(edge.to, g_value);
+            }
+            else if (!workspace.Closed(edge.to) && g_value < workspace.GValue(edge.to)) {
+                workspace.Relax(edge.to, g_value, current);
+                workspace.OpenList().DecreaseKey(edge.to, g_value);
+            }
+        }
+    }
+    return distances;
+}
+
+
+// Test that both selection strategies pick distinct landmarks whose bounds never exceed the true distance.
+TEST(LandmarksTest, TestLowerBounds) {
+    const int node_count = 200;
+    std::mt19937 random{3};
+    std::uniform_int_distribution<int> node{0, node_count - 1};
+    std::uniform_real_distribution<float> weight{1.0f, 10.0f};
+    std::vector<Graph::Arc> arcs;
+    for (int i = 0; i < node_count * 3; i++)
+        arcs.push_back({node(random), node(random), weight(random)});
+    Graph graph{node_count, arcs};
+
+    for (Landmarks::Selection selection : {Landmarks::Selection::Farthest, Landmarks::Selection::Avoid}) {
+        Landmarks landmarks{graph, 8, selection};
+        ASSERT_EQ(landmarks.Count(), 8);
+        std::vector<int> chosen = landmarks.Nodes();
+        std::sort(chosen.begin(), chosen.end());
+        EXPECT_EQ(std::unique(chosen.begin(), chosen.end()), chosen.end());
+
+        for (int source = 0; source < node_count; source += 5) {
+            std::vector<float> expected = Distances(graph, source);
+            for (int target = 0; target < node_count; target++)
+                EXPECT_LE(landmarks.LowerBound(source, target), expected[target] + 1e-3f);
+        }
+        // The bound is exact from a landmark.
+        int landmark = landmarks.Nodes().front();
+        std::vector<float> expected = Distances(graph, landmark);
+        for (int target = 0; target < node_count; target++) {
+            if (expected[target] != SearchWorkspace::kInfinity) {
+                EXPECT_NEAR(landmarks.LowerBound(landmark, target), expected[target], 1e-3f);
+            }
+        }
+    }
+}
+
+
+// Test that A* with landmarks finds paths as short as plain A* while settling fewer nodes.
+TEST(LandmarksTest, TestAStarWithLandmarks) {
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    Landmarks landmarks{model, RouteModel::kDefaultProfile, 8};
+    SearchWorkspace workspace;
+    long plain_settled = 0, landmark_settled = 0;
+    for (RoutePlanner::Snap snap : {RoutePlanner::Snap::ToNode, RoutePlanner::Snap::ToEdge}) {
+        for (int i = 0; i < 40; i++) {
+            float sx = i * 7 % 100, sy = i * 13 % 100, ex = i * 31 % 100, ey = i * 53 % 100;
+            RoutePlanner plain{model, workspace, sx, sy, ex, ey, snap};
+            plain.AStarSearch();
+            RoutePlanner guided{model, workspace, sx, sy, ex, ey, snap};
+            guided.UseLandmarks(landmarks);
+            guided.AStarSearch();
+
+            ASSERT_EQ(guided.GetPath().Empty(), plain.GetPath().Empty());
+            float expected = plain.GetDistance();
+            EXPECT_NEAR(guided.GetDistance(), expected, 1e-4f * expected + 1e-3f);
+            plain_settled += plain.GetExpandedNodes();
+            landmark_settled += guided.GetExpandedNodes();
+        }
+    }
+    EXPECT_LT(landmark_settled, plain_settled);
+}
+
+
+// Test that landmarks are only used for the profile and graph version they were computed for.
+TEST(LandmarksTest, TestRejectsOtherGraphs) {
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    const int walking = model.FindProfile("walking"), fastest = model.FindProfile("car-fastest");
+    Landmarks car{model, RouteModel::kDefaultProfile, 4};
+    Landmarks bare{model.RoadGraph(), 4};
+    RoutePlanner planner{model, 10, 10, 90, 90};
+    EXPECT_NO_THROW(planner.UseLandmarks(car));
+    EXPECT_THROW(planner.UseLandmarks(bare), std::logic_error);
+    for (int profile : {walking, fastest}) {
+        RoutePlanner other{model, 10, 10, 90, 90, RoutePlanner::Snap::ToNode, profile};
+        EXPECT_THROW(other.UseLandmarks(car), std::logic_error);
+    }
+
+    model.SetProfile(RouteModel::kDefaultProfile, model.Profile(RouteModel::kDefaultProfile));
+    RoutePlanner rebuilt{model, 10, 10, 90, 90};
+    EXPECT_THROW(rebuilt.UseLandmarks(car), std::logic_error);
+    Landmarks current{model, RouteModel::kDefaultProfile, 4};
+    EXPECT_NO_THROW(rebuilt.UseLandmarks(current));
+}
@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include "../src/model.h"
+
+
+// OSM document with `node_count` nodes on a circle and one water relation whose
+// outer members are the ways listed in `ways`, given as node id sequences.
+static std::vector<std::byte> WaterRelation(int node_count, const std::vector<std::vector<int>> &ways) {
+    std::string xml = "<osm><bounds minlat=\"0\" maxlat=\"0.01\" minlon=\"0\" maxlon=\"0.01\"/>";
+    for (int i = 0; i < node_count; i++) {
+        double angle = 2 * M_PI * i / node_count;
+        xml += "<node id=\"" + std::to_string(i + 1) + "\" lat=\"" + std::to_string(0.005 + 0.004 * std::sin(angle)) +
+               "\" lon=\"" + std::to_string(0.005 + 0.004 * std::cos(angle)) + "\"/>";
+    }
+    for (std::size_t w = 0; w < ways.size(); w++) {
+        xml += "<way id=\"" + std::to_string(w + 1) + "\">";
+        for (int node : ways[w])
+            xml += "<nd ref=\"" + std::to_string(node + 1) + "\"/>";
+        xml += "</way>";
+    }
+    xml += "<relation id=\"1\">";
+    for (std::size_t w = 0; w < ways.size(); w++)
+        xml += "<member type=\"way\" ref=\"" + std::to_string(w + 1) + "\" role=\"outer\"/>";
+    xml += "<tag k=\"natural\" v=\"water\"/></relation></osm>";
+
+    std::vector<std::byte> bytes(xml.size());
+    std::memcpy(bytes.data(), xml.data(), xml.size());
+    return bytes;
+}
+
+// Cuts the closed loop 0, 1, ..., node_count - 1, 0 into `segments` ways of
+// random length, shuffled and randomly reversed.
+static std::vector<std::vector<int>> ShuffledLoop(int node_count, int segments, std::mt19937 &rng) {
+    std::vector<int> cuts{0, node_count};
+    std::vector<int> positions(node_count - 1);
+    for (int i = 0; i < node_count - 1; i++)
+        positions[i] = i + 1;
+    std::shuffle(positions.begin(), positions.end(), rng);
+    cuts.insert(cuts.end(), positions.begin(), positions.begin() + segments - 1);
+    std::sort(cuts.begin(), cuts.end());
+
+    std::vector<std::vector<int>> ways;
+    for (std::size_t i = 1; i < cuts.size(); i++) {
+        std::vector<int> way;
+        for (int node = cuts[i - 1]; node <= cuts[i]; node++)
+            way.push_back(node % node_count);
+        if (rng() % 2)
+            std::reverse(way.begin(), way.end());
+        ways.push_back(way);
+    }
+    std::shuffle(ways.begin(), ways.end(), rng);
+    return ways;
+}
+
+static bool IsRing(const Model &model, int way, int node_count) {
+    const Model::IndexRange nodes = model.WayNodes(way);
+    std::vector<int> distinct(nodes.begin(), nodes.end() - 1);
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+    return nodes.front() == nodes.back() && distinct.size() == std::size_t(node_count);
+}
+
+
+// Test that thousands of shuffled, randomly oriented segments are joined into one ring.
+TEST(ModelRingTest, TestLargeShuffledRing) {
+    std::mt19937 rng{7};
+    const int node_count = 20000, segments = 5000;
+    Model model{WaterRelation(node_count, ShuffledLoop(node_count, segments, rng))};
+
+    ASSERT_EQ(model.Waters().size(), 1u);
+    ASSERT_EQ(model.Outer(model.Waters()[0]).size(), 1u);
+    EXPECT_TRUE(IsRing(model, model.Outer(model.Waters()[0])[0], node_count));
+    EXPECT_TRUE(model.UnclosedRings().empty());
+}
+
+
+// Test that a ring with a gap is reported while the other rings of the relation are kept.
+TEST(ModelRingTest, TestUnclosedRingIsReported) {
+    std::mt19937 rng{11};
+    const int node_count = 3000;
+    auto ways = ShuffledLoop(node_count / 2, 1000, rng);
+    // A second loop over the other half of the nodes, missing one segment.
+    std::vector<std::vector<int>> broken;
+    for (int i = node_count / 2; i + 1 < node_count; i++)
+        broken.push_back({i, i + 1});
+    std::shuffle(broken.begin(), broken.end(), rng);
+    ways.insert(ways.end(), broken.begin(), broken.end());
+    Model model{WaterRelation(node_count, ways)};
+
+    ASSERT_EQ(model.Waters().size(), 1u);
+    ASSERT_EQ(model.Outer(model.Waters()[0]).size(), 1u);
+    EXPECT_TRUE(IsRing(model, model.Outer(model.Waters()[0])[0], node_count / 2));
+
+    std::vector<int> reported;
+    for (const Model::UnclosedRing &ring : model.UnclosedRings()) {
+        EXPECT_TRUE(ring.water);
+        EXPECT_EQ(ring.multipolygon, 0);
+        EXPECT_NE(ring.nodes.front(), ring.nodes.back());
+        reported.insert(reported.end(), ring.nodes.begin(), ring.nodes.end());
+    }
+    std::sort(reported.begin(), reported.end());
+    reported.erase(std::unique(reported.begin(), reported.end()), reported.end());
+    EXPECT_EQ(reported.size(), std::size_t(node_count / 2));
+}
@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include "test_util.h"
+#include "../src/graph_cache.h"
+#include "../src/node_order.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+
+class NodeOrderTest : public ::testing::Test {
+  protected:
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+};
+
+
+// Test that both orders are permutations of all nodes.
+TEST_F(NodeOrderTest, TestOrdersArePermutations) {
+    for (std::vector<int> order : {HilbertOrder(model.Nodes()), BreadthFirstOrder(model)}) {
+        ASSERT_EQ(order.size(), model.Nodes().size());
+        std::sort(order.begin(), order.end());
+        for (int i = 0; i < (int)order.size(); i++)
+            ASSERT_EQ(order[i], i);
+    }
+}
+
+
+// Test that a renumbered model keeps every way and node in place under its file index.
+TEST_F(NodeOrderTest, TestRenumberedModelMatches) {
+    for (Model::NodeOrder order : {Model::NodeOrder::Hilbert, Model::NodeOrder::BreadthFirst}) {
+        RouteModel renumbered{osm_data, 0, order};
+        EXPECT_EQ(renumbered.Order(), order);
+        ASSERT_EQ(renumbered.Nodes().size(), model.Nodes().size());
+        for (int node = 0; node < (int)renumbered.Nodes().size(); node++) {
+            int file_index = renumbered.FileIndex(node);
+            ASSERT_EQ(renumbered.NodeAtFileIndex(file_index), node);
+            EXPECT_EQ(renumbered.Nodes()[node].x, model.Nodes()[file_index].x);
+            EXPECT_EQ(renumbered.Nodes()[node].y, model.Nodes()[file_index].y);
+        }
+        ASSERT_EQ(renumbered.Ways().size(), model.Ways().size());
+        for (int way = 0; way < (int)model.Ways().size(); way++) {
+            Model::IndexRange a = model.WayNodes(way), b = renumbered.WayNodes(way);
+            ASSERT_EQ(a.size(), b.size());
+            for (std::size_t i = 0; i < a.size(); i++)
+                EXPECT_EQ(renumbered.FileIndex(b[i]), a[i]);
+        }
+    }
+}
+
+
+// Test that routes are as long in every order and pass the same nodes by file index.
+TEST_F(NodeOrderTest, TestRoutesDoNotDependOnOrder) {
+    RouteModel renumbered{osm_data, 0, Model::NodeOrder::BreadthFirst};
+    for (auto [start_x, start_y, end_x, end_y] : {std::array<float, 4>{10, 10, 90, 90}, std::array<float, 4>{80, 15, 20, 70}}) {
+        RoutePlanner a{model, start_x, start_y, end_x, end_y, RoutePlanner::Snap::ToNode};
+        RoutePlanner b{renumbered, start_x, start_y, end_x, end_y, RoutePlanner::Snap::ToNode};
+        a.AStarSearch();
+        b.AStarSearch();
+        EXPECT_NEAR(b.GetDistance(), a.GetDistance(), 1e-3f * a.GetDistance());
+        ASSERT_FALSE(a.GetPath().Empty());
+        EXPECT_EQ(renumbered.FileIndex(b.GetPath().nodes.front()), a.GetPath().nodes.front());
+        EXPECT_EQ(renumbered.FileIndex(b.GetPath().nodes.back()), a.GetPath().nodes.back());
+    }
+}
+
+
+// Test that the graph cache restores the order and the permutation.
+TEST_F(NodeOrderTest, TestCacheKeepsOrder) {
+    const std::string cache_file = "utest_node_order.cache";
+    RouteModel renumbered{osm_data, 0, Model::NodeOrder::Hilbert};
+    std::uint64_t checksum = GraphCache::Checksum(osm_data.data(), osm_data.size());
+    ASSERT_TRUE(GraphCache::Save(cache_file, renumbered, checksum));
+    auto cache = GraphCache::Open(cache_file, checksum);
+    ASSERT_TRUE(cache);
+    RouteModel loaded{*cache};
+    std::remove(cache_file.c_str());
+
+    EXPECT_EQ(loaded.Order(), Model::NodeOrder::Hilbert);
+    EXPECT_EQ(loaded.NodePermutation(), renumbered.NodePermutation());
+    for (int node = 0; node < (int)loaded.Nodes().size(); node++)
+        EXPECT_EQ(loaded.NodeAtFileIndex(loaded.FileIndex(node)), node);
+}
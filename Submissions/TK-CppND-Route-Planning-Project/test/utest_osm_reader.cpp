@@ -0,0 +1,162 @@
+#include "gtest/gtest.h"
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include "../src/id_map.h"
+#include "../src/model.h"
+#include "../src/osm_reader.h"
+
+
+static std::vector<int> Indices(Model::IndexRange range) {
+    return {range.begin(), range.end()};
+}
+
+static std::vector<std::byte> Bytes(const std::string &text) {
+    std::vector<std::byte> bytes(text.size());
+    std::memcpy(bytes.data(), text.data(), text.size());
+    return bytes;
+}
+
+
+// Test the event sequence over the XML constructs found in OSM exports.
+TEST(OsmReaderTest, TestEvents) {
+    auto xml = Bytes("<?xml version='1.0' encoding='UTF-8'?>\n"
+                     "<!DOCTYPE osm>\n"
+                     "<osm version=\"0.6\">\n"
+                     "  <!-- a <comment> -->\n"
+                     "  <node id=\"1\" lat='48.1' lon = \"11.5\"/>\n"
+                     "  <way id=\"2\"><nd ref=\"1\" /><tag k=\"name\" v=\"a &amp; b\"/></way >\n"
+                     "  <![CDATA[<node id=\"3\"/>]]>\n"
+                     "</osm>\n");
+    OsmReader reader{xml.data(), xml.size()};
+
+    ASSERT_EQ(reader.Next(), OsmReader::StartElement);
+    EXPECT_EQ(reader.Name(), "osm");
+    EXPECT_EQ(reader.Attribute("version"), "0.6");
+    EXPECT_EQ(reader.Depth(), 1);
+
+    ASSERT_EQ(reader.Next(), OsmReader::StartElement);
+    EXPECT_EQ(reader.Name(), "node");
+    EXPECT_EQ(reader.Attribute("id"), "1");
+    EXPECT_EQ(reader.Attribute("lat"), "48.1");
+    EXPECT_EQ(reader.Attribute("lon"), "11.5");
+    EXPECT_EQ(reader.Attribute("user"), "");
+    EXPECT_EQ(reader.Depth(), 2);
+    ASSERT_EQ(reader.Next(), OsmReader::EndElement);
+    EXPECT_EQ(reader.Name(), "node");
+    EXPECT_EQ(reader.Depth(), 1);
+
+    ASSERT_EQ(reader.Next(), OsmReader::StartElement);
+    EXPECT_EQ(reader.Name(), "way");
+    ASSERT_EQ(reader.Next(), OsmReader::StartElement);
+    EXPECT_EQ(reader.Name(), "nd");
+    EXPECT_EQ(reader.Attribute("ref"), "1");
+    ASSERT_EQ(reader.Next(), OsmReader::EndElement);
+    ASSERT_EQ(reader.Next(), OsmReader::StartElement);
+    EXPECT_EQ(reader.Name(), "tag");
+    EXPECT_EQ(reader.Attribute("v"), "a &amp; b");
+    ASSERT_EQ(reader.Next(), OsmReader::EndElement);
+    ASSERT_EQ(reader.Next(), OsmReader::EndElement);
+    EXPECT_EQ(reader.Name(), "way");
+
+    ASSERT_EQ(reader.Next(), OsmReader::EndElement);
+    EXPECT_EQ(reader.Name(), "osm");
+    EXPECT_EQ(reader.Depth(), 0);
+    EXPECT_EQ(reader.Next(), OsmReader::EndOfDocument);
+}
+
+
+// Test that truncated or malformed documents are rejected.
+TEST(OsmReaderTest, TestMalformed) {
+    for (const char *text : {"<osm><node id=\"1\"/>", "<osm><node id=\"1/></osm>",
+                             "<osm><node id=1/></osm>", "</osm>", "<osm><!-- </osm>"}) {
+        auto xml = Bytes(text);
+        OsmReader reader{xml.data(), xml.size()};
+        EXPECT_THROW(while (reader.Next() != OsmReader::EndOfDocument) {}, std::logic_error) << text;
+    }
+}
+
+
+// Test that relation members are resolved whether the tags come before or after them.
+TEST(OsmReaderTest, TestModelFromStream) {
+    auto xml = Bytes("<osm><bounds minlat=\"0\" maxlat=\"0.001\" minlon=\"0\" maxlon=\"0.001\"/>"
+                     "<node id=\"1\" lat=\"0\" lon=\"0\"/><node id=\"2\" lat=\"0\" lon=\"0.001\"/>"
+                     "<node id=\"3\" lat=\"0.001\" lon=\"0.001\"><tag k=\"highway\" v=\"crossing\"/></node>"
+                     "<way id=\"10\"><nd ref=\"1\"/><nd ref=\"2\"/><nd ref=\"9\"/><tag k=\"highway\" v=\"primary\"/></way>"
+                     "<way id=\"11\"><nd ref=\"2\"/><nd ref=\"3\"/><nd ref=\"1\"/><nd ref=\"2\"/></way>"
+                     "<relation id=\"20\"><tag k=\"building\" v=\"yes\"/><member type=\"way\" ref=\"11\" role=\"outer\"/></relation>"
+                     "<relation id=\"21\"><member type=\"way\" ref=\"11\" role=\"outer\"/>"
+                     "<member type=\"node\" ref=\"1\" role=\"\"/><tag k=\"landuse\" v=\"grass\"/></relation>"
+                     "</osm>");
+    Model model{xml};
+    ASSERT_EQ(model.Nodes().size(), 3u);
+    ASSERT_EQ(model.Ways().size(), 2u);
+    EXPECT_EQ(Indices(model.WayNodes(0)), (std::vector<int>{0, 1}));
+    ASSERT_EQ(model.Roads().size(), 1u);
+    EXPECT_EQ(model.Roads()[0].type, Model::Road::Primary);
+    ASSERT_EQ(model.Buildings().size(), 1u);
+    EXPECT_EQ(Indices(model.Outer(model.Buildings()[0])), std::vector<int>{1});
+    ASSERT_EQ(model.Landuses().size(), 1u);
+    EXPECT_EQ(model.Landuses()[0].type, Model::Landuse::Grass);
+    EXPECT_EQ(Indices(model.Outer(model.Landuses()[0])), std::vector<int>{1});
+
+    auto no_bounds = Bytes("<osm><node id=\"1\" lat=\"0\" lon=\"0\"/></osm>");
+    EXPECT_THROW(Model{no_bounds}, std::logic_error);
+
+    // Malformed or missing coordinates are reported rather than read as 0.
+    for (const char *lat : {"\"\"", "\"12.5x\"", "\"north\"", "\"nan\""}) {
+        auto bad_node = Bytes(std::string{"<osm><bounds minlat=\"0\" maxlat=\"1\" minlon=\"0\" maxlon=\"1\"/>"
+                                          "<node id=\"1\" lat="} + lat + " lon=\"0\"/></osm>");
+        EXPECT_THROW(Model{bad_node}, std::logic_error) << lat;
+    }
+    auto bad_bounds = Bytes("<osm><bounds minlat=\"0\" maxlat=\"1\" minlon=\"west\" maxlon=\"1\"/></osm>");
+    EXPECT_THROW(Model{bad_bounds}, std::logic_error);
+}
+
+
+// Test the id map against std::unordered_map, including growth past the reserved size.
+TEST(IdMapTest, TestAgainstUnorderedMap) {
+    IdMap ids{4};
+    std::unordered_map<std::int64_t, int> reference;
+    for (int i = 0; i < 5000; i++) {
+        std::int64_t id = (i % 3 == 0) ? -i : std::int64_t(i) * 7919 + (std::int64_t(1) << 40);
+        ids.Insert(id, i);
+        reference[id] = i;
+    }
+    ids.Insert(7919 + (std::int64_t(1) << 40), -5);
+    reference[7919 + (std::int64_t(1) << 40)] = -5;
+
+    EXPECT_EQ(ids.Size(), reference.size());
+    for (const auto &[id, index] : reference)
+        EXPECT_EQ(ids.Find(id), index);
+    EXPECT_EQ(ids.Find(3), IdMap::kMissing);
+    EXPECT_EQ(ids.Find(std::numeric_limits<std::int64_t>::max()), IdMap::kMissing);
+}
+
+
+// Test that a file not sorted as nodes, ways, relations loads the same as a sorted one.
+TEST(OsmReaderTest, TestUnsortedSections) {
+    const std::string bounds = "<bounds minlat=\"0\" maxlat=\"0.001\" minlon=\"0\" maxlon=\"0.001\"/>";
+    const std::string nodes = "<node id=\"1\" lat=\"0\" lon=\"0\"/><node id=\"2\" lat=\"0\" lon=\"0.001\"/>"
+                              "<node id=\"3\" lat=\"0.001\" lon=\"0.001\"/>";
+    const std::string way = "<way id=\"10\"><nd ref=\"1\"/><nd ref=\"2\"/><nd ref=\"3\"/><tag k=\"highway\" v=\"primary\"/></way>";
+    const std::string relation = "<relation id=\"20\"><member type=\"way\" ref=\"10\" role=\"outer\"/>"
+                                 "<tag k=\"building\" v=\"yes\"/></relation>";
+
+    auto sorted = Bytes("<osm>" + bounds + nodes + way + relation + "</osm>");
+    auto unsorted = Bytes("<osm>" + relation + way + nodes + bounds + "</osm>");
+    Model a{sorted, 1}, b{unsorted, 2};
+    ASSERT_EQ(b.Nodes().size(), a.Nodes().size());
+    for (std::size_t i = 0; i < a.Nodes().size(); i++) {
+        EXPECT_EQ(b.Nodes()[i].x, a.Nodes()[i].x);
+        EXPECT_EQ(b.Nodes()[i].y, a.Nodes()[i].y);
+    }
+    ASSERT_EQ(b.Ways().size(), 1u);
+    EXPECT_EQ(Indices(b.WayNodes(0)), Indices(a.WayNodes(0)));
+    EXPECT_EQ(b.Roads().size(), 1u);
+    ASSERT_EQ(b.Buildings().size(), 1u);
+    EXPECT_EQ(Indices(b.Outer(b.Buildings()[0])), Indices(a.Outer(a.Buildings()[0])));
+    EXPECT_EQ(b.MetricScale(), a.MetricScale());
+}
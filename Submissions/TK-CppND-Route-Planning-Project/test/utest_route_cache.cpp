@@ -0,0 +1,104 @@
+#include "gtest/gtest.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "test_util.h"
+#include "../src/route_cache.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+#include "../src/thread_pool.h"
+
+
+static RouteCache::Key NodeKey(int start, int end) {
+    return {start, start, 0.0f, end, end, 0.0f, RouteModel::kDefaultProfile};
+}
+
+
+// Test that the least recently used entry is evicted first and that the counters add up.
+TEST(RouteCacheTest, TestLeastRecentlyUsedEviction) {
+    RouteCache cache{2};
+    auto route = std::make_shared<RouteCache::Route>();
+    cache.Insert(NodeKey(1, 2), route, 0);
+    cache.Insert(NodeKey(3, 4), route, 0);
+    EXPECT_EQ(cache.Find(NodeKey(1, 2), 0), route);
+    cache.Insert(NodeKey(5, 6), route, 0);
+    EXPECT_EQ(cache.Find(NodeKey(3, 4), 0), nullptr);
+    EXPECT_NE(cache.Find(NodeKey(1, 2), 0), nullptr);
+    EXPECT_NE(cache.Find(NodeKey(5, 6), 0), nullptr);
+    // Same nodes, other profile.
+    RouteCache::Key walking = NodeKey(1, 2);
+    walking.profile = 2;
+    EXPECT_EQ(cache.Find(walking, 0), nullptr);
+
+    RouteCache::Stats stats = cache.GetStats();
+    EXPECT_EQ(stats.hits, 3);
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.evictions, 1);
+    EXPECT_EQ(stats.size, 2u);
+    EXPECT_DOUBLE_EQ(stats.HitRate(), 0.6);
+
+    // A newer graph version drops every entry; routes from older ones are not kept.
+    EXPECT_EQ(cache.Find(NodeKey(1, 2), 1), nullptr);
+    cache.Insert(NodeKey(1, 2), route, 0);
+    EXPECT_EQ(cache.GetStats().size, 0u);
+    EXPECT_EQ(cache.GetStats().invalidations, 1);
+}
+
+
+// Test that cached routes match the planner and are recomputed once the edge weights change.
+TEST(RouteCacheTest, TestFindOrRoute) {
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    RouteCache cache{64};
+    SearchWorkspace workspace;
+    for (RoutePlanner::Snap snap : {RoutePlanner::Snap::ToNode, RoutePlanner::Snap::ToEdge}) {
+        auto first = cache.FindOrRoute(model, workspace, 10.0f, 20.0f, 80.0f, 70.0f, snap);
+        RoutePlanner planner{model, 10.0f, 20.0f, 80.0f, 70.0f, snap};
+        planner.AStarSearch();
+        EXPECT_FLOAT_EQ(first->distance, planner.GetDistance());
+        std::vector<int> expected;
+        for (int node : planner.GetPath().nodes)
+            if (node != RoutePath::kSnappedPoint)
+                expected.push_back(node);
+        EXPECT_EQ(first->nodes, expected);
+        // The same query again is a hit.
+        EXPECT_EQ(cache.FindOrRoute(model, workspace, 10.0f, 20.0f, 80.0f, 70.0f, snap), first);
+    }
+    EXPECT_EQ(cache.GetStats().hits, 2);
+
+    // Slowing residential streets to a crawl changes the weights.
+    RoutingProfile car = model.Profile(RouteModel::kDefaultProfile);
+    car.metric = RoutingProfile::Metric::Time;
+    car.speeds[Model::Road::Residential] = 1.0f;
+    const std::uint64_t version = model.GraphVersion();
+    model.SetProfile(RouteModel::kDefaultProfile, car);
+    EXPECT_GT(model.GraphVersion(), version);
+    auto recomputed = cache.FindOrRoute(model, workspace, 10.0f, 20.0f, 80.0f, 70.0f);
+    EXPECT_EQ(cache.GetStats().invalidations, 1);
+    EXPECT_EQ(cache.GetStats().hits, 2);
+    EXPECT_EQ(cache.GetStats().size, 1u);
+    EXPECT_EQ(cache.FindOrRoute(model, workspace, 10.0f, 20.0f, 80.0f, 70.0f), recomputed);
+}
+
+
+// Test that threads sharing the cache see every lookup counted once.
+TEST(RouteCacheTest, TestSharedBetweenThreads) {
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    RouteCache cache{4};
+    ThreadPool pool{4};
+    std::vector<SearchWorkspace> workspaces(pool.ThreadCount());
+    std::atomic<int> unreachable{0};
+    pool.ParallelFor(400, [&](int i, int thread) {
+        float pair = (float)(i % 8);
+        auto route = cache.FindOrRoute(model, workspaces[thread], pair * 10.0f, 5.0f, 95.0f - pair * 10.0f, 90.0f);
+        if (route->nodes.empty())
+            unreachable++;
+    });
+    RouteCache::Stats stats = cache.GetStats();
+    EXPECT_EQ(stats.hits + stats.misses, 400);
+    EXPECT_LE(stats.size, 4u);
+    // Threads missing the same route at once both insert it.
+    EXPECT_LE(stats.evictions, stats.misses - (long)stats.size);
+    EXPECT_EQ(unreachable, 0);
+}
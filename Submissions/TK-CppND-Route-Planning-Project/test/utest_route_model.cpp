@@ -0,0 +1,135 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+#include <utility>
+#include "test_util.h"
+#include "../src/route_model.h"
+
+
+class RouteModelTest : public ::testing::Test {
+  protected:
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+};
+
+
+// Test that the road graph links exactly the consecutive nodes of drivable ways.
+TEST_F(RouteModelTest, TestRoadGraphMatchesWays) {
+    std::set<std::pair<int, int>> segments;
+    for (const Model::Road &road : model.Roads()) {
+        if (road.type == Model::Road::Footway)
+            continue;
+        Model::IndexRange way_nodes = model.WayNodes(road.way);
+        for (std::size_t i = 1; i < way_nodes.size(); i++) {
+            if (way_nodes[i - 1] == way_nodes[i])
+                continue;
+            segments.insert({way_nodes[i - 1], way_nodes[i]});
+            segments.insert({way_nodes[i], way_nodes[i - 1]});
+        }
+    }
+
+    const Graph &graph = model.RoadGraph();
+    EXPECT_EQ(graph.NodeCount(), (int)model.SNodes().size());
+    EXPECT_EQ(graph.EdgeCount(), (int)segments.size());
+    for (int node = 0; node < graph.NodeCount(); node++) {
+        for (const Graph::Edge &edge : graph.Edges(node)) {
+            EXPECT_TRUE(segments.count({node, edge.to}));
+            EXPECT_FLOAT_EQ(edge.weight, model.SNodes()[node].distance(model.SNodes()[edge.to]));
+        }
+    }
+}
+
+
+// Test that the Graph constructor drops self loops and keeps the lightest parallel arc.
+TEST(GraphTest, TestParallelArcsAndSelfLoops) {
+    Graph graph{3, {{0, 1, 2.0f}, {0, 1, 1.0f}, {1, 1, 5.0f}, {2, 0, 3.0f}, {0, 2, 4.0f}}};
+    EXPECT_EQ(graph.EdgeCount(), 3);
+    ASSERT_EQ(graph.Edges(0).size(), 2);
+    EXPECT_EQ(graph.Edges(0).begin()->to, 1);
+    EXPECT_FLOAT_EQ(graph.Edges(0).begin()->weight, 1.0f);
+    EXPECT_TRUE(graph.Edges(1).empty());
+    EXPECT_EQ(graph.Edges(2).size(), 1);
+}
+
+
+// Brute-force distances from (x, y) to every node on a drivable road.
+static std::vector<std::pair<float, int>> ScanRoadNodes(const RouteModel &model, float x, float y) {
+    RouteModel::Node query;
+    query.x = x;
+    query.y = y;
+    std::set<int> seen;
+    std::vector<std::pair<float, int>> candidates;
+    for (const Model::Road &road : model.Roads())
+        if (road.type != Model::Road::Footway)
+            for (int node : model.WayNodes(road.way))
+                if (seen.insert(node).second)
+                    candidates.push_back({query.distance(model.SNodes()[node]), node});
+    std::sort(candidates.begin(), candidates.end());
+    return candidates;
+}
+
+
+// Test the nearest, k-nearest and radius queries against a linear scan.
+TEST_F(RouteModelTest, TestSpatialQueries) {
+    for (float x = -0.05f; x < 1.1f; x += 0.15f) {
+        for (float y = -0.05f; y < 1.1f; y += 0.2f) {
+            auto expected = ScanRoadNodes(model, x, y);
+            ASSERT_FALSE(expected.empty());
+            RouteModel::Node query;
+            query.x = x;
+            query.y = y;
+
+            EXPECT_FLOAT_EQ(query.distance(model.FindClosestNode(x, y)), expected[0].first);
+
+            std::vector<int> nearest = model.FindClosestNodes(x, y, 5);
+            ASSERT_EQ(nearest.size(), 5u);
+            for (std::size_t i = 0; i < nearest.size(); i++)
+                EXPECT_FLOAT_EQ(query.distance(model.SNodes()[nearest[i]]), expected[i].first);
+
+            float radius = 0.05f;
+            std::vector<int> within = model.FindNodesWithin(x, y, radius);
+            std::set<int> within_set(within.begin(), within.end());
+            EXPECT_EQ(within_set.size(), within.size());
+            for (auto &[distance, node] : expected) {
+                if (distance < radius * 0.999f) {
+                    EXPECT_TRUE(within_set.count(node));
+                } else if (distance > radius * 1.001f) {
+                    EXPECT_FALSE(within_set.count(node));
+                }
+            }
+        }
+    }
+}
+
+
+// Test FindClosestEdgePoint against a projection onto every road segment.
+TEST_F(RouteModelTest, TestFindClosestEdgePoint) {
+    const Graph &graph = model.RoadGraph();
+    for (float x = -0.05f; x < 1.1f; x += 0.15f) {
+        for (float y = -0.05f; y < 1.1f; y += 0.2f) {
+            double best = std::numeric_limits<double>::infinity();
+            for (int from = 0; from < graph.NodeCount(); from++) {
+                const RouteModel::Node a = model.SNodes()[from];
+                for (const Graph::Edge &edge : graph.Edges(from)) {
+                    const RouteModel::Node b = model.SNodes()[edge.to];
+                    double dx = b.x - a.x, dy = b.y - a.y, length2 = dx * dx + dy * dy;
+                    double t = length2 > 0 ? std::clamp(((x - a.x) * dx + (y - a.y) * dy) / length2, 0.0, 1.0) : 0.0;
+                    best = std::min(best, std::hypot(a.x + t * dx - x, a.y + t * dy - y));
+                }
+            }
+
+            RouteModel::EdgePoint point = model.FindClosestEdgePoint(x, y);
+            const RouteModel::Node a = model.SNodes()[point.from], b = model.SNodes()[point.to];
+            EXPECT_NEAR(std::hypot(point.x - x, point.y - y), best, 1e-5);
+            EXPECT_NEAR(point.x, a.x + point.t * (b.x - a.x), 1e-5);
+            EXPECT_NEAR(point.y, a.y + point.t * (b.y - a.y), 1e-5);
+            // Never farther than the closest node.
+            RouteModel::Node query;
+            query.x = x;
+            query.y = y;
+            EXPECT_LE(std::hypot(point.x - x, point.y - y), query.distance(model.FindClosestNode(x, y)) + 1e-5);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+
+// Two ways from node 1 to node 3: a straight residential street through node 2
+// and a longer motorway over node 4. Node 5 is only reached by a footway.
+static std::vector<std::byte> ProfileMap() {
+    const std::string text =
+        "<osm><bounds minlat=\"-0.002\" maxlat=\"0.004\" minlon=\"0\" maxlon=\"0.01\"/>"
+        "<node id=\"1\" lat=\"0\" lon=\"0\"/><node id=\"2\" lat=\"0\" lon=\"0.005\"/>"
+        "<node id=\"3\" lat=\"0\" lon=\"0.01\"/><node id=\"4\" lat=\"0.004\" lon=\"0.005\"/>"
+        "<node id=\"5\" lat=\"-0.002\" lon=\"0.005\"/>"
+        "<way id=\"10\"><nd ref=\"1\"/><nd ref=\"2\"/><nd ref=\"3\"/><tag k=\"highway\" v=\"residential\"/></way>"
+        "<way id=\"11\"><nd ref=\"1\"/><nd ref=\"4\"/><nd ref=\"3\"/><tag k=\"highway\" v=\"motorway\"/></way>"
+        "<way id=\"12\"><nd ref=\"2\"/><nd ref=\"5\"/><tag k=\"highway\" v=\"footway\"/></way>"
+        "</osm>";
+    std::vector<std::byte> bytes(text.size());
+    std::memcpy(bytes.data(), text.data(), text.size());
+    return bytes;
+}
+
+
+static bool Visits(const RoutePath &path, int node) {
+    return std::find(path.nodes.begin(), path.nodes.end(), node) != path.nodes.end();
+}
+
+
+// Test that every profile gets its own graph with only the roads it may use.
+TEST(RoutingProfileTest, TestProfileGraphs) {
+    RouteModel model{ProfileMap()};
+    ASSERT_EQ(model.ProfileCount(), 3);
+    EXPECT_EQ(model.Profile(RouteModel::kDefaultProfile).name, "car");
+    const int fastest = model.FindProfile("car-fastest"), walking = model.FindProfile("walking");
+    ASSERT_GE(fastest, 0);
+    ASSERT_GE(walking, 0);
+    EXPECT_EQ(model.FindProfile("boat"), -1);
+
+    // Car skips the footway, walking the motorway.
+    EXPECT_EQ(model.RoadGraph().EdgeCount(), 8);
+    EXPECT_EQ(model.RoadGraph(fastest).EdgeCount(), 8);
+    EXPECT_EQ(model.RoadGraph(walking).EdgeCount(), 6);
+    EXPECT_FALSE(model.Neighbors(3).empty());
+    EXPECT_TRUE(model.Neighbors(3, walking).empty());
+    EXPECT_TRUE(model.Neighbors(4).empty());
+    EXPECT_FALSE(model.Neighbors(4, walking).empty());
+
+    // The shortest profiles weigh edges by length, the fastest one by time.
+    for (const Graph::Edge &edge : model.Neighbors(0))
+        EXPECT_FLOAT_EQ(edge.weight, model.SNodes()[0].distance(model.SNodes()[edge.to]));
+    for (const Graph::Edge &edge : model.Neighbors(0, fastest))
+        EXPECT_GE(edge.weight, model.SNodes()[0].distance(model.SNodes()[edge.to]) * (1.0f - 1e-6f));
+
+    // Snapping only considers the profile's roads.
+    const RouteModel::Node footway_end = model.SNodes()[4];
+    float x = footway_end.x, y = footway_end.y;
+    EXPECT_EQ(model.FindClosestNode(x, y, walking).Index(), footway_end.Index());
+    EXPECT_NE(model.FindClosestNode(x, y).Index(), footway_end.Index());
+}
+
+
+// Test that the shortest car route takes the street while the fastest takes the motorway.
+TEST(RoutingProfileTest, TestShortestAndFastestRoutes) {
+    RouteModel model{ProfileMap()};
+    const int fastest = model.FindProfile("car-fastest");
+    const RouteModel::Node start = model.SNodes()[0], end = model.SNodes()[2];
+    float sx = start.x * 100, sy = start.y * 100, ex = end.x * 100, ey = end.y * 100;
+
+    for (RoutePlanner::Snap snap : {RoutePlanner::Snap::ToNode, RoutePlanner::Snap::ToEdge}) {
+        RoutePlanner shortest{model, sx, sy, ex, ey, snap};
+        shortest.AStarSearch();
+        RoutePlanner quickest{model, sx, sy, ex, ey, snap, fastest};
+        quickest.AStarSearch();
+
+        EXPECT_TRUE(Visits(shortest.GetPath(), 1));
+        EXPECT_FALSE(Visits(shortest.GetPath(), 3));
+        EXPECT_TRUE(Visits(quickest.GetPath(), 3));
+        EXPECT_LT(shortest.GetDistance(), quickest.GetDistance());
+    }
+}
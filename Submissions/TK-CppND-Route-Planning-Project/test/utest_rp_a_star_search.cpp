@@ -1,40 +1,14 @@
 #include "gtest/gtest.h"
-#include <fstream>
-#include <iostream>
-#include <optional>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <thread>
 #include <vector>
+#include "test_util.h"
 #include "../src/route_model.h"
 #include "../src/route_planner.h"
 
 
-static std::optional<std::vector<std::byte>> ReadFile(const std::string &path)
-{   
-    std::ifstream is{path, std::ios::binary | std::ios::ate};
-    if( !is )
-        return std::nullopt;
-    
-    auto size = is.tellg();
-    std::vector<std::byte> contents(size);    
-    
-    is.seekg(0);
-    is.read((char*)contents.data(), size);
-
-    if( contents.empty() )
-        return std::nullopt;
-    return std::move(contents);
-}
-
-std::vector<std::byte> ReadOSMData(const std::string &path) {
-    std::vector<std::byte> osm_data;
-    auto data = ReadFile(path);
-    if( !data ) {
-        std::cout << "Failed to read OSM data." << std::endl;
-    } else {
-        osm_data = std::move(*data);
-    }
-    return osm_data;
-}
-
 //--------------------------------//
 //   Beginning RoutePlanner Tests.
 //--------------------------------//
@@ -44,79 +18,269 @@ class RoutePlannerTest : public ::testing::Test {
     std::string osm_data_file = "../map.osm";
     std::vector<std::byte> osm_data = ReadOSMData(osm_data_file);
     RouteModel model{osm_data};
-    RoutePlanner route_planner{model, 10, 10, 90, 90};
+    SearchWorkspace workspace;
+    RoutePlanner route_planner{model, workspace, 10, 10, 90, 90};
     
     // Construct start_node and end_node as in the model.
     float start_x = 0.1;
     float start_y = 0.1;
     float end_x = 0.9;
     float end_y = 0.9;
-    RouteModel::Node* start_node = &model.FindClosestNode(start_x, start_y);
-    RouteModel::Node* end_node = &model.FindClosestNode(end_x, end_y);
+    const RouteModel::Node start_node = model.FindClosestNode(start_x, start_y);
+    const RouteModel::Node end_node = model.FindClosestNode(end_x, end_y);
 
     // Construct another node in the middle of the map for testing.
     float mid_x = 0.5;
     float mid_y = 0.5;
-    RouteModel::Node* mid_node = &model.FindClosestNode(mid_x, mid_y);
+    const RouteModel::Node mid_node = model.FindClosestNode(mid_x, mid_y);
 };
 
 
 // Test the CalculateHValue method.
 TEST_F(RoutePlannerTest, TestCalculateHValue) {
-    EXPECT_FLOAT_EQ(route_planner.CalculateHValue(start_node), 1.1329799);
-    EXPECT_FLOAT_EQ(route_planner.CalculateHValue(end_node), 0.0f);
-    EXPECT_FLOAT_EQ(route_planner.CalculateHValue(mid_node), 0.58903033);
+    EXPECT_FLOAT_EQ(route_planner.CalculateHValue(&start_node), 1.1329799);
+    EXPECT_FLOAT_EQ(route_planner.CalculateHValue(&end_node), 0.0f);
+    EXPECT_FLOAT_EQ(route_planner.CalculateHValue(&mid_node), 0.58903033);
 }
 
 
 
 // Test the AddNeighbors method.
-bool NodesSame(RouteModel::Node* a, RouteModel::Node* b) { return a == b; }
 TEST_F(RoutePlannerTest, TestAddNeighbors) {
-    route_planner.AddNeighbors(start_node);
-
-    // Correct h and g values for the neighbors of start_node.
-    std::vector<float> start_neighbor_g_vals{0.10671431, 0.082997195, 0.051776856, 0.055291083};
-    std::vector<float> start_neighbor_h_vals{1.1828455, 1.0998145, 1.0858033, 1.1831238};
-    auto neighbors = start_node->neighbors;
-    EXPECT_EQ(neighbors.size(), 4);
-
-    // Check results for each neighbor.
-    for (int i = 0; i < neighbors.size(); i++) {
-        EXPECT_PRED2(NodesSame, neighbors[i]->parent, start_node);
-        EXPECT_FLOAT_EQ(neighbors[i]->g_value, start_neighbor_g_vals[i]);
-        EXPECT_FLOAT_EQ(neighbors[i]->h_value, start_neighbor_h_vals[i]);
-        EXPECT_EQ(neighbors[i]->visited, true);
+    route_planner.AddNeighbors(&start_node);
+
+    // Every road segment leaving start_node is queued with its length as g value.
+    auto edges = model.Neighbors(start_node.Index());
+    EXPECT_GT(edges.size(), 0);
+    for (const Graph::Edge &edge : edges) {
+        const RouteModel::Node neighbor = model.SNodes()[edge.to];
+        EXPECT_EQ(workspace.Parent(edge.to), start_node.Index());
+        EXPECT_FLOAT_EQ(workspace.GValue(edge.to), start_node.distance(neighbor));
+        EXPECT_FLOAT_EQ(workspace.HValue(edge.to), neighbor.distance(end_node));
+        // Neighbors are only closed once they are expanded.
+        EXPECT_EQ(workspace.Closed(edge.to), false);
     }
 }
 
 
+// Test that a queued neighbor reached again through a shorter path is relaxed.
+TEST_F(RoutePlannerTest, TestAddNeighborsRelaxesQueuedNode) {
+    route_planner.AddNeighbors(&start_node);
+    int neighbor = model.Neighbors(start_node.Index()).begin()->to;
+    float g_value = workspace.GValue(neighbor);
+
+    // Pretend the neighbor was first reached through a longer detour.
+    workspace.Relax(neighbor, g_value + 1.0f, mid_node.Index());
+    route_planner.AddNeighbors(&start_node);
+
+    EXPECT_EQ(workspace.Parent(neighbor), start_node.Index());
+    EXPECT_FLOAT_EQ(workspace.GValue(neighbor), g_value);
+}
+
+
+// Test that NextNode returns the queued node with the lowest f value.
+TEST_F(RoutePlannerTest, TestNextNode) {
+    route_planner.AddNeighbors(&start_node);
+    const RouteModel::Node next_node = route_planner.NextNode();
+
+    EXPECT_EQ(workspace.Closed(next_node.Index()), true);
+    auto f_value = [&](int node) { return workspace.GValue(node) + workspace.HValue(node); };
+    for (const Graph::Edge &edge : model.Neighbors(start_node.Index()))
+        EXPECT_LE(f_value(next_node.Index()), f_value(edge.to));
+}
+
+
 // Test the ConstructFinalPath method.
 TEST_F(RoutePlannerTest, TestConstructFinalPath) {
     // Construct a path.
-    mid_node->parent = start_node;
-    end_node->parent = mid_node;
-    std::vector<RouteModel::Node> path = route_planner.ConstructFinalPath(end_node);
+    workspace.Reach(mid_node.Index(), 0.0f, 0.0f, start_node.Index());
+    workspace.Reach(end_node.Index(), 0.0f, 0.0f, mid_node.Index());
+    const RoutePath &path = route_planner.ConstructFinalPath(&end_node);
 
     // Test the path.
-    EXPECT_EQ(path.size(), 3);
-    EXPECT_FLOAT_EQ(start_node->x, path.front().x);
-    EXPECT_FLOAT_EQ(start_node->y, path.front().y);
-    EXPECT_FLOAT_EQ(end_node->x, path.back().x);
-    EXPECT_FLOAT_EQ(end_node->y, path.back().y);
+    EXPECT_EQ(path.nodes, (std::vector<int>{start_node.Index(), mid_node.Index(), end_node.Index()}));
+    EXPECT_FLOAT_EQ(start_node.x, path.start.x);
+    EXPECT_FLOAT_EQ(start_node.y, path.start.y);
+    EXPECT_FLOAT_EQ(end_node.x, path.end.x);
+    EXPECT_FLOAT_EQ(end_node.y, path.end.y);
+    // Distances add up from the start.
+    ASSERT_EQ(path.distances.size(), 3u);
+    EXPECT_EQ(path.distances[0], 0.0f);
+    EXPECT_NEAR(path.distances[1], start_node.distance(mid_node) * model.MetricScale(), 1e-3f);
+    EXPECT_NEAR(path.distances[2] - path.distances[1], mid_node.distance(end_node) * model.MetricScale(), 1e-3f);
+    EXPECT_EQ(route_planner.GetDistance(), path.Length());
 }
 
 
 // Test the AStarSearch method.
 TEST_F(RoutePlannerTest, TestAStarSearch) {
     route_planner.AStarSearch();
-    EXPECT_EQ(model.path.size(), 33);
-    RouteModel::Node path_start = model.path.front();
-    RouteModel::Node path_end = model.path.back();
+    const RoutePath &path = route_planner.GetPath();
+    ASSERT_FALSE(path.Empty());
     // The start_node and end_node x, y values should be the same as in the path.
-    EXPECT_FLOAT_EQ(start_node->x, path_start.x);
-    EXPECT_FLOAT_EQ(start_node->y, path_start.y);
-    EXPECT_FLOAT_EQ(end_node->x, path_end.x);
-    EXPECT_FLOAT_EQ(end_node->y, path_end.y);
-    EXPECT_FLOAT_EQ(route_planner.GetDistance(), 873.41565);
+    EXPECT_FLOAT_EQ(start_node.x, path.start.x);
+    EXPECT_FLOAT_EQ(start_node.y, path.start.y);
+    EXPECT_FLOAT_EQ(end_node.x, path.end.x);
+    EXPECT_FLOAT_EQ(end_node.y, path.end.y);
+
+    // The reported distance is the length of the returned path in meters.
+    float length = 0.0f;
+    for (std::size_t i = 1; i < path.Size(); i++) {
+        length += model.SNodes()[path.nodes[i]].distance(model.SNodes()[path.nodes[i - 1]]);
+        EXPECT_NEAR(path.distances[i], length * model.MetricScale(), 0.01f);
+    }
+    EXPECT_NEAR(route_planner.GetDistance(), length * model.MetricScale(), 0.01f);
+    EXPECT_GT(route_planner.GetExpandedNodes(), 0);
+}
+
+
+// Shortest distances from `source` over the road graph, by plain Dijkstra.
+static std::vector<float> Dijkstra(const RouteModel &model, int source) {
+    using Entry = std::pair<float, int>;
+    std::vector<float> dist(model.SNodes().size(), std::numeric_limits<float>::infinity());
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    dist[source] = 0.0f;
+    queue.push({0.0f, source});
+    while (!queue.empty()) {
+        auto [d, node] = queue.top();
+        queue.pop();
+        if (d > dist[node])
+            continue;
+        for (const Graph::Edge &edge : model.Neighbors(node))
+            if (d + edge.weight < dist[edge.to]) {
+                dist[edge.to] = d + edge.weight;
+                queue.push({dist[edge.to], edge.to});
+            }
+    }
+    return dist;
+}
+
+
+// Test that A* finds a shortest path, by comparing with a plain Dijkstra search.
+TEST_F(RoutePlannerTest, TestAStarSearchIsOptimal) {
+    std::vector<float> dist = Dijkstra(model, start_node.Index());
+    route_planner.AStarSearch();
+    float expected = dist[end_node.Index()] * model.MetricScale();
+    EXPECT_NEAR(route_planner.GetDistance(), expected, expected * 1e-4f);
+}
+
+
+// Test a search between points snapped onto road segments instead of nodes.
+TEST_F(RoutePlannerTest, TestAStarSearchFromEdgePoints) {
+    RouteModel::EdgePoint start = model.FindClosestEdgePoint(start_x, start_y);
+    RouteModel::EdgePoint end = model.FindClosestEdgePoint(end_x, end_y);
+    RoutePlanner edge_planner{model, workspace, 10, 10, 90, 90, RoutePlanner::Snap::ToEdge};
+    edge_planner.AStarSearch();
+
+    // Leave the start segment through either end, enter the end segment through either end.
+    auto length = [&](int a, int b) { return model.SNodes()[a].distance(model.SNodes()[b]); };
+    float start_length = length(start.from, start.to), end_length = length(end.from, end.to);
+    std::vector<std::pair<int, float>> exits{{start.from, start.t * start_length}, {start.to, (1 - start.t) * start_length}};
+    std::vector<std::pair<int, float>> entries{{end.from, end.t * end_length}, {end.to, (1 - end.t) * end_length}};
+    float expected = std::numeric_limits<float>::infinity();
+    for (auto [exit, exit_offset] : exits) {
+        std::vector<float> dist = Dijkstra(model, exit);
+        for (auto [entry, entry_offset] : entries)
+            expected = std::min(expected, exit_offset + dist[entry] + entry_offset);
+    }
+    expected *= model.MetricScale();
+
+    const RoutePath &path = edge_planner.GetPath();
+    ASSERT_GE(path.Size(), 2u);
+    EXPECT_EQ(path.nodes.front(), RoutePath::kSnappedPoint);
+    EXPECT_EQ(path.nodes.back(), RoutePath::kSnappedPoint);
+    EXPECT_FLOAT_EQ(path.start.x, start.x);
+    EXPECT_FLOAT_EQ(path.start.y, start.y);
+    EXPECT_FLOAT_EQ(path.end.x, end.x);
+    EXPECT_FLOAT_EQ(path.end.y, end.y);
+    EXPECT_NEAR(edge_planner.GetDistance(), expected, expected * 1e-4f);
+}
+
+
+// Test that one workspace can be reused across queries on the same model.
+TEST_F(RoutePlannerTest, TestWorkspaceReuse) {
+    route_planner.AStarSearch();
+    RoutePlanner other_planner{model, workspace, 90, 10, 10, 90};
+    other_planner.AStarSearch();
+    RoutePlanner repeated_planner{model, workspace, 10, 10, 90, 90};
+    repeated_planner.AStarSearch();
+
+    EXPECT_FLOAT_EQ(repeated_planner.GetDistance(), route_planner.GetDistance());
+    EXPECT_EQ(repeated_planner.GetPath().nodes, route_planner.GetPath().nodes);
+}
+
+
+// Test that several threads can search the same model at the same time.
+TEST_F(RoutePlannerTest, TestConcurrentQueries) {
+    std::vector<std::vector<float>> queries;
+    for (int i = 0; i < 16; i++)
+        queries.push_back({float(i * 6 % 100), float(i * 17 % 100), float(i * 29 % 100), float(i * 41 % 100)});
+
+    std::vector<float> expected;
+    for (auto &q : queries) {
+        RoutePlanner planner{model, workspace, q[0], q[1], q[2], q[3]};
+        planner.AStarSearch();
+        expected.push_back(planner.GetDistance());
+    }
+
+    const int thread_count = 4;
+    std::vector<float> distances(queries.size());
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t]() {
+            SearchWorkspace thread_workspace;
+            for (std::size_t i = t; i < queries.size(); i += thread_count) {
+                auto &q = queries[i];
+                RoutePlanner planner{model, thread_workspace, q[0], q[1], q[2], q[3]};
+                planner.AStarSearch();
+                distances[i] = planner.GetDistance();
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    for (std::size_t i = 0; i < queries.size(); i++)
+        EXPECT_FLOAT_EQ(distances[i], expected[i]);
+}
+
+
+// Test that the bidirectional search finds paths as short as the unidirectional one.
+TEST_F(RoutePlannerTest, TestBidirectionalAStarSearch) {
+    SearchWorkspace backward_workspace;
+    for (RoutePlanner::Snap snap : {RoutePlanner::Snap::ToNode, RoutePlanner::Snap::ToEdge}) {
+        for (int i = 0; i < 40; i++) {
+            float sx = i * 7 % 100, sy = i * 13 % 100, ex = i * 31 % 100, ey = i * 53 % 100;
+            RoutePlanner unidirectional{model, workspace, sx, sy, ex, ey, snap};
+            unidirectional.AStarSearch();
+            RoutePlanner bidirectional{model, workspace, sx, sy, ex, ey, snap};
+            bidirectional.BidirectionalAStarSearch(backward_workspace);
+
+            const RoutePath &path = bidirectional.GetPath();
+            ASSERT_EQ(path.Empty(), unidirectional.GetPath().Empty());
+            if (path.Empty())
+                continue;
+            float expected = unidirectional.GetDistance();
+            EXPECT_NEAR(bidirectional.GetDistance(), expected, 1e-4f * expected + 1e-3f);
+            EXPECT_EQ(path.nodes.front(), unidirectional.GetPath().nodes.front());
+            // AStarSearch stops at the first node on the end's position, which
+            // may be another node at the same place.
+            EXPECT_EQ(path.end.x, unidirectional.GetPath().end.x);
+            EXPECT_EQ(path.end.y, unidirectional.GetPath().end.y);
+
+            // The reported distance is the length of the returned path.
+            double length = 0.0;
+            for (std::size_t j = 1; j < path.Size(); j++) {
+                Model::Node a = path.Point(j - 1, model), b = path.Point(j, model);
+                length += std::hypot(a.x - b.x, a.y - b.y);
+            }
+            EXPECT_NEAR(length * model.MetricScale(), bidirectional.GetDistance(), 1e-4f * expected + 1e-3f);
+        }
+    }
+
+    // A query from a node to itself.
+    RoutePlanner same{model, 50, 50, 50, 50};
+    same.BidirectionalAStarSearch();
+    EXPECT_EQ(same.GetPath().Size(), 1u);
+    EXPECT_EQ(same.GetDistance(), 0.0f);
 }
@@ -0,0 +1,49 @@
+#include "gtest/gtest.h"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include "../src/thread_pool.h"
+
+
+// Test that every index is visited exactly once, also when the pool is reused.
+TEST(ThreadPoolTest, TestParallelForVisitsEveryIndex) {
+    ThreadPool pool{4};
+    EXPECT_EQ(pool.ThreadCount(), 4);
+    for (int count : {0, 1, 3, 1000}) {
+        std::vector<std::atomic<int>> visits(count);
+        pool.ParallelFor(count, [&](int i) { visits[i]++; });
+        for (int i = 0; i < count; i++)
+            EXPECT_EQ(visits[i], 1);
+    }
+}
+
+
+// Test that no two threads share a slot while the loop runs.
+TEST(ThreadPoolTest, TestParallelForThreadSlots) {
+    ThreadPool pool{4};
+    std::vector<std::atomic<int>> busy(pool.ThreadCount());
+    std::atomic<bool> shared{false};
+    pool.ParallelFor(2000, [&](int, int thread) {
+        ASSERT_GE(thread, 0);
+        ASSERT_LT(thread, pool.ThreadCount());
+        if (busy[thread]++ != 0)
+            shared = true;
+        std::this_thread::yield();
+        busy[thread]--;
+    });
+    EXPECT_FALSE(shared);
+}
+
+
+// Test that an exception thrown by a task reaches the caller and leaves the pool usable.
+TEST(ThreadPoolTest, TestParallelForRethrows) {
+    ThreadPool pool{3};
+    EXPECT_THROW(pool.ParallelFor(100, [](int i) {
+        if (i == 42)
+            throw std::runtime_error("task failed");
+    }), std::runtime_error);
+
+    std::atomic<int> sum{0};
+    pool.ParallelFor(10, [&](int i) { sum += i; });
+    EXPECT_EQ(sum, 45);
+}
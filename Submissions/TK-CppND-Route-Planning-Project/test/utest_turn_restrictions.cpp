@@ -0,0 +1,295 @@
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <string>
+#include <vector>
+#include "test_util.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+
+
+static std::vector<std::byte> Bytes(const std::string &text) {
+    std::vector<std::byte> bytes(text.size());
+    std::memcpy(bytes.data(), text.data(), text.size());
+    return bytes;
+}
+
+// A block of residential streets: 1 - 2 - 3 runs west to east along the
+// south side, 4 - 5 along the north side, and 2 - 4 and 3 - 5 join them.
+// Node n gets index n - 1. The restrictions given are put after the ways.
+static std::vector<std::byte> BlockMap(const std::string &relations) {
+    return Bytes(
+        "<osm><bounds minlat=\"0\" maxlat=\"0.001\" minlon=\"0\" maxlon=\"0.002\"/>"
+        "<node id=\"1\" lat=\"0\" lon=\"0\"/><node id=\"2\" lat=\"0\" lon=\"0.001\"/>"
+        "<node id=\"3\" lat=\"0\" lon=\"0.002\"/><node id=\"4\" lat=\"0.001\" lon=\"0.001\"/>"
+        "<node id=\"5\" lat=\"0.001\" lon=\"0.002\"/>"
+        "<way id=\"10\"><nd ref=\"1\"/><nd ref=\"2\"/><tag k=\"highway\" v=\"residential\"/></way>"
+        "<way id=\"11\"><nd ref=\"2\"/><nd ref=\"4\"/><tag k=\"highway\" v=\"residential\"/></way>"
+        "<way id=\"12\"><nd ref=\"2\"/><nd ref=\"3\"/><tag k=\"highway\" v=\"residential\"/></way>"
+        "<way id=\"13\"><nd ref=\"3\"/><nd ref=\"5\"/><tag k=\"highway\" v=\"residential\"/></way>"
+        "<way id=\"14\"><nd ref=\"5\"/><nd ref=\"4\"/><tag k=\"highway\" v=\"residential\"/></way>" +
+        relations + "</osm>");
+}
+
+static std::string Restriction(const std::string &value, int from, int via, int to) {
+    return "<relation id=\"" + std::to_string(100 + from) + "\"><member type=\"way\" ref=\"" + std::to_string(from) +
+           "\" role=\"from\"/><member type=\"node\" ref=\"" + std::to_string(via) + "\" role=\"via\"/>"
+           "<member type=\"way\" ref=\"" + std::to_string(to) + "\" role=\"to\"/>"
+           "<tag k=\"type\" v=\"restriction\"/><tag k=\"restriction\" v=\"" + value + "\"/></relation>";
+}
+
+// Path between two nodes, found edge-based or by AStarSearch.
+static RoutePath Search(const RouteModel &model, int from, int to, int profile = RouteModel::kDefaultProfile,
+                        bool edge_based = true) {
+    const RouteModel::Node start = model.SNodes()[from], end = model.SNodes()[to];
+    RoutePlanner planner{model, start.x * 100, start.y * 100, end.x * 100, end.y * 100, RoutePlanner::Snap::ToNode, profile};
+    if (edge_based)
+        planner.EdgeBasedAStarSearch();
+    else
+        planner.AStarSearch();
+    return planner.GetPath();
+}
+
+// Cost of the turn from `from` over `via` to `to`, by the rule
+// EdgeBasedAStarSearch documents.
+static float TurnCost(const RouteModel &model, int profile, int from, int via, int to) {
+    const RoutingProfile::TurnCosts &costs = model.Profile(profile).turn_costs;
+    const float scale = model.WeightScale(profile);
+    if (to == from)
+        return costs.u_turn / scale;
+    const float *xs = model.Nodes().Xs(), *ys = model.Nodes().Ys();
+    float in_x = xs[via] - xs[from], in_y = ys[via] - ys[from];
+    float out_x = xs[to] - xs[via], out_y = ys[to] - ys[via];
+    float dot = in_x * out_x + in_y * out_y, cross = in_x * out_y - in_y * out_x;
+    if (cross * cross <= 0.0311f * dot * dot && dot < 0.0f)
+        return costs.u_turn / scale;
+    if (model.RoadGraph(profile).Edges(via).size() <= 2 || (cross * cross <= dot * dot / 3.0f && dot > 0.0f))
+        return 0.0f;
+    return (cross > 0.0f ? costs.left : costs.right) / scale;
+}
+
+// Cost of a path of model nodes: its edge weights and turn costs, infinite
+// if it takes a forbidden turn.
+static float PathCost(const RouteModel &model, int profile, const std::vector<int> &nodes) {
+    const Graph &graph = model.RoadGraph(profile);
+    float cost = 0.0f;
+    for (std::size_t i = 1; i < nodes.size(); i++) {
+        int edge = graph.FindEdge(nodes[i - 1], nodes[i]);
+        cost += graph.EdgeArray()[edge].weight;
+        if (i < 2)
+            continue;
+        if (!model.Turns(profile).Allowed(graph.FindEdge(nodes[i - 2], nodes[i - 1]), edge))
+            return std::numeric_limits<float>::infinity();
+        cost += TurnCost(model, profile, nodes[i - 2], nodes[i - 1], nodes[i]);
+    }
+    return cost;
+}
+
+// Cost of the cheapest path between two nodes, by Dijkstra over every edge of
+// the road graph with nothing pruned.
+static float BruteForceCost(const RouteModel &model, int profile, int from, int to) {
+    const Graph &graph = model.RoadGraph(profile);
+    const FlatArray<Graph::Edge> &edges = graph.EdgeArray();
+    std::vector<int> tails(edges.size());
+    for (int node = 0; node < graph.NodeCount(); node++)
+        for (int edge = graph.Offsets()[node]; edge < graph.Offsets()[node + 1]; edge++)
+            tails[edge] = node;
+    std::vector<float> costs(edges.size(), std::numeric_limits<float>::infinity());
+    using Entry = std::pair<float, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    for (int edge = graph.Offsets()[from]; edge < graph.Offsets()[from + 1]; edge++)
+        queue.push({costs[edge] = edges[edge].weight, edge});
+    while (!queue.empty()) {
+        auto [cost, edge] = queue.top();
+        queue.pop();
+        if (cost > costs[edge])
+            continue;
+        const int via = edges[edge].to;
+        if (via == to)
+            return cost;
+        for (int next = graph.Offsets()[via]; next < graph.Offsets()[via + 1]; next++) {
+            if (!model.Turns(profile).Allowed(edge, next))
+                continue;
+            float next_cost = cost + TurnCost(model, profile, tails[edge], via, edges[next].to) + edges[next].weight;
+            if (next_cost < costs[next])
+                queue.push({costs[next] = next_cost, next});
+        }
+    }
+    return std::numeric_limits<float>::infinity();
+}
+
+
+// Test that restrictions with a via node are read, the motorcar value first, and the others dropped.
+TEST(TurnRestrictionTest, TestParsing) {
+    RouteModel model{BlockMap(
+        Restriction("no_left_turn", 10, 2, 11) +
+        "<relation id=\"1\"><tag k=\"restriction:motorcar\" v=\"only_straight_on\"/><tag k=\"restriction\" v=\"no_entry\"/>"
+        "<member type=\"way\" ref=\"11\" role=\"from\"/><member type=\"node\" ref=\"4\" role=\"via\"/>"
+        "<member type=\"way\" ref=\"14\" role=\"to\"/><tag k=\"type\" v=\"restriction\"/></relation>" +
+        // A via way, an unknown value and a missing member.
+        "<relation id=\"2\"><member type=\"way\" ref=\"10\" role=\"from\"/><member type=\"way\" ref=\"12\" role=\"via\"/>"
+        "<member type=\"way\" ref=\"13\" role=\"to\"/><tag k=\"type\" v=\"restriction\"/><tag k=\"restriction\" v=\"no_u_turn\"/></relation>" +
+        Restriction("give_way", 10, 2, 12) + Restriction("no_right_turn", 10, 7, 12))};
+
+    ASSERT_EQ(model.TurnRestrictions().size(), 2u);
+    const Model::TurnRestriction &no_left = model.TurnRestrictions()[0], &only_straight = model.TurnRestrictions()[1];
+    EXPECT_EQ(no_left.from_way, 0);
+    EXPECT_EQ(no_left.via_node, 1);
+    EXPECT_EQ(no_left.to_way, 1);
+    EXPECT_FALSE(no_left.only);
+    EXPECT_EQ(only_straight.from_way, 1);
+    EXPECT_EQ(only_straight.via_node, 3);
+    EXPECT_EQ(only_straight.to_way, 4);
+    EXPECT_TRUE(only_straight.only);
+
+    // Both join edges of the car graph; walking ignores them.
+    EXPECT_EQ(model.Turns().Size(), 1 + 1);
+    EXPECT_EQ(model.Turns(model.FindProfile("walking")).Size(), 0);
+}
+
+
+// Test that a restriction whose via node is in the middle of the from way
+// holds only for the direction of travel its turn fits.
+TEST(TurnRestrictionTest, TestViaInMiddleOfFromWay) {
+    // 1 - 2 - 3 runs west to east and 2 - 4 leaves it to the north: a left
+    // turn coming from 1, a right one coming from 3.
+    const std::string map =
+        "<osm><bounds minlat=\"0\" maxlat=\"0.001\" minlon=\"0\" maxlon=\"0.002\"/>"
+        "<node id=\"1\" lat=\"0\" lon=\"0\"/><node id=\"2\" lat=\"0\" lon=\"0.001\"/>"
+        "<node id=\"3\" lat=\"0\" lon=\"0.002\"/><node id=\"4\" lat=\"0.001\" lon=\"0.001\"/>"
+        "<way id=\"10\"><nd ref=\"1\"/><nd ref=\"2\"/><nd ref=\"3\"/><tag k=\"highway\" v=\"residential\"/></way>"
+        "<way id=\"11\"><nd ref=\"2\"/><nd ref=\"4\"/><tag k=\"highway\" v=\"residential\"/></way>";
+    RouteModel no_left{Bytes(map + Restriction("no_left_turn", 10, 2, 11) + "</osm>")};
+    const Graph &graph = no_left.RoadGraph();
+    const int from_west = graph.FindEdge(0, 1), from_east = graph.FindEdge(2, 1);
+    const int north = graph.FindEdge(1, 3), west = graph.FindEdge(1, 0);
+    EXPECT_FALSE(no_left.Turns().Allowed(from_west, north));
+    EXPECT_TRUE(no_left.Turns().Allowed(from_east, north));
+
+    // Only turning right towards 4 is allowed coming from 3; coming from 1
+    // every turn is.
+    RouteModel only_right{Bytes(map + Restriction("only_right_turn", 10, 2, 11) + "</osm>")};
+    EXPECT_TRUE(only_right.Turns().Allowed(from_east, north));
+    EXPECT_FALSE(only_right.Turns().Allowed(from_east, west));
+    EXPECT_TRUE(only_right.Turns().Allowed(from_west, north));
+    EXPECT_TRUE(only_right.Turns().Allowed(from_west, graph.FindEdge(1, 2)));
+}
+
+
+// Test that the edge-based search goes around the block instead of taking a forbidden turn.
+TEST(TurnRestrictionTest, TestForbiddenTurnIsAvoided) {
+    for (const std::string &restriction : {Restriction("no_left_turn", 10, 2, 11), Restriction("only_straight_on", 10, 2, 12)}) {
+        RouteModel model{BlockMap(restriction)};
+        // Its u-turn cost keeps the fastest profile from turning back at 3,
+        // which is as long as going around the block.
+        const int fastest = model.FindProfile("car-fastest");
+        RoutePath free = Search(model, 0, 3, fastest, false);
+        EXPECT_EQ(free.nodes, (std::vector<int>{0, 1, 3}));
+
+        RoutePath restricted = Search(model, 0, 3, fastest);
+        EXPECT_EQ(restricted.nodes, (std::vector<int>{0, 1, 2, 4, 3}));
+        EXPECT_GT(restricted.Length(), free.Length());
+
+        // Walking does not obey the restriction.
+        EXPECT_EQ(Search(model, 0, 3, model.FindProfile("walking")).nodes, (std::vector<int>{0, 1, 3}));
+    }
+}
+
+
+// Test that turn costs decide between two routes of the same length.
+TEST(TurnRestrictionTest, TestTurnCosts) {
+    RouteModel model{BlockMap("")};
+    RoutingProfile profile = RoutingProfile::Car();
+    // From 4 to 3 either turn left at 2 or right at 5.
+    profile.turn_costs.left = 100.0f;
+    model.SetProfile(RouteModel::kDefaultProfile, profile);
+    EXPECT_EQ(Search(model, 3, 2).nodes, (std::vector<int>{3, 4, 2}));
+    profile.turn_costs = {0.0f, 100.0f, 0.0f};
+    model.SetProfile(RouteModel::kDefaultProfile, profile);
+    EXPECT_EQ(Search(model, 3, 2).nodes, (std::vector<int>{3, 1, 2}));
+}
+
+
+// Test that an edge arriving late still takes a turn the best arrival could
+// only make as a u-turn. Arriving at 2 from 1, the road on to 3 leaves at a
+// sharp angle, a u-turn for car-fastest; from 1 round by 4 it is a right turn.
+TEST(TurnRestrictionTest, TestSharpFork) {
+    RouteModel model{Bytes(
+        "<osm><bounds minlat=\"-0.0012\" maxlat=\"0.0001\" minlon=\"0\" maxlon=\"0.001\"/>"
+        "<node id=\"1\" lat=\"0\" lon=\"0.001\"/><node id=\"2\" lat=\"0\" lon=\"0\"/>"
+        "<node id=\"3\" lat=\"0.0001\" lon=\"0.001\"/><node id=\"4\" lat=\"-0.0012\" lon=\"0\"/>"
+        "<way id=\"10\"><nd ref=\"1\"/><nd ref=\"2\"/><nd ref=\"3\"/><tag k=\"highway\" v=\"residential\"/></way>"
+        "<way id=\"11\"><nd ref=\"2\"/><nd ref=\"4\"/><nd ref=\"1\"/><tag k=\"highway\" v=\"residential\"/></way>"
+        "</osm>")};
+    const int fastest = model.FindProfile("car-fastest");
+    RoutePath path = Search(model, 0, 2, fastest);
+    EXPECT_EQ(path.nodes, (std::vector<int>{0, 3, 1, 2}));
+    EXPECT_FLOAT_EQ(PathCost(model, fastest, path.nodes), BruteForceCost(model, fastest, 0, 2));
+}
+
+
+// Test that with restrictions and turn costs the edge-based search finds the
+// cheapest path a search over every state finds.
+TEST(TurnRestrictionTest, TestMatchesBruteForce) {
+    auto osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    const int fastest = model.FindProfile("car-fastest");
+    SearchWorkspace workspace;
+    for (int i = 0; i < 30; i++) {
+        float sx = (i * 37) % 100, sy = (i * 53) % 100, ex = (i * 71 + 13) % 100, ey = (i * 29 + 41) % 100;
+        RoutePlanner planner{model, workspace, sx, sy, ex, ey, RoutePlanner::Snap::ToNode, fastest};
+        planner.EdgeBasedAStarSearch();
+        const std::vector<int> &nodes = planner.GetPath().nodes;
+        const float expected = BruteForceCost(model, fastest, nodes.front(), nodes.back());
+        EXPECT_NEAR(PathCost(model, fastest, nodes), expected, 1e-4f * expected);
+    }
+}
+
+
+// Test that without restrictions and turn costs the edge-based search finds paths as long as AStarSearch.
+TEST(TurnRestrictionTest, TestMatchesNodeBasedSearch) {
+    auto osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    const int walking = model.FindProfile("walking");
+    SearchWorkspace workspace;
+    for (RoutePlanner::Snap snap : {RoutePlanner::Snap::ToNode, RoutePlanner::Snap::ToEdge}) {
+        for (int i = 0; i < 20; i++) {
+            float sx = (i * 37) % 100, sy = (i * 53) % 100, ex = (i * 71 + 13) % 100, ey = (i * 29 + 41) % 100;
+            RoutePlanner nodes{model, workspace, sx, sy, ex, ey, snap, walking};
+            nodes.AStarSearch();
+            RoutePlanner edges{model, workspace, sx, sy, ex, ey, snap, walking};
+            edges.EdgeBasedAStarSearch();
+            EXPECT_NEAR(edges.GetDistance(), nodes.GetDistance(), 1e-3f * nodes.GetDistance());
+            EXPECT_EQ(edges.GetPath().nodes.front(), nodes.GetPath().nodes.front());
+            EXPECT_EQ(edges.GetPath().nodes.back(), nodes.GetPath().nodes.back());
+        }
+    }
+}
+
+
+// Test that restrictions survive renumbering the nodes and a graph cache.
+TEST(TurnRestrictionTest, TestOrderAndCacheKeepRestrictions) {
+    auto osm_data = BlockMap(Restriction("no_left_turn", 10, 2, 11));
+    RouteModel model{osm_data, 1, Model::NodeOrder::Hilbert};
+    ASSERT_EQ(model.TurnRestrictions().size(), 1u);
+    EXPECT_EQ(model.FileIndex(model.TurnRestrictions()[0].via_node), 1);
+
+    const std::string cache_file = "utest_turn_restrictions.cache";
+    const auto checksum = GraphCache::Checksum(osm_data.data(), osm_data.size());
+    ASSERT_TRUE(GraphCache::Save(cache_file, model, checksum));
+    auto cache = GraphCache::Open(cache_file, checksum);
+    ASSERT_TRUE(cache);
+    RouteModel loaded{*cache};
+    std::remove(cache_file.c_str());
+    ASSERT_EQ(loaded.TurnRestrictions().size(), 1u);
+    EXPECT_EQ(loaded.TurnRestrictions()[0].via_node, model.TurnRestrictions()[0].via_node);
+    EXPECT_EQ(loaded.Turns().Forbidden().size(), 1u);
+
+    std::vector<int> path;
+    for (int node : Search(loaded, loaded.NodeAtFileIndex(0), loaded.NodeAtFileIndex(3), loaded.FindProfile("car-fastest")).nodes)
+        path.push_back(loaded.FileIndex(node));
+    EXPECT_EQ(path, (std::vector<int>{0, 1, 2, 4, 3}));
+}